@@ -0,0 +1,95 @@
+/**************************************************************************
+bg_coroutine.h
+ Created on: Mar 20, 2026
+     Author: M. Schermutzki
+*************************************************************************/
+#ifndef BG_COROUTINE_H
+#define BG_COROUTINE_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+/*** includes ***********************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+#include "bg_task.h"
+/*** local constants ****************************************************/
+/*** macros *************************************************************/
+/* Stackless coroutines in the style of protothreads. The body of a
+ * coroutine function is enclosed in BG_CO_BEGIN / BG_CO_END and resumes at
+ * the last await it returned from. Locals do not survive an await, keep
+ * that state in the context. A coroutine must not use switch around an
+ * await and not more than one await per source line. */
+#if defined(__GNUC__) && (__GNUC__ >= 7)
+#define BG_CO_FALLTHROUGH               __attribute__((fallthrough))
+#else
+#define BG_CO_FALLTHROUGH
+#endif
+#define BG_CO_BEGIN(co)                 switch((co)->line) { case 0:
+#define BG_CO_END(co)                   } (co)->line = 0; return E_BG_CO_DONE
+
+#define BG_CO_YIELD(co)                                                     \
+    do { (co)->line = __LINE__; return E_BG_CO_WAITING; case __LINE__:; } while(0)
+
+#define BG_CO_AWAIT(co, cond)                                               \
+    do { (co)->line = __LINE__; BG_CO_FALLTHROUGH; case __LINE__:           \
+        if(!(cond)) { return E_BG_CO_WAITING; } } while(0)
+
+// cond is evaluated once per resume, BG_CO_TIMED_OUT tells which one ended the wait
+#define BG_CO_AWAIT_TIMEOUT(co, cond, timeoutUs)                            \
+    do { (co)->deadline = (co)->now + (timeoutUs); (co)->line = __LINE__;   \
+        BG_CO_FALLTHROUGH; case __LINE__:                                   \
+        (co)->timedOut = !(cond);                                           \
+        if((co)->timedOut && (co)->now < (co)->deadline) { return E_BG_CO_WAITING; } \
+        (co)->deadline = UINT64_MAX; } while(0)
+
+#define BG_CO_SLEEP(co, us)             BG_CO_AWAIT_TIMEOUT(co, false, us)
+#define BG_CO_AWAIT_SIGNAL(co, signal)  BG_CO_AWAIT(co, bg_co_signal_take(signal, co))
+#define BG_CO_AWAIT_SIGNAL_TIMEOUT(co, signal, timeoutUs)                   \
+    BG_CO_AWAIT_TIMEOUT(co, bg_co_signal_take(signal, co), timeoutUs)
+#define BG_CO_TIMED_OUT(co)             ((co)->timedOut)
+#define BG_CO_EXIT(co)                  do { (co)->line = 0; return E_BG_CO_DONE; } while(0)
+#define BG_CO_RESTART(co)               do { (co)->line = 0; return E_BG_CO_WAITING; } while(0)
+/*** definitions ********************************************************/
+typedef enum
+{
+    E_BG_CO_WAITING,
+    E_BG_CO_DONE
+} bg_co_status_t;
+
+typedef struct bg_co_s bg_co_t;
+typedef bg_co_status_t (*bg_co_fn_t)(bg_co_t* co);
+
+/* Not opaque, the macros above work on it. */
+struct bg_co_s
+{
+    uint32_t line;              // resume point, 0 = start
+    bool timedOut;
+    uint64_t now;               // time of the current resume
+    uint64_t deadline;          // end of the running timeout, UINT64_MAX = none
+    bg_co_fn_t fn;
+    void* context;
+    bg_task_handle_t* task;     // NULL if the coroutine is resumed by hand
+};
+
+typedef struct
+{
+    uint32_t count;             // raised and not yet taken
+    bg_task_handle_t* waiter;   // task of the last coroutine that waited on it
+} bg_co_signal_t;
+/*** functions **********************************************************/
+bg_co_t* bg_co_start(bg_co_fn_t fn, void* context, char const* name, bg_task_prio_t prio, uint32_t periodMs);
+void bg_co_stop(bg_co_t* co);
+void bg_co_setup(bg_co_t* co, bg_co_fn_t fn, void* context);
+bg_co_status_t bg_co_resume(bg_co_t* co, uint64_t now);
+void bg_co_signal_init(bg_co_signal_t* signal);
+void bg_co_signal_raise(bg_co_signal_t* signal);
+bool bg_co_signal_take(bg_co_signal_t* signal, bg_co_t* co);
+void bg_co_deinit(void);
+void bg_co_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* BG_COROUTINE_H */
@@ -0,0 +1,44 @@
+/**************************************************************************
+bg_executor.h
+ Created on: Mar 18, 2026
+     Author: M. Schermutzki
+*************************************************************************/
+#ifndef BG_EXECUTOR_H
+#define BG_EXECUTOR_H
+
+#ifdef __cplusplus
+extern "C" 
+{
+#endif
+/*** includes ***********************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+#include "bg_task.h"
+/*** local constants ****************************************************/
+/*** macros *************************************************************/
+#define BG_EXECUTOR_ANY_CORE    (-1)
+/*** definitions ********************************************************/
+typedef struct
+{
+    uint32_t stackSize;         // bytes, 0 = no thread for this priority, the host uses its default
+    uint8_t priority;           // FreeRTOS priority, unused on the host
+    int8_t core;                // core to pin to or BG_EXECUTOR_ANY_CORE, unused on the host
+} bg_executor_config_t;
+
+typedef struct
+{
+    uint32_t busyUs;            // time spent running passes, wraps
+    uint32_t idleUs;            // time spent blocked, wraps
+    uint32_t wakeups;
+} bg_executor_load_t;
+/*** functions **********************************************************/
+bool bg_executor_start(const bg_executor_config_t config[E_BG_TASK_PRIO_COUNT]);
+void bg_executor_stop(void);
+void bg_executor_getLoad(bg_task_prio_t prio, bg_executor_load_t* load);
+uint16_t bg_executor_getDutyCycle(const bg_executor_load_t* from, const bg_executor_load_t* to);
+bool bg_executor_isRunning(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* BG_EXECUTOR_H */
@@ -12,7 +12,9 @@ extern "C"
 {
 #endif
 /*** includes ***********************************************************/
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 /*** local constants ****************************************************/
 /*** macros *************************************************************/
 /*** definitions ********************************************************/
@@ -20,12 +22,55 @@ typedef enum
 {
     E_BG_TASK_PRIO_LOW,
     E_BG_TASK_PRIO_MID,
-    E_BG_TASK_PRIO_HIGH
+    E_BG_TASK_PRIO_HIGH,
+    /*=============================*/
+    E_BG_TASK_PRIO_COUNT
 }bg_task_prio_t;
 typedef void (*bg_task_t)(void);
+typedef void (*bg_task_context_t)(void* context);
+typedef struct bg_task_entry_s bg_task_handle_t;
+typedef uint64_t (*bg_task_time_t)(void);
+typedef uint32_t (*bg_task_cycles_t)(void);
+typedef void (*bg_task_lock_t)(void);
+typedef void (*bg_task_notify_t)(bg_task_prio_t prio);
+
+typedef struct
+{
+    uint32_t runs;
+    uint32_t missed;            // periods that passed without a run
+    uint32_t lastLatenessUs;    // start time - due time of the last run
+    uint32_t maxLatenessUs;
+    uint64_t nextDueUs;
+} bg_task_stats_t;
+
+typedef struct
+{
+    uint32_t calls;             // timed runs
+    uint32_t overruns;          // runs that took longer than the period
+    uint32_t minNs;
+    uint32_t maxNs;
+    uint32_t meanNs;
+} bg_task_profile_t;
 /*** functions **********************************************************/
 void bg_task_cyclic(void);
-void bg_task_add(bg_task_t task, char const* name, bg_task_prio_t prio);
+void bg_task_cyclicPrio(bg_task_prio_t prio);
+bg_task_handle_t* bg_task_add(bg_task_t task, char const* name, bg_task_prio_t prio, uint32_t periodMs, uint32_t offsetMs);
+bg_task_handle_t* bg_task_addContext(bg_task_context_t task, void* context, char const* name, bg_task_prio_t prio, uint32_t periodMs, uint32_t offsetMs);
+void bg_task_remove(bg_task_handle_t* handle);
+void bg_task_suspend(bg_task_handle_t* handle);
+void bg_task_resume(bg_task_handle_t* handle);
+void bg_task_wakeAt(bg_task_handle_t* handle, uint64_t timeUs);
+void bg_task_wake(bg_task_handle_t* handle);
+bool bg_task_getStats(char const* name, bg_task_stats_t* stats);
+bool bg_task_getProfile(char const* name, bg_task_profile_t* profile);
+void bg_task_setCycleCounter(bg_task_cycles_t counter, uint32_t cyclesPerUs);
+uint64_t bg_task_getNextDue(void);
+uint64_t bg_task_getNextDuePrio(bg_task_prio_t prio);
+void bg_task_setLock(bg_task_lock_t lock, bg_task_lock_t unlock);
+void bg_task_setNotify(bg_task_notify_t notify);
+void bg_task_setTimeSource(bg_task_time_t time);
+bg_task_time_t bg_task_getTimeSource(void);
+void bg_task_deinit(void);
 void bg_task_init(void);
 
 #ifdef __cplusplus
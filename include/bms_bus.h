@@ -0,0 +1,42 @@
+/**************************************************************************
+bms_bus.h
+ Created on: Mar 06, 2026
+     Author: M. Schermutzki
+*************************************************************************/
+#ifndef BMS_BUS_H
+#define BMS_BUS_H
+
+#ifdef __cplusplus
+extern "C" 
+{
+#endif
+/*** includes ***********************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "bms_communication.h"
+#include "generic_hardware_interface.h"
+/*** local constants ****************************************************/
+/*** macros *************************************************************/
+/*** definitions ********************************************************/
+// bms_bus_t is declared in bms_communication.h
+/*** functions **********************************************************/
+bool bms_bus_getFilter(bms_bus_t* bus, uint32_t* code, uint32_t* mask);
+uint32_t bms_bus_getForeignCount(bms_bus_t* bus);
+uint32_t bms_bus_getBusOffCount(bms_bus_t* bus);
+uint8_t bms_bus_getMemberCount(bms_bus_t* bus);
+bms_com_t* bms_bus_lookup(bms_bus_t* bus, uint32_t slaveID);
+void bms_bus_setWindow(bms_bus_t* bus, uint8_t window);
+uint8_t bms_bus_getShare(bms_bus_t* bus);
+void bms_bus_sweepDone(bms_bus_t* bus, uint32_t slaveID, uint64_t now);
+uint32_t bms_bus_getSweepTime(bms_bus_t* bus);
+void bms_bus_poll(bms_bus_t* bus);
+void bms_bus_detach(bms_bus_t* bus, uint32_t slaveID);
+bms_bus_t* bms_bus_attach(const hardware_interface_t* hw, bms_com_t* bms, uint32_t slaveID);
+void bms_bus_deinit(void);
+void bms_bus_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* BMS_BUS_H */
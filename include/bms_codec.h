@@ -0,0 +1,56 @@
+/**************************************************************************
+bms_codec.h
+ Created on: Mar 14, 2026
+     Author: M. Schermutzki
+*************************************************************************/
+#ifndef BMS_CODEC_H
+#define BMS_CODEC_H
+
+#ifdef __cplusplus
+extern "C" 
+{
+#endif
+/*** includes ***********************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "bms_history.h"
+/*** local constants ****************************************************/
+/*** macros *************************************************************/
+#define BMS_CODEC_CHANNELS          (2 + BMS_CELL_COUNT)    // total current, total voltage, cells
+#define BMS_CODEC_SAMPLE_MAX        (10 + BMS_CODEC_CHANNELS * 6)   // worst case bytes per sample
+/*** definitions ********************************************************/
+/* Encoder and decoder are plain state, the caller owns them and the 
+ * chunk buffer. Every chunk starts with a key frame, so each chunk can be
+ * decoded on its own. */
+typedef struct
+{
+    uint8_t* buffer;
+    size_t capacity;
+    size_t length;
+    uint32_t count;             // samples in the chunk
+    uint64_t gridTime;          // predicted time of the last sample
+    int64_t step;               // sample period the next time is predicted with
+    int32_t last[BMS_CODEC_CHANNELS];
+} bms_encoder_t;
+
+typedef struct
+{
+    const uint8_t* buffer;
+    size_t length;
+    size_t position;
+    uint32_t count;
+    uint64_t gridTime;
+    int64_t step;
+    int32_t last[BMS_CODEC_CHANNELS];
+} bms_decoder_t;
+/*** functions **********************************************************/
+void bms_codec_encoderInit(bms_encoder_t* encoder, uint8_t* buffer, size_t capacity);
+bool bms_codec_encode(bms_encoder_t* encoder, const bms_sample_t* sample);
+void bms_codec_decoderInit(bms_decoder_t* decoder, const uint8_t* buffer, size_t length);
+bool bms_codec_decode(bms_decoder_t* decoder, bms_sample_t* sample);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* BMS_CODEC_H */
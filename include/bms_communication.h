@@ -11,10 +11,23 @@ extern "C"
 {
 #endif
 /*** includes ***********************************************************/
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 #include "generic_hardware_interface.h"
 
+/*** macros *************************************************************/
+#define BMS_CELL_COUNT              (16)
+#define BMS_CELL_BLOCK_SIZE         (4)         // cells per response of commands 0x09..0x0C
+#define BMS_GROUP_MASK(group)       (1ul << (group))
+#define BMS_GROUP_MASK_ALL          (BMS_GROUP_MASK(E_BMS_GROUP_COUNT) - 1ul)
+#define BMS_GROUP_MASK_CELLS        (BMS_GROUP_MASK(E_BMS_GROUP_CELLS_1_TO_4) | BMS_GROUP_MASK(E_BMS_GROUP_CELLS_5_TO_8) | \
+                                     BMS_GROUP_MASK(E_BMS_GROUP_CELLS_9_TO_12) | BMS_GROUP_MASK(E_BMS_GROUP_CELLS_13_TO_16))
+// groups that are decoded into bms_com_t, default subscription of a new instance
+#define BMS_GROUP_MASK_DECODED      (BMS_GROUP_MASK(E_BMS_GROUP_TOTALS) | BMS_GROUP_MASK(E_BMS_GROUP_CAPACITY) | \
+                                     BMS_GROUP_MASK(E_BMS_GROUP_CELL_LIMITS) | BMS_GROUP_MASK(E_BMS_GROUP_ALARMS) | \
+                                     BMS_GROUP_MASK(E_BMS_GROUP_PROTECTION) | BMS_GROUP_MASK_CELLS | \
+                                     BMS_GROUP_MASK(E_BMS_GROUP_TEMPERATURES))
 /*** definitions ********************************************************/
 typedef enum 
 {
@@ -23,7 +36,118 @@ typedef enum
     E_BMS_STATUS_ERROR    
 } bms_status_t;
 
+typedef enum
+{
+    E_BMS_CMD1_TOTAL_VALUES,
+    E_BMS_CMD1_CAPACITY,
+    E_BMS_CMD1_SOC_SOH,
+    E_BMS_CMD1_CELL_VLTG,
+    E_BMS_CMD1_ACCU_STATUS,
+    E_BMS_CMD1_ALARM_STATUS,
+    E_BMS_CMD1_PROTECT_B,
+    E_BMS_CMD1_CHASSIS_ID,
+    E_BMS_CMD1_BATTERY_STATUS,
+    E_BMS_CMD1_CELL_VLTG_1_TO_4,
+    E_BMS_CMD1_CELL_VLTG_5_TO_8,
+    E_BMS_CMD1_CELL_VLTG_9_TO_12,
+    E_BMS_CMD1_CELL_VLTG_13_TO_16,  
+    E_BMS_CMD2_TEMPERATURE_DATA1,
+    E_BMS_CMD2_TEMPERATURE_DATA2,
+    E_BMS_CMD2_TEMEPRATURE_DATA3,
+    E_BMS_CMD2_CHASSIS_VLTG,
+    E_BMS_CMD2_CHASSIS_TEMPERATURE, 
+    /*=============================*/
+    E_BMS_CMD_COUNT
+} bms_cmd_list_t;
+
+typedef enum
+{
+    E_BMS_GROUP_TOTALS,                 // total voltage and current
+    E_BMS_GROUP_CAPACITY,               // full and remaining capacity
+    E_BMS_GROUP_SOC_SOH,
+    E_BMS_GROUP_CELL_LIMITS,            // max, min and differential cell voltage
+    E_BMS_GROUP_ACCU_STATUS,
+    E_BMS_GROUP_ALARMS,                 // alarm status A and B
+    E_BMS_GROUP_PROTECTION,             // protect A and B
+    E_BMS_GROUP_CHASSIS_ID,
+    E_BMS_GROUP_BATTERY_STATUS,
+    E_BMS_GROUP_CELLS_1_TO_4,
+    E_BMS_GROUP_CELLS_5_TO_8,
+    E_BMS_GROUP_CELLS_9_TO_12,
+    E_BMS_GROUP_CELLS_13_TO_16,
+    E_BMS_GROUP_TEMPERATURES,           // max and lowest temperature
+    E_BMS_GROUP_TEMPERATURE_DATA3,
+    E_BMS_GROUP_CHASSIS_VLTG,
+    E_BMS_GROUP_CHASSIS_TEMPERATURE,
+    /*=============================*/
+    E_BMS_GROUP_COUNT
+} bms_group_t;
+
+typedef enum
+{
+    E_BMS_FIELD_TOTAL_VOLTAGE,
+    E_BMS_FIELD_TOTAL_CURRENT,
+    E_BMS_FIELD_FULL_CAPACITY,
+    E_BMS_FIELD_REMAINING_CAPACITY,
+    E_BMS_FIELD_MAX_CELL_VOLTAGE,
+    E_BMS_FIELD_MIN_CELL_VOLTAGE,
+    E_BMS_FIELD_CELL_DIFF_VOLTAGE,
+    E_BMS_FIELD_MAX_TEMPERATURE,
+    E_BMS_FIELD_MIN_TEMPERATURE,
+    E_BMS_FIELD_ALARM_STATUS_A,         // bit fields, reported on every flip
+    E_BMS_FIELD_ALARM_STATUS_B,
+    E_BMS_FIELD_PROTECT_A,
+    E_BMS_FIELD_PROTECT_B,
+    E_BMS_FIELD_CELL_VOLTAGE,           // all cells, the index tells which one
+    /*=============================*/
+    E_BMS_FIELD_COUNT
+} bms_field_t;
+
+typedef enum
+{
+    E_BMS_DEADBAND_ABSOLUTE,            // in units of the field
+    E_BMS_DEADBAND_RELATIVE             // in per mille of the last reported value
+} bms_deadband_t;
+
+typedef struct
+{
+    uint16_t min;               // mV, over the cells received so far
+    uint16_t max;
+    uint16_t mean;
+    uint16_t spread;            // max - min
+    uint8_t minIndex;
+    uint8_t maxIndex;
+    uint8_t cellCount;          // cells that went into the statistics
+    int16_t maxDeviation;       // max - max cell voltage reported by command 0x03
+    int16_t minDeviation;       // min - min cell voltage reported by command 0x03
+    bool consistent;            // both deviations are within 5 mV
+} bms_cell_stats_t;
+
+typedef struct
+{
+    uint32_t sequence;          // completed sweeps when the copy was taken
+    uint64_t timestampUs;       // time the newest value was decoded, 0 = no data yet
+    uint32_t freshGroups;       // BMS_GROUP_MASK of the groups that are not stale
+    uint32_t totalVoltage;      // mV
+    int32_t totalCurrent;       // mA
+    uint32_t fullCapacity;      // mAh
+    uint32_t remainingCapacity; // mAh
+    uint16_t maxCellVoltage;    // mV
+    uint16_t minCellVoltage;
+    uint16_t cellDiffVoltage;
+    int16_t maxTemperature;     // degree C
+    int16_t minTemperature;
+    uint16_t alarmStatusA;
+    uint16_t alarmStatusB;
+    uint16_t protectA;
+    uint16_t protectB;
+    uint16_t cellVoltage[BMS_CELL_COUNT];
+    bms_cell_stats_t cellStats;
+} bms_snapshot_t;
+
 typedef struct bms_com_s bms_com_t;
+typedef struct bms_bus_s bms_bus_t;
+typedef void (*bms_observer_t)(bms_com_t* bms, bms_field_t field, uint8_t index, int32_t value, void* context);
 
 /*** functions **********************************************************/
 uint32_t bms_communication_getTotalVoltage(bms_com_t* bms);    
@@ -33,6 +157,8 @@ uint32_t bms_communication_getFullCapacity(bms_com_t* bms);
 uint32_t bms_communication_getRemainingCapacity(bms_com_t* bms); 
 
 uint16_t bms_communication_getCellVoltage(bms_com_t* bms, uint8_t cellIndex); 
+void bms_communication_getCellVoltages(bms_com_t* bms, uint16_t cellVoltage[BMS_CELL_COUNT]);
+void bms_communication_getCellStats(bms_com_t* bms, bms_cell_stats_t* stats);
 uint16_t bms_communication_getMaxCellVoltage(bms_com_t* bms);   
 uint16_t bms_communication_getMinCellVoltage(bms_com_t* bms);   
 
@@ -43,11 +169,40 @@ uint16_t bms_communication_getAlarmStatusA(bms_com_t* bms);
 uint16_t bms_communication_getAlarmStatusB(bms_com_t* bms);    
 uint16_t bms_communication_getProtectA(bms_com_t* bms);       
 uint16_t bms_communication_getProtectB(bms_com_t* bms);       
+void bms_communication_getSnapshot(bms_com_t* bms, bms_snapshot_t* snapshot);
 
+uint32_t bms_communication_getSubscription(bms_com_t* bms);
+void bms_communication_setSubscription(bms_com_t* bms, uint32_t groupMask);
+bool bms_communication_addObserver(bms_com_t* bms, bms_field_t field, bms_deadband_t deadbandType, 
+                                   uint32_t deadband, bms_observer_t callback, void* context);
+void bms_communication_removeObserver(bms_com_t* bms, bms_observer_t callback, void* context);
+void bms_communication_setMaxAge(bms_com_t* bms, bms_group_t group, uint32_t maxAgeMs);
+uint64_t bms_communication_getAge(bms_com_t* bms, bms_group_t group);
+bool bms_communication_isFresh(bms_com_t* bms, bms_group_t group);
+uint32_t bms_communication_getFreshGroups(bms_com_t* bms);
+void bms_communication_setPollPeriod(bms_com_t* bms, bms_cmd_list_t cmd, uint32_t periodMs, uint32_t phaseMs);
+void bms_communication_receive(bms_com_t* bms, const can_frame_t* frame);
+void bms_communication_txComplete(bms_com_t* bms, const can_tx_status_t* txStatus);
+void bms_communication_busOff(bms_com_t* bms);
+bms_bus_t* bms_communication_getBus(bms_com_t* bms);
+uint32_t bms_communication_getTimeoutCount(bms_com_t* bms);
+uint32_t bms_communication_getTxErrorCount(bms_com_t* bms);
+uint32_t bms_communication_getLateResponseCount(bms_com_t* bms);
+uint32_t bms_communication_getSweepTime(bms_com_t* bms);
+uint64_t bms_communication_getNextDeadline(bms_com_t* bms);
+uint32_t bms_communication_getSweepCount(bms_com_t* bms);
+bool bms_communication_newSweepAvailable(bms_com_t* bms, uint32_t* lastSeen);
+uint32_t bms_communication_getReadContentionCount(bms_com_t* bms);
+uint32_t bms_communication_getReadRetryCount(bms_com_t* bms);
+void bms_communication_setResponseTimeout(bms_com_t* bms, uint32_t timeoutUs);
+void bms_communication_setPipelineDepth(bms_com_t* bms, uint8_t depth);
 bms_status_t bms_communication_cyclic(bms_com_t* bms);
+void bms_communication_delete(bms_com_t* bms);
 bms_com_t* bms_communication_new(const hardware_interface_t* hw, uint32_t slaveID);
 void bms_communication_deinit(void);
 void bms_communication_init(void);
+size_t bms_communication_getInstanceSize(void);
+void bms_communication_initPool(void* pool, size_t poolSize);
 
 #ifdef __cplusplus
 }
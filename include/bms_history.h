@@ -0,0 +1,59 @@
+/**************************************************************************
+bms_history.h
+ Created on: Mar 12, 2026
+     Author: M. Schermutzki
+*************************************************************************/
+#ifndef BMS_HISTORY_H
+#define BMS_HISTORY_H
+
+#ifdef __cplusplus
+extern "C" 
+{
+#endif
+/*** includes ***********************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "bms_communication.h"
+/*** local constants ****************************************************/
+/* Each pack reserves about 18 KB of static RAM, 150 samples of 64 bytes 
+ * in the ring and 16 archive chunks of 512 bytes. The pool holds one pack
+ * by default, a setup with more packs sets -DBMS_HISTORY_INSTANCES_MAX=n.
+ * bms_history_getFootprint returns the exact size. */
+/*** macros *************************************************************/
+/*** definitions ********************************************************/
+typedef struct
+{
+    uint64_t timeUs;            // time the newest value of the sweep was decoded
+    uint32_t totalVoltage;      // mV
+    int32_t totalCurrent;       // mA
+    uint32_t remainingCapacity; // mAh
+    int16_t maxTemperature;     // degree C
+    int16_t minTemperature;
+    uint16_t alarmStatusA;
+    uint16_t alarmStatusB;
+    uint16_t protectA;
+    uint16_t protectB;
+    uint16_t cellVoltage[BMS_CELL_COUNT];
+} bms_sample_t;
+
+typedef struct bms_history_s bms_history_t;
+/*** functions **********************************************************/
+void bms_history_append(bms_history_t* history, const bms_sample_t* sample);
+bool bms_history_cyclic(bms_history_t* history);
+uint32_t bms_history_getCount(bms_history_t* history);
+uint32_t bms_history_getCapacity(bms_history_t* history);
+bool bms_history_getSample(bms_history_t* history, uint32_t index, bms_sample_t* sample);
+uint32_t bms_history_query(bms_history_t* history, uint64_t fromUs, uint64_t toUs, bms_sample_t* samples, uint32_t maxSamples);
+void bms_history_archive(bms_history_t* history, const bms_sample_t* sample);
+uint32_t bms_history_getArchiveCount(bms_history_t* history);
+uint32_t bms_history_queryArchive(bms_history_t* history, uint64_t fromUs, uint64_t toUs, bms_sample_t* samples, uint32_t maxSamples);
+size_t bms_history_getFootprint(void);
+bms_history_t* bms_history_new(bms_com_t* bms, uint32_t periodMs);
+void bms_history_deinit(void);
+void bms_history_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* BMS_HISTORY_H */
@@ -0,0 +1,79 @@
+/**************************************************************************
+bms_rollup.h
+ Created on: Mar 15, 2026
+     Author: M. Schermutzki
+*************************************************************************/
+#ifndef BMS_ROLLUP_H
+#define BMS_ROLLUP_H
+
+#ifdef __cplusplus
+extern "C" 
+{
+#endif
+/*** includes ***********************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "bms_communication.h"
+/*** local constants ****************************************************/
+/* Each pack reserves about 14 KB of static RAM, 144 closed intervals of
+ * 96 bytes (60 s, 60 min, 24 h) and the open interval of every level. The
+ * pool holds one pack by default, a setup with more packs sets 
+ * -DBMS_ROLLUP_INSTANCES_MAX=n. bms_rollup_getFootprint returns the exact
+ * size. */
+/*** macros *************************************************************/
+#define BMS_ROLLUP_LEVEL_MASK(level)    (1u << (level))
+/*** definitions ********************************************************/
+typedef enum
+{
+    E_BMS_ROLLUP_SECOND,
+    E_BMS_ROLLUP_MINUTE,
+    E_BMS_ROLLUP_HOUR,
+    /*=============================*/
+    E_BMS_ROLLUP_LEVEL_COUNT
+} bms_rollup_level_t;
+
+typedef enum
+{
+    E_BMS_ROLLUP_TOTAL_VOLTAGE,         // mV
+    E_BMS_ROLLUP_TOTAL_CURRENT,         // mA
+    E_BMS_ROLLUP_REMAINING_CAPACITY,    // mAh
+    E_BMS_ROLLUP_MAX_TEMPERATURE,       // degree C
+    E_BMS_ROLLUP_MIN_TEMPERATURE,
+    E_BMS_ROLLUP_MAX_CELL_VOLTAGE,      // mV, from the cell statistics
+    E_BMS_ROLLUP_MIN_CELL_VOLTAGE,
+    /*=============================*/
+    E_BMS_ROLLUP_FIELD_COUNT
+} bms_rollup_field_t;
+
+typedef struct
+{
+    int32_t min;
+    int32_t max;
+    int32_t mean;
+} bms_rollup_stat_t;
+
+typedef struct
+{
+    uint64_t startUs;           // start of the interval, aligned to its length
+    uint32_t count;             // sweeps that went into the interval
+    bms_rollup_stat_t field[E_BMS_ROLLUP_FIELD_COUNT];
+} bms_rollup_entry_t;
+
+typedef struct bms_rollup_s bms_rollup_t;
+/*** functions **********************************************************/
+uint8_t bms_rollup_add(bms_rollup_t* rollup, const bms_snapshot_t* snapshot);
+uint8_t bms_rollup_cyclic(bms_rollup_t* rollup);
+uint32_t bms_rollup_getCount(bms_rollup_t* rollup, bms_rollup_level_t level);
+uint32_t bms_rollup_getCapacity(bms_rollup_level_t level);
+bool bms_rollup_getEntry(bms_rollup_t* rollup, bms_rollup_level_t level, uint32_t index, bms_rollup_entry_t* entry);
+bool bms_rollup_getCurrent(bms_rollup_t* rollup, bms_rollup_level_t level, bms_rollup_entry_t* entry);
+size_t bms_rollup_getFootprint(void);
+bms_rollup_t* bms_rollup_new(bms_com_t* bms);
+void bms_rollup_deinit(void);
+void bms_rollup_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* BMS_ROLLUP_H */
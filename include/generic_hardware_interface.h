@@ -30,11 +30,24 @@ typedef struct
     uint8_t  data[8];
 } can_frame_t;
 
+typedef struct
+{
+    uint32_t id;            // CAN ID of the transmitted frame
+    hal_status_t status;    // E_HAL_STATUS_OK once the frame left the controller
+} can_tx_status_t;
+
 // function pointer for hardware intependend communication
 typedef hal_status_t (*com_read_t)(void* handle, void* data);
 typedef hal_status_t (*com_write_t)(void* handle, const void* data, uint16_t count); 
 typedef hal_status_t (*com_open_t)(void* handle, uint32_t baudrate);
 typedef hal_status_t (*com_close_t)(void* handle);
+typedef uint64_t (*com_time_t)(void);      // monotonic time in microseconds
+typedef hal_status_t (*com_tx_status_t)(void* handle, can_tx_status_t* txStatus);   // pops one transmit completion
+typedef hal_status_t (*com_set_filter_t)(void* handle, uint32_t code, uint32_t mask);  // accept id if (id & mask) == code
+typedef uint32_t (*com_bus_off_count_t)(void* handle);     // bus-off events so far, the HAL recovers from them itself
+// move up to count frames in one call, *done is the number moved in order even if the call fails part way
+typedef hal_status_t (*com_write_batch_t)(void* handle, const can_frame_t* frames, uint16_t count, uint16_t* done);   // BUSY if not all fit
+typedef hal_status_t (*com_read_batch_t)(void* handle, can_frame_t* frames, uint16_t count, uint16_t* done);          // BUSY if none was received
 
 typedef struct 
 {
@@ -43,6 +56,12 @@ typedef struct
     com_write_t comWrite;
     com_open_t comOpen;
     com_close_t comClose;
+    com_time_t comTime;
+    com_tx_status_t comTxStatus;    // optional, NULL if comWrite completes synchronously
+    com_set_filter_t comSetFilter;  // optional, NULL if the HAL cannot filter
+    com_write_batch_t comWriteBatch;    // optional, NULL to write frame by frame with comWrite
+    com_read_batch_t comReadBatch;      // optional, NULL to read frame by frame with comRead
+    com_bus_off_count_t comBusOffCount; // optional, NULL if the HAL does not report bus-off
 } hardware_interface_t;
 
 #ifdef __cplusplus
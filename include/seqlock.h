@@ -0,0 +1,40 @@
+/**************************************************************************
+seqlock.h
+ Created on: Mar 09, 2026
+     Author: M. Schermutzki
+*************************************************************************/
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#ifdef __cplusplus
+extern "C" 
+{
+#endif
+/*** includes ***********************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+/*** local constants ****************************************************/
+/*** macros *************************************************************/
+/*** definitions ********************************************************/
+/* The lock is embedded in the structure it protects, so it is not opaque.
+ * Only use the seqlock_* functions on it. */
+typedef struct
+{
+    uint32_t sequence;          // odd while the writer updates the data
+    uint32_t contentionCount;   // reads that found the writer busy
+    uint32_t retryCount;        // copies that were discarded
+} seqlock_t;
+/*** functions **********************************************************/
+void seqlock_writeBegin(seqlock_t* lock);
+void seqlock_writeEnd(seqlock_t* lock);
+uint32_t seqlock_readBegin(seqlock_t* lock);
+bool seqlock_readRetry(seqlock_t* lock, uint32_t start);
+uint32_t seqlock_getContentionCount(seqlock_t* lock);
+uint32_t seqlock_getRetryCount(seqlock_t* lock);
+void seqlock_init(seqlock_t* lock);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SEQLOCK_H */
@@ -0,0 +1,36 @@
+/**************************************************************************
+spsc_ring.h
+ Created on: Mar 04, 2026
+     Author: M. Schermutzki
+*************************************************************************/
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#ifdef __cplusplus
+extern "C" 
+{
+#endif
+/*** includes ***********************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+/*** local constants ****************************************************/
+/*** macros *************************************************************/
+/*** definitions ********************************************************/
+typedef struct spsc_ring_s spsc_ring_t;
+/*** functions **********************************************************/
+bool spsc_ring_push(spsc_ring_t* ring, const void* element);
+bool spsc_ring_pop(spsc_ring_t* ring, void* element);
+uint32_t spsc_ring_pushBatch(spsc_ring_t* ring, const void* elements, uint32_t count);
+uint32_t spsc_ring_popBatch(spsc_ring_t* ring, void* elements, uint32_t count);
+uint32_t spsc_ring_getCount(spsc_ring_t* ring);
+uint32_t spsc_ring_getHighWater(spsc_ring_t* ring);
+uint32_t spsc_ring_getDropCount(spsc_ring_t* ring);
+spsc_ring_t* spsc_ring_new(void* buffer, size_t elementSize, uint32_t capacity);
+void spsc_ring_deinit(void);
+void spsc_ring_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SPSC_RING_H */
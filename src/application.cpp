@@ -8,27 +8,105 @@ application.c
 #include <stdint.h>
 #include "Arduino.h"        
 #include "driver/twai.h"    
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "application.hpp"
+#include "bg_executor.h"
 #include "bg_task.h"
+#include "bms_bus.h"
 #include "bms_communication.h"
+#include "bms_history.h"
+#include "bms_rollup.h"
 #include "generic_hardware_interface.h"
+#include "spsc_ring.h"
 /*** local constants ******************************************************/
 static char const* C_MODULE_NAME = "Application";
 #define CAN_TX_PIN GPIO_NUM_5
 #define CAN_RX_PIN GPIO_NUM_4
 #define LOG_INTERVAL_MS 2000 
+#define LOG_OFFSET_MS 1000              // keeps the report away from the start of a poll period
+#ifndef APP_USE_EXECUTOR
+#define APP_USE_EXECUTOR 1              // set with -DAPP_USE_EXECUTOR=0 to run all tasks from loop()
+#endif
+#if APP_USE_EXECUTOR
+#define BMS_CYCLIC_PERIOD_MS 100        // fallback only, BMS deadlines and CAN events wake the task
+#else
+#define BMS_CYCLIC_PERIOD_MS 5
+#endif
+#define BMS_PIPELINE_DEPTH 4
+#define BMS_HISTORY_PERIOD_MS 2000
+#define CAN_RX_RING_SIZE 64             // power of two
+#define CAN_RX_TASK_STACK 4096
+#define CAN_RX_TASK_PRIO (configMAX_PRIORITIES - 2)
+#define CAN_RX_TASK_CORE 0
+#define CAN_RX_POLL_MS 100              // bounds how long a filter change waits for the RX task
+#define CAN_RX_BURST 16                 // frames the RX task takes from the driver per wake up
+#define CAN_TX_RING_SIZE 16             // power of two
+#define CAN_TX_TASK_STACK 4096
+#define CAN_TX_TASK_PRIO (configMAX_PRIORITIES - 3)
+#define CAN_TX_TASK_CORE 0
+#define CAN_TX_TIMEOUT_MS 10            // max time a frame may take to leave the controller
+#define CAN_DRIVER_TASKS 2              // RX and TX task, both park while the driver is reinstalled
+#define CAN_RECOVERY_TIMEOUT_MS 100     // 128 x 11 recessive bits take about 3 ms at 500 kbit/s
+// BMS state machine next to the CAN driver tasks on core 0, reporting on core 1
+static const bg_executor_config_t C_EXECUTOR_CONFIG[E_BG_TASK_PRIO_COUNT] = 
+{
+    { 4096, 1, 1 },                                 // E_BG_TASK_PRIO_LOW
+    { 0, 0, BG_EXECUTOR_ANY_CORE },                 // E_BG_TASK_PRIO_MID, unused
+    { 4096, configMAX_PRIORITIES - 4, 0 },          // E_BG_TASK_PRIO_HIGH, below the CAN driver tasks
+};
 /*** local variables ******************************************************/
 static bool _initialized = false;
 static hardware_interface_t _bmsInit1;
 static bms_com_t* _bms1 = NULL;
+static bms_history_t* _history1 = NULL;
+static bms_rollup_t* _rollup1 = NULL;
+static bg_task_handle_t* _cyclicTask = NULL;
+static bg_executor_load_t _lastLoad[E_BG_TASK_PRIO_COUNT];
 static uint32_t _bms1Id = 0x1FFFC; 
-static uint32_t _lastLogTime = 0;
+static uint32_t _lastSweep = 0;
+static can_frame_t _rxBuffer[CAN_RX_RING_SIZE];
+static spsc_ring_t* _rxRing = NULL;
+static can_frame_t _txBuffer[CAN_TX_RING_SIZE];
+static spsc_ring_t* _txRing = NULL;
+static can_tx_status_t _txStatusBuffer[CAN_TX_RING_SIZE];
+static spsc_ring_t* _txStatusRing = NULL;
+static TaskHandle_t _txTask = NULL;
+static twai_general_config_t _twaiGeneral = TWAI_GENERAL_CONFIG_DEFAULT(CAN_TX_PIN, CAN_RX_PIN, TWAI_MODE_NORMAL);
+static twai_timing_config_t _twaiTiming = TWAI_TIMING_CONFIG_500KBITS();
+static twai_filter_config_t _twaiFilter = TWAI_FILTER_CONFIG_ACCEPT_ALL();
+static SemaphoreHandle_t _driverLock = NULL;   // serializes filter changes, the driver tasks never take it
+static SemaphoreHandle_t _driverParked = NULL;  // given by a driver task once it parked
+static SemaphoreHandle_t _driverResume = NULL;  // given once per parked task after the reinstall
+static bool _driverPaused = false;
+static uint32_t _busOffCount = 0;               // written by the TX task only
+static bool _driverInstalled = false;
 /*** prototypes ***********************************************************/
 static void _cyclic(void);
+static void _report(void);
 static void _setupBmsCom(void); 
 static void _logBmsData(void);
+static void _logRollup(bms_rollup_level_t level);
+static void _logTask(char const* name);
+static void _logLoad(void);
+static void _wakeCyclic(void);
+static void _onProtectionEvent(bms_com_t* bms, bms_field_t field, uint8_t index, int32_t value, void* context);
+static void _canRxTask(void* arg);
+static void _canTxTask(void* arg);
+static hal_status_t _canTransmit(const can_frame_t* frame);
+static void _recoverBusOff(void);
+static void _parkDriverTask(void);
 hal_status_t _can_write(void* handle, void* data, uint8_t length);
 hal_status_t _can_read(void* handle, void* data);
+hal_status_t _can_writeBatch(void* handle, const can_frame_t* frames, uint16_t count, uint16_t* done);
+hal_status_t _can_readBatch(void* handle, can_frame_t* frames, uint16_t count, uint16_t* done);
+hal_status_t _can_txStatus(void* handle, can_tx_status_t* txStatus);
+hal_status_t _can_setFilter(void* handle, uint32_t code, uint32_t mask);
+uint32_t _can_busOffCount(void* handle);
+uint64_t _can_time(void);
+static uint32_t _cycleCount(void);
 /*=============================== PRIVATE ==========================================*/
 /***************************************************************************
  * This function
@@ -38,16 +116,39 @@ static void _cyclic(void)
     assert(_initialized);
     assert(_bms1);
     
-    bms_status_t status = bms_communication_cyclic(_bms1);
+    bms_communication_cyclic(_bms1);
+    bms_history_cyclic(_history1);
 
-    if(status == E_BMS_STATUS_IDLE)
+    if(bms_rollup_cyclic(_rollup1) & BMS_ROLLUP_LEVEL_MASK(E_BMS_ROLLUP_MINUTE))
     {
-        uint32_t now = millis();
-        if (now - _lastLogTime >= LOG_INTERVAL_MS) 
-        {
-            _logBmsData();
-            _lastLogTime = now;
-        }
+        _logRollup(E_BMS_ROLLUP_MINUTE);
+    }
+
+    // sleep until the next poll or response timeout, received frames wake the task earlier
+    bg_task_wakeAt(_cyclicTask, bms_communication_getNextDeadline(_bms1));
+}
+/***************************************************************************
+ * This function lets the BMS task run as soon as possible after a CAN 
+ * event. Without the executor the task is polled and needs no wake up.
+ **************************************************************************/
+static void _wakeCyclic(void)
+{
+    if(_cyclicTask != NULL && bg_executor_isRunning())
+    {
+        bg_task_wake(_cyclicTask);
+    }
+}
+/***************************************************************************
+ * This function prints the pack data every LOG_INTERVAL_MS once a new 
+ * sweep was published.
+ **************************************************************************/
+static void _report(void)
+{
+    assert(_initialized);
+
+    if(bms_communication_newSweepAvailable(_bms1, &_lastSweep))
+    {
+        _logBmsData();
     }
 }
 /***************************************************************************
@@ -55,64 +156,199 @@ static void _cyclic(void)
  **************************************************************************/
 static void _logBmsData(void)
 {
+    bms_snapshot_t snap;
+    bms_communication_getSnapshot(_bms1, &snap);
+
     Serial.println("\n--- BMS DATA REPORT (ESP32) ---");
+    Serial.print("Sweep #"); Serial.print(snap.sequence); 
+    Serial.print(" @ "); Serial.print((uint32_t)(snap.timestampUs / 1000u)); Serial.print(" ms");
+    Serial.print("  veraltet: 0x"); Serial.println(bms_communication_getSubscription(_bms1) & ~snap.freshGroups, HEX);
     
-    
-    Serial.print("Gesamtspannung: "); Serial.print(bms_communication_getTotalVoltage(_bms1)); Serial.println(" mV"); 
-    Serial.print("Gesamtstrom:    "); Serial.print(bms_communication_getTotalCurrent(_bms1)); Serial.println(" mA"); 
+    Serial.print("Gesamtspannung: "); Serial.print(snap.totalVoltage); Serial.println(" mV"); 
+    Serial.print("Gesamtstrom:    "); Serial.print(snap.totalCurrent); Serial.println(" mA"); 
 
-    Serial.print("Volle Kap.:     "); Serial.print(bms_communication_getFullCapacity(_bms1)); Serial.println(" mAH"); 
-    Serial.print("Restkapazität:  "); Serial.print(bms_communication_getRemainingCapacity(_bms1)); Serial.println(" mAH"); 
+    Serial.print("Volle Kap.:     "); Serial.print(snap.fullCapacity); Serial.println(" mAH"); 
+    Serial.print("Restkapazität:  "); Serial.print(snap.remainingCapacity); Serial.println(" mAH"); 
 
-    Serial.print("Temp Max:       "); Serial.print(bms_communication_getMaxTemperature(_bms1)); Serial.println(" °C"); 
-    Serial.print("Temp Min:       "); Serial.print(bms_communication_getMinTemperature(_bms1)); Serial.println(" °C"); 
+    Serial.print("Temp Max:       "); Serial.print(snap.maxTemperature); Serial.println(" °C"); 
+    Serial.print("Temp Min:       "); Serial.print(snap.minTemperature); Serial.println(" °C"); 
 
-    Serial.print("Alarm Status:   A:0x"); Serial.print(bms_communication_getAlarmStatusA(_bms1), HEX); 
-    Serial.print(" B:0x"); Serial.println(bms_communication_getAlarmStatusB(_bms1), HEX); 
-    Serial.print("Protection:     A:0x"); Serial.print(bms_communication_getProtectA(_bms1), HEX); 
-    Serial.print(" B:0x"); Serial.println(bms_communication_getProtectB(_bms1), HEX); 
+    Serial.print("Alarm Status:   A:0x"); Serial.print(snap.alarmStatusA, HEX); 
+    Serial.print(" B:0x"); Serial.println(snap.alarmStatusB, HEX); 
+    Serial.print("Protection:     A:0x"); Serial.print(snap.protectA, HEX); 
+    Serial.print(" B:0x"); Serial.println(snap.protectB, HEX); 
 
     Serial.println("Zellspannungen:");
-    for (uint8_t i = 0; i < 16; i++) 
+    for (uint8_t i = 0; i < BMS_CELL_COUNT; i++) 
     {
-        uint16_t volt = bms_communication_getCellVoltage(_bms1, i); 
         Serial.print("  C"); Serial.print(i + 1); Serial.print(": ");
-        Serial.print(volt); Serial.print(" mV");
+        Serial.print(snap.cellVoltage[i]); Serial.print(" mV");
         
         if ((i + 1) % 4 == 0) Serial.println(); else Serial.print(" | ");
     }
+    Serial.print("  Min C"); Serial.print(snap.cellStats.minIndex + 1); Serial.print(" "); Serial.print(snap.cellStats.min);
+    Serial.print("  Max C"); Serial.print(snap.cellStats.maxIndex + 1); Serial.print(" "); Serial.print(snap.cellStats.max);
+    Serial.print("  Mittel "); Serial.print(snap.cellStats.mean); Serial.print("  Spreizung "); Serial.print(snap.cellStats.spread);
+    Serial.println(snap.cellStats.consistent ? " mV" : " mV (weicht vom BMS ab)");
+    Serial.print("CAN RX Ring:    HWM "); Serial.print(spsc_ring_getHighWater(_rxRing));
+    Serial.print(" / "); Serial.print(CAN_RX_RING_SIZE);
+    Serial.print("  Drops "); Serial.println(spsc_ring_getDropCount(_rxRing));
+    Serial.print("Fremde Frames:  "); Serial.print(bms_bus_getForeignCount(bms_communication_getBus(_bms1)));
+    Serial.print("  Bus-Off "); Serial.print(bms_bus_getBusOffCount(bms_communication_getBus(_bms1)));
+    Serial.print("  TX-Fehler "); Serial.println(bms_communication_getTxErrorCount(_bms1));
+    Serial.print("Sweep:          "); Serial.print(bms_communication_getSweepTime(_bms1));
+    Serial.print(" us  Bus "); Serial.print(bms_bus_getSweepTime(bms_communication_getBus(_bms1))); Serial.println(" us");
+    Serial.print("Lesezugriffe:   Konflikte "); Serial.print(bms_communication_getReadContentionCount(_bms1));
+    Serial.print("  Wiederholungen "); Serial.println(bms_communication_getReadRetryCount(_bms1));
+    _logTask(C_MODULE_NAME);
+    _logTask("Report");
+    _logLoad();
     Serial.println("-------------------------------");
 }
 /***************************************************************************
- * This function
+ * This function prints the newest closed interval of a rollup level.
  **************************************************************************/
-static void _setupBmsCom(void)
+static void _logRollup(bms_rollup_level_t level)
 {
-    twai_general_config_t g_config = TWAI_GENERAL_CONFIG_DEFAULT(CAN_TX_PIN, CAN_RX_PIN, TWAI_MODE_NORMAL);
-    twai_timing_config_t t_config = TWAI_TIMING_CONFIG_500KBITS(); 
-    twai_filter_config_t f_config = TWAI_FILTER_CONFIG_ACCEPT_ALL();
+    bms_rollup_entry_t entry;
+    uint32_t count = bms_rollup_getCount(_rollup1, level);
 
-    if (twai_driver_install(&g_config, &t_config, &f_config) == ESP_OK) 
+    if(count == 0 || !bms_rollup_getEntry(_rollup1, level, count - 1u, &entry))
     {
-        twai_start();
+        return;
+    }
+
+    const bms_rollup_stat_t* voltage = &entry.field[E_BMS_ROLLUP_TOTAL_VOLTAGE];
+    const bms_rollup_stat_t* current = &entry.field[E_BMS_ROLLUP_TOTAL_CURRENT];
+    Serial.print("Rollup @ "); Serial.print((uint32_t)(entry.startUs / 1000000u)); Serial.print(" s, ");
+    Serial.print(entry.count); Serial.print(" Sweeps  U ");
+    Serial.print(voltage->min); Serial.print("/"); Serial.print(voltage->mean); Serial.print("/"); Serial.print(voltage->max);
+    Serial.print(" mV  I "); 
+    Serial.print(current->min); Serial.print("/"); Serial.print(current->mean); Serial.print("/"); Serial.print(current->max);
+    Serial.println(" mA");
+}
+/***************************************************************************
+ * This function prints the timing of a background task, the execution 
+ * times only in builds with BG_TASK_PROFILING.
+ **************************************************************************/
+static void _logTask(char const* name)
+{
+    bg_task_stats_t stats;
+    bg_task_profile_t profile;
+
+    if(!bg_task_getStats(name, &stats))
+    {
+        return;
+    }
+    Serial.print("Task "); Serial.print(name); 
+    Serial.print(":  Verspätung "); Serial.print(stats.lastLatenessUs);
+    Serial.print(" us  Max "); Serial.print(stats.maxLatenessUs);
+    Serial.print(" us  Verpasst "); Serial.println(stats.missed);
+
+    if(bg_task_getProfile(name, &profile))
+    {
+        Serial.print("  Laufzeit "); Serial.print(profile.minNs / 1000u);
+        Serial.print("/"); Serial.print(profile.meanNs / 1000u);
+        Serial.print("/"); Serial.print(profile.maxNs / 1000u);
+        Serial.print(" us  Aufrufe "); Serial.print(profile.calls);
+        Serial.print("  Überläufe "); Serial.println(profile.overruns);
+    }
+}
+/***************************************************************************
+ * This function prints how busy the executor threads were since the last
+ * report. The rest of the time they were blocked and the cores idle.
+ **************************************************************************/
+static void _logLoad(void)
+{
+    if(!bg_executor_isRunning())
+    {
+        return;
     }
 
+    bg_executor_load_t load;
+    Serial.print("CPU-Last:       ");
+    for(uint8_t prio = 0; prio < E_BG_TASK_PRIO_COUNT; prio++)
+    {
+        bg_executor_getLoad((bg_task_prio_t)prio, &load);
+        uint16_t duty = bg_executor_getDutyCycle(&_lastLoad[prio], &load);
+        _lastLoad[prio] = load;
+
+        Serial.print("P"); Serial.print(prio); Serial.print(" ");
+        Serial.print(duty / 10u); Serial.print("."); Serial.print(duty % 10u); Serial.print(" %  ");
+    }
+    Serial.println();
+}
+/***************************************************************************
+ * This function is called at decode time whenever an alarm or protect bit
+ * flips, without waiting for the next report.
+ **************************************************************************/
+static void _onProtectionEvent(bms_com_t* bms, bms_field_t field, uint8_t index, int32_t value, void* context)
+{
+    (void)bms;
+    (void)index;
+    (void)context;
+
+    Serial.print(field <= E_BMS_FIELD_ALARM_STATUS_B ? "ALARM " : "PROTECT ");
+    Serial.print((field == E_BMS_FIELD_ALARM_STATUS_A || field == E_BMS_FIELD_PROTECT_A) ? "A: 0x" : "B: 0x");
+    Serial.println((uint16_t)value, HEX);
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+static void _setupBmsCom(void)
+{
+    // frames are handed over one at a time by the TX task, completion is signalled by alerts
+    _twaiGeneral.tx_queue_len = 0;
+    _twaiGeneral.alerts_enabled = TWAI_ALERT_TX_SUCCESS | TWAI_ALERT_TX_FAILED | TWAI_ALERT_BUS_OFF | TWAI_ALERT_BUS_RECOVERED;
+
+    _rxRing = spsc_ring_new(_rxBuffer, sizeof(can_frame_t), CAN_RX_RING_SIZE);
+    _txRing = spsc_ring_new(_txBuffer, sizeof(can_frame_t), CAN_TX_RING_SIZE);
+    _txStatusRing = spsc_ring_new(_txStatusBuffer, sizeof(can_tx_status_t), CAN_TX_RING_SIZE);
+    _driverLock = xSemaphoreCreateMutex();
+    _driverParked = xSemaphoreCreateCounting(CAN_DRIVER_TASKS, 0);
+    _driverResume = xSemaphoreCreateCounting(CAN_DRIVER_TASKS, 0);
+    assert(_rxRing && _txRing && _txStatusRing && _driverLock && _driverParked && _driverResume);
+
     _bmsInit1.halHandle = NULL; 
     _bmsInit1.comRead = (com_read_t)_can_read;
     _bmsInit1.comWrite = (com_write_t)_can_write;
     _bmsInit1.comOpen = NULL;
     _bmsInit1.comClose = NULL;
+    _bmsInit1.comTime = _can_time;
+    _bmsInit1.comTxStatus = _can_txStatus;
+    _bmsInit1.comSetFilter = _can_setFilter;
+    _bmsInit1.comWriteBatch = _can_writeBatch;
+    _bmsInit1.comReadBatch = _can_readBatch;
+    _bmsInit1.comBusOffCount = _can_busOffCount;
 
+    // registering the instances first lets the driver start with their acceptance filter
     _bms1 = bms_communication_new(&_bmsInit1, _bms1Id);
+    bms_communication_setPipelineDepth(_bms1, BMS_PIPELINE_DEPTH);
+    _history1 = bms_history_new(_bms1, BMS_HISTORY_PERIOD_MS);
+    _rollup1 = bms_rollup_new(_bms1);
+    bms_communication_addObserver(_bms1, E_BMS_FIELD_ALARM_STATUS_A, E_BMS_DEADBAND_ABSOLUTE, 0, _onProtectionEvent, NULL);
+    bms_communication_addObserver(_bms1, E_BMS_FIELD_ALARM_STATUS_B, E_BMS_DEADBAND_ABSOLUTE, 0, _onProtectionEvent, NULL);
+    bms_communication_addObserver(_bms1, E_BMS_FIELD_PROTECT_A, E_BMS_DEADBAND_ABSOLUTE, 0, _onProtectionEvent, NULL);
+    bms_communication_addObserver(_bms1, E_BMS_FIELD_PROTECT_B, E_BMS_DEADBAND_ABSOLUTE, 0, _onProtectionEvent, NULL);
+
+    if (twai_driver_install(&_twaiGeneral, &_twaiTiming, &_twaiFilter) == ESP_OK) 
+    {
+        twai_start();
+        _driverInstalled = true;
+        xTaskCreatePinnedToCore(_canRxTask, "can_rx", CAN_RX_TASK_STACK, NULL, CAN_RX_TASK_PRIO, NULL, CAN_RX_TASK_CORE);
+        xTaskCreatePinnedToCore(_canTxTask, "can_tx", CAN_TX_TASK_STACK, NULL, CAN_TX_TASK_PRIO, &_txTask, CAN_TX_TASK_CORE);
+    }
 }
 
 /***************************************************************************
- * This function
+ * This function hands one frame to the controller and waits until it left
+ * the mailbox. Only called by the TX task, which owns the TWAI alerts.
  **************************************************************************/
-hal_status_t _can_write(void* handle, void* data, uint8_t length)
+static hal_status_t _canTransmit(const can_frame_t* frame)
 {
-    can_frame_t* frame = (can_frame_t*)data;
     twai_message_t tx_msg = {0}; 
+    twai_status_info_t info;
+    uint32_t alerts = 0;
 
     tx_msg.identifier = (frame->id & 0x1FFFFFFF); 
     tx_msg.extd = 1;               
@@ -124,38 +360,327 @@ hal_status_t _can_write(void* handle, void* data, uint8_t length)
         tx_msg.data[i] = frame->data[i];
     }
 
-    if (twai_transmit(&tx_msg, pdMS_TO_TICKS(10)) == ESP_OK) 
+    // a frame that timed out before may still complete, its latched alert must not be taken for this one
+    if (twai_get_status_info(&info) == ESP_OK && info.msgs_to_tx > 0)
+    {
+        twai_read_alerts(&alerts, pdMS_TO_TICKS(CAN_TX_TIMEOUT_MS));
+    }
+    twai_read_alerts(&alerts, 0);
+
+    if (twai_transmit(&tx_msg, 0) != ESP_OK) 
+    {
+        // a recovery that did not finish before is continued with the next frame
+        if (twai_get_status_info(&info) == ESP_OK)
+        {
+            if (info.state == TWAI_STATE_BUS_OFF)
+            {
+                _recoverBusOff();
+            }
+            else if (info.state == TWAI_STATE_STOPPED)
+            {
+                twai_start();
+            }
+        }
+        return E_HAL_STATUS_ERROR;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    while ((xTaskGetTickCount() - start) < pdMS_TO_TICKS(CAN_TX_TIMEOUT_MS))
+    {
+        if (twai_read_alerts(&alerts, pdMS_TO_TICKS(CAN_TX_TIMEOUT_MS)) != ESP_OK)
+        {
+            break;
+        }
+        if (alerts & TWAI_ALERT_TX_SUCCESS)
+        {
+            return E_HAL_STATUS_OK;
+        }
+        if (alerts & TWAI_ALERT_BUS_OFF)
+        {
+            _recoverBusOff();
+            return E_HAL_STATUS_ERROR;
+        }
+        if (alerts & TWAI_ALERT_TX_FAILED)
+        {
+            return E_HAL_STATUS_ERROR;
+        }
+    }
+    return E_HAL_STATUS_TIMEOUT;
+}
+
+/***************************************************************************
+ * This function brings the controller back from bus-off: it waits for the
+ * recovery sequence to finish and restarts the driver. The event is 
+ * counted for the BMS layer, which drops the requests that were in 
+ * flight. Only called by the TX task, which owns the TWAI alerts.
+ **************************************************************************/
+static void _recoverBusOff(void)
+{
+    uint32_t alerts = 0;
+
+    __atomic_store_n(&_busOffCount, _busOffCount + 1u, __ATOMIC_RELEASE);
+    Serial.println("CAN Bus-Off, Recovery");
+
+    if (twai_initiate_recovery() != ESP_OK)
+    {
+        return;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    while ((xTaskGetTickCount() - start) < pdMS_TO_TICKS(CAN_RECOVERY_TIMEOUT_MS))
+    {
+        if (twai_read_alerts(&alerts, pdMS_TO_TICKS(CAN_RECOVERY_TIMEOUT_MS)) == ESP_OK &&
+            (alerts & TWAI_ALERT_BUS_RECOVERED))
+        {
+            twai_start();
+            return;
+        }
+    }
+}
+
+/***************************************************************************
+ * This function is the consumer of the TX ring and the producer of the 
+ * TX status ring. It sleeps until _can_write queues a frame.
+ **************************************************************************/
+static void _canTxTask(void* arg)
+{
+    can_frame_t frame;
+    can_tx_status_t txStatus;
+
+    for(;;)
+    {
+        _parkDriverTask();
+        if (!spsc_ring_pop(_txRing, &frame))
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        txStatus.id = frame.id;
+        txStatus.status = _canTransmit(&frame);
+        spsc_ring_push(_txStatusRing, &txStatus);
+        _wakeCyclic();
+    }
+}
+
+/***************************************************************************
+ * This function queues the frames for the TX task, it never blocks. 
+ * Completion is reported through _can_txStatus.
+ **************************************************************************/
+hal_status_t _can_write(void* handle, void* data, uint8_t length)
+{
+    can_frame_t* frames = (can_frame_t*)data;
+
+    // only this function produces, so free space can only grow until the push
+    if ((CAN_TX_RING_SIZE - spsc_ring_getCount(_txRing)) < length)
+    {
+        return E_HAL_STATUS_BUSY;
+    }
+    if (_txTask == NULL)
+    {
+        return E_HAL_STATUS_ERROR;
+    }
+    for (uint8_t i = 0; i < length; i++)
+    {
+        spsc_ring_push(_txRing, &frames[i]);
+    }
+    xTaskNotifyGive(_txTask);
+    return E_HAL_STATUS_OK;
+}
+
+/***************************************************************************
+ * This function queues as many of the frames as the TX ring has room for
+ * and wakes the TX task once. It never blocks.
+ **************************************************************************/
+hal_status_t _can_writeBatch(void* handle, const can_frame_t* frames, uint16_t count, uint16_t* done)
+{
+    *done = 0;
+    if (_txTask == NULL)
+    {
+        return E_HAL_STATUS_ERROR;
+    }
+    *done = (uint16_t)spsc_ring_pushBatch(_txRing, frames, count);
+    if (*done > 0)
+    {
+        xTaskNotifyGive(_txTask);
+    }
+    return (*done == count) ? E_HAL_STATUS_OK : E_HAL_STATUS_BUSY;
+}
+
+/***************************************************************************
+ * This function returns the bus-off events the TX task recovered from.
+ **************************************************************************/
+uint32_t _can_busOffCount(void* handle)
+{
+    return __atomic_load_n(&_busOffCount, __ATOMIC_ACQUIRE);
+}
+
+/***************************************************************************
+ * This function pops one transmit completion, it never blocks.
+ **************************************************************************/
+hal_status_t _can_txStatus(void* handle, can_tx_status_t* txStatus)
+{
+    if (spsc_ring_pop(_txStatusRing, txStatus)) 
     {
         return E_HAL_STATUS_OK;
     }
-    return E_HAL_STATUS_ERROR;
+    return E_HAL_STATUS_BUSY; 
 }
 
 /***************************************************************************
- * This function
+ * This function parks the calling driver task while a filter change 
+ * reinstalls the driver. The task confirms that it stopped using TWAI and
+ * blocks until the change is done. Outside of a change it returns at once.
  **************************************************************************/
-hal_status_t _can_read(void* handle, void* data)
+static void _parkDriverTask(void)
 {
-    can_frame_t* target = (can_frame_t*)data;
-    twai_message_t rx_msg;
+    if (__atomic_load_n(&_driverPaused, __ATOMIC_ACQUIRE))
+    {
+        xSemaphoreGive(_driverParked);
+        xSemaphoreTake(_driverResume, portMAX_DELAY);
+    }
+}
 
+/***************************************************************************
+ * This function is the only producer of the RX ring. It blocks on the 
+ * TWAI driver so that the main loop never has to, and hands the frames of
+ * a burst over with one batch push.
+ **************************************************************************/
+static void _canRxTask(void* arg)
+{
+    twai_message_t rx_msg;
+    can_frame_t frames[CAN_RX_BURST];
 
-    if (twai_receive(&rx_msg, pdMS_TO_TICKS(20)) == ESP_OK) 
+    for(;;)
     {
-        if (!(rx_msg.rtr)) 
+        uint16_t count = 0;
+
+        // after the first frame the rest of a burst is taken without waiting
+        _parkDriverTask();
+        esp_err_t err = twai_receive(&rx_msg, pdMS_TO_TICKS(CAN_RX_POLL_MS));
+        if (err != ESP_OK && err != ESP_ERR_TIMEOUT)
+        {
+            vTaskDelay(pdMS_TO_TICKS(CAN_RX_POLL_MS));     // driver not running, e.g. a failed reinstall
+        }
+        while (err == ESP_OK)
         {
-            target->id = rx_msg.identifier;
-            target->length = rx_msg.data_length_code;
-            
-            for (int i = 0; i < rx_msg.data_length_code; i++) {
-                target->data[i] = rx_msg.data[i];
+            if (!(rx_msg.rtr))
+            {
+                frames[count].id = rx_msg.identifier;
+                frames[count].length = rx_msg.data_length_code;
+
+                for (int i = 0; i < rx_msg.data_length_code; i++) {
+                    frames[count].data[i] = rx_msg.data[i];
+                }
+                count++;
             }
-            return E_HAL_STATUS_OK;
+            if (count == CAN_RX_BURST)
+            {
+                break;
+            }
+            err = twai_receive(&rx_msg, 0);
         }
+
+        if (count > 0)
+        {
+            // frames that do not fit are pushed one by one so the ring counts them as dropped
+            for (uint32_t i = spsc_ring_pushBatch(_rxRing, frames, count); i < count; i++)
+            {
+                spsc_ring_push(_rxRing, &frames[i]);
+            }
+            _wakeCyclic();
+        }
+    }
+}
+
+/***************************************************************************
+ * This function pops one received frame, it never blocks.
+ **************************************************************************/
+hal_status_t _can_read(void* handle, void* data)
+{
+    if (spsc_ring_pop(_rxRing, data)) 
+    {
+        return E_HAL_STATUS_OK;
     }
     return E_HAL_STATUS_BUSY; 
 }
 
+/***************************************************************************
+ * This function pops up to count received frames, it never blocks.
+ **************************************************************************/
+hal_status_t _can_readBatch(void* handle, can_frame_t* frames, uint16_t count, uint16_t* done)
+{
+    *done = (uint16_t)spsc_ring_popBatch(_rxRing, frames, count);
+    return (*done > 0) ? E_HAL_STATUS_OK : E_HAL_STATUS_BUSY;
+}
+
+/***************************************************************************
+ * This function converts the acceptance filter of the bus (a set bit in 
+ * mask has to match) into a single TWAI filter for extended frames. The 
+ * filter of the legacy driver can only be changed by reinstalling it. The
+ * driver tasks are asked to park and the driver is only touched once both
+ * confirmed, which takes at most one RX poll or one transmission.
+ **************************************************************************/
+hal_status_t _can_setFilter(void* handle, uint32_t code, uint32_t mask)
+{
+    _twaiFilter.acceptance_code = (code & 0x1FFFFFFF) << 3;
+    _twaiFilter.acceptance_mask = ~((mask & 0x1FFFFFFF) << 3);    // TWAI: set bit = don't care, RTR included
+    _twaiFilter.single_filter = true;
+
+    if (_txTask == NULL)
+    {
+        return E_HAL_STATUS_OK;     // the driver tasks are not started yet, the filter is used by the first install
+    }
+
+    hal_status_t retval = E_HAL_STATUS_ERROR;
+
+    xSemaphoreTake(_driverLock, portMAX_DELAY);
+    __atomic_store_n(&_driverPaused, true, __ATOMIC_RELEASE);
+    xTaskNotifyGive(_txTask);      // a TX task waiting for frames parks right away
+    for (uint8_t i = 0; i < CAN_DRIVER_TASKS; i++)
+    {
+        xSemaphoreTake(_driverParked, portMAX_DELAY);
+    }
+
+    // a driver that failed to come back last time is installed again
+    if (_driverInstalled)
+    {
+        twai_stop();                // fails if the driver is already stopped, e.g. after bus-off
+        _driverInstalled = (twai_driver_uninstall() != ESP_OK);
+    }
+    if (!_driverInstalled && twai_driver_install(&_twaiGeneral, &_twaiTiming, &_twaiFilter) == ESP_OK)
+    {
+        _driverInstalled = true;
+        if (twai_start() == ESP_OK)
+        {
+            retval = E_HAL_STATUS_OK;
+        }
+    }
+
+    __atomic_store_n(&_driverPaused, false, __ATOMIC_RELEASE);
+    for (uint8_t i = 0; i < CAN_DRIVER_TASKS; i++)
+    {
+        xSemaphoreGive(_driverResume);
+    }
+    xSemaphoreGive(_driverLock);
+    return retval;
+}
+
+/***************************************************************************
+ * This function
+ **************************************************************************/
+uint64_t _can_time(void)
+{
+    return (uint64_t)esp_timer_get_time();
+}
+
+/***************************************************************************
+ * This function
+ **************************************************************************/
+static uint32_t _cycleCount(void)
+{
+    return ESP.getCycleCount();
+}
+
 /*=============================== PUBLIC ===========================================*/
 /***************************************************************************
  * This function
@@ -165,10 +690,19 @@ void app_init(void)
     if(!_initialized)
     {
         bg_task_init();
-        bg_task_add(_cyclic, C_MODULE_NAME, E_BG_TASK_PRIO_LOW);
+        bg_task_setTimeSource(_can_time);
+        bg_task_setCycleCounter(_cycleCount, getCpuFrequencyMhz());
+        _cyclicTask = bg_task_add(_cyclic, C_MODULE_NAME, E_BG_TASK_PRIO_HIGH, BMS_CYCLIC_PERIOD_MS, 0);
+        bg_task_add(_report, "Report", E_BG_TASK_PRIO_LOW, LOG_INTERVAL_MS, LOG_OFFSET_MS);
+        spsc_ring_init();
         bms_communication_init();
+        bms_history_init();
+        bms_rollup_init();
 
         _setupBmsCom();
         _initialized = true;
+#if APP_USE_EXECUTOR
+        bg_executor_start(C_EXECUTOR_CONFIG);
+#endif
     }
 }
\ No newline at end of file
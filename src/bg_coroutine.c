@@ -0,0 +1,194 @@
+/**************************************************************************
+bg_coroutine.c
+ Created on: Mar 20, 2026
+     Author: M. Schermutzki
+***************************************************************************/
+/* Runs stackless coroutines as bg_task tasks. A coroutine that waits for a
+ * timeout asks bg_task to wake it at the deadline, one that waits for a
+ * signal is woken by bg_co_signal_raise, so neither has to poll. A task
+ * period still resumes it to check conditions nobody signals. */
+/*** includes *************************************************************/
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+#include "bg_coroutine.h"
+#include "bg_task.h"
+/*** local constants ******************************************************/
+#ifndef BG_CO_MAX
+#define BG_CO_MAX       (8)     // set with -DBG_CO_MAX=n
+#endif
+#define C_BG_CO_MAX     (BG_CO_MAX)
+/*** structures ***********************************************************/
+/*** macros ***************************************************************/
+#define LOAD_ACQUIRE(ptr)           __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(ptr, val)     __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#define FETCH_ADD(ptr, val)         __atomic_fetch_add((ptr), (val), __ATOMIC_ACQ_REL)
+/*** local variables ******************************************************/
+static bool _initialized = false;
+static bg_co_t _coroutines[C_BG_CO_MAX];
+/*** prototypes ***********************************************************/
+static void _run(void* context);
+/*** interrupt service routines *******************************************/
+/*** functions ************************************************************/
+/***************************************************************************
+ * This function is the bg_task of a coroutine. It resumes the coroutine
+ * and lets the task sleep until the deadline of a timeout it waits for.
+ **************************************************************************/
+static void _run(void* context)
+{
+    bg_co_t* co = (bg_co_t*)context;
+    bg_task_time_t time = bg_task_getTimeSource();
+
+    if(bg_co_resume(co, (time != NULL) ? time() : 0) == E_BG_CO_DONE)
+    {
+        bg_task_remove(co->task);
+        co->task = NULL;
+        co->fn = NULL;
+    }
+    else if(co->deadline != UINT64_MAX)
+    {
+        bg_task_wakeAt(co->task, co->deadline);
+    }
+}
+/*=============================== PUBLIC ===========================================*/
+/***************************************************************************
+ * This function starts a coroutine as bg_task task. It is resumed every
+ * periodMs, at the deadline of a timeout and when a signal it waits for
+ * is raised. A periodMs of zero resumes it on every pass. Returns NULL if
+ * no coroutine or task is free.
+ **************************************************************************/
+bg_co_t* bg_co_start(bg_co_fn_t fn, void* context, char const* name, bg_task_prio_t prio, uint32_t periodMs)
+{
+    assert(_initialized);
+    assert(fn);
+
+    for(uint32_t i = 0; i < C_BG_CO_MAX; i++)
+    {
+        bg_co_t* co = &_coroutines[i];
+
+        if(co->fn == NULL)
+        {
+            bg_co_setup(co, fn, context);
+            co->task = bg_task_addContext(_run, co, name, prio, periodMs, 0);
+            if(co->task == NULL)
+            {
+                co->fn = NULL;
+                return NULL;
+            }
+            return co;
+        }
+    }
+    return NULL;
+}
+/***************************************************************************
+ * This function stops a coroutine started with bg_co_start. A coroutine
+ * ends itself with BG_CO_EXIT instead.
+ **************************************************************************/
+void bg_co_stop(bg_co_t* co)
+{
+    assert(_initialized);
+    assert(co);
+    assert(co->task);
+
+    bg_task_remove(co->task);
+    co->task = NULL;
+    co->fn = NULL;
+}
+/***************************************************************************
+ * This function prepares a coroutine that is resumed by hand.
+ **************************************************************************/
+void bg_co_setup(bg_co_t* co, bg_co_fn_t fn, void* context)
+{
+    assert(co);
+    assert(fn);
+
+    memset(co, 0, sizeof(bg_co_t));
+    co->deadline = UINT64_MAX;
+    co->fn = fn;
+    co->context = context;
+}
+/***************************************************************************
+ * This function runs the coroutine up to its next await that is not
+ * satisfied, now is the time its timeouts are measured against.
+ **************************************************************************/
+bg_co_status_t bg_co_resume(bg_co_t* co, uint64_t now)
+{
+    assert(co);
+    assert(co->fn);
+
+    co->now = now;
+    return co->fn(co);
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+void bg_co_signal_init(bg_co_signal_t* signal)
+{
+    assert(signal);
+
+    memset(signal, 0, sizeof(bg_co_signal_t));
+}
+/***************************************************************************
+ * This function raises the signal and wakes the coroutine task waiting on
+ * it. Every raise is taken once, it may be called from any thread.
+ **************************************************************************/
+void bg_co_signal_raise(bg_co_signal_t* signal)
+{
+    assert(signal);
+
+    FETCH_ADD(&signal->count, 1u);
+
+    bg_task_handle_t* waiter = LOAD_ACQUIRE(&signal->waiter);
+    if(waiter != NULL)
+    {
+        bg_task_wake(waiter);
+    }
+}
+/***************************************************************************
+ * This function takes one raise of the signal, false if there is none.
+ * The task of the coroutine is remembered to be woken by the next raise.
+ **************************************************************************/
+bool bg_co_signal_take(bg_co_signal_t* signal, bg_co_t* co)
+{
+    assert(signal);
+    assert(co);
+
+    STORE_RELEASE(&signal->waiter, co->task);
+
+    uint32_t count = LOAD_ACQUIRE(&signal->count);
+    while(count != 0)
+    {
+        if(__atomic_compare_exchange_n(&signal->count, &count, count - 1u, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+/***************************************************************************
+ * This function stops all coroutines, bg_task is expected to be still
+ * initialized.
+ **************************************************************************/
+void bg_co_deinit(void)
+{
+    for(uint32_t i = 0; i < C_BG_CO_MAX; i++)
+    {
+        if(_coroutines[i].task != NULL)
+        {
+            bg_co_stop(&_coroutines[i]);
+        }
+    }
+    _initialized = false;
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+void bg_co_init(void)
+{
+    if(_initialized)
+    {
+        return;
+    }
+    memset(_coroutines, 0, sizeof(_coroutines));
+    _initialized = true;
+}
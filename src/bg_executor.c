@@ -0,0 +1,358 @@
+/**************************************************************************
+bg_executor.c
+ Created on: Mar 18, 2026
+     Author: M. Schermutzki
+***************************************************************************/
+/* Runs every bg_task priority in a thread of its own: a pinned FreeRTOS
+ * task on the ESP32, a pthread on the host. The threads share the task 
+ * lists of bg_task through its lock hooks. Between passes a thread blocks
+ * until its next task is due or bg_task notifies it of an earlier one. */
+#ifndef ESP_PLATFORM
+#define _POSIX_C_SOURCE 200809L
+#endif
+/*** includes *************************************************************/
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "bg_executor.h"
+#include "bg_task.h"
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#endif
+/*** local constants ******************************************************/
+#ifndef BG_EXECUTOR_MAX_WAIT_MS
+#define BG_EXECUTOR_MAX_WAIT_MS     (1000)  // longest a thread blocks, covers a time source that jumps
+#endif
+#define C_MAX_WAIT_US               ((uint64_t)BG_EXECUTOR_MAX_WAIT_MS * 1000u)
+/*** structures ***********************************************************/
+/*** macros ***************************************************************/
+#define LOAD_ACQUIRE(ptr)           __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define LOAD_RELAXED(ptr)           __atomic_load_n((ptr), __ATOMIC_RELAXED)
+#define STORE_RELEASE(ptr, val)     __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#define FETCH_ADD(ptr, val)         __atomic_fetch_add((ptr), (val), __ATOMIC_RELAXED)
+#define FETCH_SUB(ptr, val)         __atomic_fetch_sub((ptr), (val), __ATOMIC_ACQ_REL)
+/*** local variables ******************************************************/
+static bool _running = false;
+static uint32_t _active = 0;
+static bg_task_time_t _time = NULL;
+static bg_executor_load_t _load[E_BG_TASK_PRIO_COUNT];
+#ifdef ESP_PLATFORM
+static SemaphoreHandle_t _mutex = NULL;
+static TaskHandle_t _threads[E_BG_TASK_PRIO_COUNT];
+static char const* const C_THREAD_NAME[E_BG_TASK_PRIO_COUNT] = { "bg_low", "bg_mid", "bg_high" };
+#else
+static pthread_mutex_t _mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t _waitMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _wakeup[E_BG_TASK_PRIO_COUNT];
+static bool _notified[E_BG_TASK_PRIO_COUNT];
+static pthread_t _threads[E_BG_TASK_PRIO_COUNT];
+static bool _started[E_BG_TASK_PRIO_COUNT];
+#endif
+/*** prototypes ***********************************************************/
+static void _lock(void);
+static void _unlock(void);
+static void _notify(bg_task_prio_t prio);
+static uint64_t _now(void);
+static void _wait(bg_task_prio_t prio, uint64_t delayUs);
+#ifdef ESP_PLATFORM
+static void _thread(void* arg);
+#else
+static void* _thread(void* arg);
+#endif
+/*** interrupt service routines *******************************************/
+/*** functions ************************************************************/
+/*=============================== PRIVATE ==========================================*/
+/***************************************************************************
+ * This function
+ **************************************************************************/
+static void _lock(void)
+{
+#ifdef ESP_PLATFORM
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+#else
+    pthread_mutex_lock(&_mutex);
+#endif
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+static void _unlock(void)
+{
+#ifdef ESP_PLATFORM
+    xSemaphoreGive(_mutex);
+#else
+    pthread_mutex_unlock(&_mutex);
+#endif
+}
+/***************************************************************************
+ * This function wakes the thread of a priority, a notification that 
+ * arrives while it runs makes its next wait return at once.
+ **************************************************************************/
+static void _notify(bg_task_prio_t prio)
+{
+#ifdef ESP_PLATFORM
+    if(_threads[prio] != NULL)
+    {
+        xTaskNotifyGive(_threads[prio]);
+    }
+#else
+    pthread_mutex_lock(&_waitMutex);
+    _notified[prio] = true;
+    pthread_cond_signal(&_wakeup[prio]);
+    pthread_mutex_unlock(&_waitMutex);
+#endif
+}
+/***************************************************************************
+ * This function returns the time of the bg_task time source, a monotonic
+ * clock if none is set.
+ **************************************************************************/
+static uint64_t _now(void)
+{
+    if(_time != NULL)
+    {
+        return _time();
+    }
+#ifdef ESP_PLATFORM
+    return (uint64_t)xTaskGetTickCount() * portTICK_PERIOD_MS * 1000u;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+#endif
+}
+/***************************************************************************
+ * This function blocks the thread of a priority for delayUs or until it 
+ * is notified. A delay of zero means a task is already due, the thread 
+ * only clears its notification and yields. On the ESP32 a future 
+ * deadline blocks for at least one tick, so the idle task gets to run and
+ * halts the core until the next interrupt.
+ **************************************************************************/
+static void _wait(bg_task_prio_t prio, uint64_t delayUs)
+{
+#ifdef ESP_PLATFORM
+    (void)prio;
+    if(delayUs == 0)
+    {
+        ulTaskNotifyTake(pdTRUE, 0);
+        taskYIELD();
+        return;
+    }
+    TickType_t ticks = pdMS_TO_TICKS((uint32_t)((delayUs + 999u) / 1000u));
+    ulTaskNotifyTake(pdTRUE, (ticks > 0) ? ticks : 1);
+#else
+    struct timespec until;
+    clock_gettime(CLOCK_MONOTONIC, &until);
+    until.tv_sec += (time_t)(delayUs / 1000000u);
+    until.tv_nsec += (long)(delayUs % 1000000u) * 1000L;
+    if(until.tv_nsec >= 1000000000L)
+    {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&_waitMutex);
+    while(!_notified[prio] && delayUs > 0)
+    {
+        if(pthread_cond_timedwait(&_wakeup[prio], &_waitMutex, &until) != 0)
+        {
+            break;
+        }
+    }
+    _notified[prio] = false;
+    pthread_mutex_unlock(&_waitMutex);
+
+    if(delayUs == 0)
+    {
+        sched_yield();
+    }
+#endif
+}
+/***************************************************************************
+ * This function is the loop of one priority: a pass over its tasks, then 
+ * block until the next one is due. The time spent in passes and blocked
+ * is accounted for the duty cycle.
+ **************************************************************************/
+#ifdef ESP_PLATFORM
+static void _thread(void* arg)
+#else
+static void* _thread(void* arg)
+#endif
+{
+    bg_task_prio_t prio = (bg_task_prio_t)(uintptr_t)arg;
+    uint64_t start = _now();
+
+    while(LOAD_ACQUIRE(&_running))
+    {
+        bg_task_cyclicPrio(prio);
+
+        uint64_t due = bg_task_getNextDuePrio(prio);
+        uint64_t now = _now();
+        uint64_t delay = (due > now) ? due - now : 0;
+        FETCH_ADD(&_load[prio].busyUs, (uint32_t)(now - start));
+
+        _wait(prio, (delay < C_MAX_WAIT_US) ? delay : C_MAX_WAIT_US);
+
+        start = _now();
+        FETCH_ADD(&_load[prio].idleUs, (uint32_t)(start - now));
+        FETCH_ADD(&_load[prio].wakeups, 1u);
+    }
+    FETCH_SUB(&_active, 1u);
+
+#ifdef ESP_PLATFORM
+    vTaskDelete(NULL);
+#else
+    return NULL;
+#endif
+}
+/*=============================== PUBLIC ===========================================*/
+/***************************************************************************
+ * This function starts one thread per priority with a stack size. From 
+ * then on the threads run the tasks, bg_task_cyclic must not be called 
+ * anymore. bg_task_add and the other calls keep working from any thread.
+ **************************************************************************/
+bool bg_executor_start(const bg_executor_config_t config[E_BG_TASK_PRIO_COUNT])
+{
+    assert(config);
+
+    if(_running)
+    {
+        return false;
+    }
+
+    _time = bg_task_getTimeSource();
+#ifdef ESP_PLATFORM
+    if(_mutex == NULL)
+    {
+        _mutex = xSemaphoreCreateMutex();
+        if(_mutex == NULL)
+        {
+            return false;
+        }
+    }
+#else
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    for(uint32_t prio = 0; prio < E_BG_TASK_PRIO_COUNT; prio++)
+    {
+        pthread_cond_init(&_wakeup[prio], &attr);
+        _notified[prio] = false;
+    }
+    pthread_condattr_destroy(&attr);
+#endif
+    for(uint32_t prio = 0; prio < E_BG_TASK_PRIO_COUNT; prio++)
+    {
+        _load[prio] = (bg_executor_load_t){0};
+    }
+    bg_task_setLock(_lock, _unlock);
+    bg_task_setNotify(_notify);
+    STORE_RELEASE(&_running, true);
+
+    for(uint32_t prio = 0; prio < E_BG_TASK_PRIO_COUNT; prio++)
+    {
+        if(config[prio].stackSize == 0)
+        {
+            continue;
+        }
+
+        __atomic_fetch_add(&_active, 1u, __ATOMIC_ACQ_REL);
+#ifdef ESP_PLATFORM
+        BaseType_t core = (config[prio].core == BG_EXECUTOR_ANY_CORE) ? tskNO_AFFINITY : config[prio].core;
+        if(xTaskCreatePinnedToCore(_thread, C_THREAD_NAME[prio], config[prio].stackSize, (void*)(uintptr_t)prio, 
+                                   config[prio].priority, &_threads[prio], core) != pdPASS)
+        {
+            _threads[prio] = NULL;
+            FETCH_SUB(&_active, 1u);
+        }
+#else
+        _started[prio] = (pthread_create(&_threads[prio], NULL, _thread, (void*)(uintptr_t)prio) == 0);
+        if(!_started[prio])
+        {
+            FETCH_SUB(&_active, 1u);
+        }
+#endif
+    }
+    return true;
+}
+/***************************************************************************
+ * This function lets every thread finish its pass and waits for them. 
+ * Afterwards bg_task_cyclic may be called again.
+ **************************************************************************/
+void bg_executor_stop(void)
+{
+    if(!_running)
+    {
+        return;
+    }
+    STORE_RELEASE(&_running, false);
+
+    for(uint32_t prio = 0; prio < E_BG_TASK_PRIO_COUNT; prio++)
+    {
+        _notify((bg_task_prio_t)prio);
+    }
+
+#ifdef ESP_PLATFORM
+    while(LOAD_ACQUIRE(&_active) != 0)
+    {
+        vTaskDelay(1);
+    }
+    for(uint32_t prio = 0; prio < E_BG_TASK_PRIO_COUNT; prio++)
+    {
+        _threads[prio] = NULL;
+    }
+#else
+    for(uint32_t prio = 0; prio < E_BG_TASK_PRIO_COUNT; prio++)
+    {
+        if(_started[prio])
+        {
+            pthread_join(_threads[prio], NULL);
+            _started[prio] = false;
+        }
+        pthread_cond_destroy(&_wakeup[prio]);
+    }
+#endif
+    bg_task_setNotify(NULL);
+    bg_task_setLock(NULL, NULL);
+}
+/***************************************************************************
+ * This function copies the time the thread of a priority spent running 
+ * passes and blocked since the start. The counters wrap, differences 
+ * between two reads stay valid.
+ **************************************************************************/
+void bg_executor_getLoad(bg_task_prio_t prio, bg_executor_load_t* load)
+{
+    assert(prio < E_BG_TASK_PRIO_COUNT);
+    assert(load);
+
+    load->busyUs = LOAD_RELAXED(&_load[prio].busyUs);
+    load->idleUs = LOAD_RELAXED(&_load[prio].idleUs);
+    load->wakeups = LOAD_RELAXED(&_load[prio].wakeups);
+}
+/***************************************************************************
+ * This function returns the share of time the thread of a priority was 
+ * busy between two loads in per mille.
+ **************************************************************************/
+uint16_t bg_executor_getDutyCycle(const bg_executor_load_t* from, const bg_executor_load_t* to)
+{
+    assert(from);
+    assert(to);
+
+    uint32_t busy = to->busyUs - from->busyUs;
+    uint32_t idle = to->idleUs - from->idleUs;
+    uint64_t total = (uint64_t)busy + idle;
+
+    return (total != 0) ? (uint16_t)(((uint64_t)busy * 1000u) / total) : 0;
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+bool bg_executor_isRunning(void)
+{
+    return LOAD_ACQUIRE(&_running);
+}
@@ -7,69 +7,828 @@ bg_task.c
 #include <assert.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 #include "bg_task.h"
 /*** local constants ******************************************************/
-#define C_BG_TASK_MAX   (16)
+#ifndef BG_TASK_MAX
+#define BG_TASK_MAX     (16)    // set with -DBG_TASK_MAX=n
+#endif
+#ifndef BG_TASK_PROFILING
+#define BG_TASK_PROFILING (0)   // set with -DBG_TASK_PROFILING=1 to time every run
+#endif
+#define C_BG_TASK_MAX   (BG_TASK_MAX)
+
+_Static_assert(E_BG_TASK_PRIO_COUNT <= 32, "the ready bitmap holds 32 priorities");
 /*** structures ***********************************************************/
-typedef struct
+typedef enum
+{
+    E_BG_TASK_STATE_FREE,
+    E_BG_TASK_STATE_READY,      // in _ready[prio]
+    E_BG_TASK_STATE_SLEEPING,   // in _sleeping[prio], a min-heap on wakeAt
+    E_BG_TASK_STATE_RUNNING,
+    E_BG_TASK_STATE_SUSPENDED,
+    E_BG_TASK_STATE_REMOVED     // removed while running, freed once the run returns
+} bg_task_state_t;
+
+struct bg_task_entry_s
 {
     bg_task_t task;
+    bg_task_context_t contextTask;  // used instead of task when that is NULL
+    void* context;
     char const* name;
     bg_task_prio_t prio;
-} bg_task_list_t;
+    bg_task_state_t state;
+    uint32_t pass;              // a ready task with the current pass already ran in it
+    uint64_t periodUs;          // 0 = run on every pass
+    uint64_t nextDue;           // next periodic run
+    uint64_t wakeAt;            // time the task sleeps until, nextDue or an earlier wake up
+    uint64_t wakeRequest;       // earlier wake up asked for while not sleeping, UINT64_MAX = none
+    uint32_t sleepIndex;        // position in _sleeping[prio]
+    uint32_t sleepOrder;        // tasks with the same wakeAt wake in the order they went to sleep
+    uint32_t runs;
+    uint32_t missed;
+    uint32_t lastLateness;
+    uint32_t maxLateness;
+#if BG_TASK_PROFILING
+    uint32_t calls;
+    uint32_t overruns;
+    uint32_t execMin;           // cycles
+    uint32_t execMax;
+    uint64_t execSum;
+#endif
+    struct bg_task_entry_s* prev;
+    struct bg_task_entry_s* next;
+};
+
+typedef struct
+{
+    bg_task_handle_t* head;
+    bg_task_handle_t* tail;
+} bg_task_queue_t;
+
+typedef struct
+{
+    bg_task_handle_t* entries[C_BG_TASK_MAX];
+    uint32_t count;
+} bg_task_heap_t;
 /*** local constants ******************************************************/
 /*** macros ***************************************************************/
+// bit 0 of the ready bitmap is the highest priority, so find-first-set picks it
+#define READY_BIT(prio)         (1u << (E_BG_TASK_PRIO_COUNT - 1u - (uint32_t)(prio)))
+#define FIRST_SET(mask)         ((uint32_t)__builtin_ctz(mask))
+#define BIT_TO_PRIO(bit)        (E_BG_TASK_PRIO_COUNT - 1u - (bit))
+#define LOCK()                  do { if(_lock != NULL) { _lock(); } } while(0)
+#define UNLOCK()                do { if(_unlock != NULL) { _unlock(); } } while(0)
 /*** local variables ******************************************************/
 static bool _initialized = false;
-static bg_task_list_t _tasks[C_BG_TASK_MAX];
-static uint8_t _taskCount = 0;
+static bg_task_handle_t _tasks[C_BG_TASK_MAX];
+static bg_task_handle_t* _free = NULL;
+static bg_task_queue_t _ready[E_BG_TASK_PRIO_COUNT];
+static bg_task_heap_t _sleeping[E_BG_TASK_PRIO_COUNT];
+static uint32_t _sleepOrder = 0;
+static uint32_t _readyMask = 0;
+static uint32_t _pass[E_BG_TASK_PRIO_COUNT];
+static bg_task_time_t _time = NULL;
+static bg_task_lock_t _lock = NULL;
+static bg_task_lock_t _unlock = NULL;
+static bg_task_notify_t _notify = NULL;
+static bg_task_cycles_t _cycles = NULL;
+static uint32_t _cyclesPerUs = 1;
 /*** prototypes ***********************************************************/
+static void _append(bg_task_queue_t* queue, bg_task_handle_t* entry);
+static void _unlink(bg_task_queue_t* queue, bg_task_handle_t* entry);
+static void _makeReady(bg_task_handle_t* entry);
+static bool _wakesBefore(const bg_task_handle_t* a, const bg_task_handle_t* b);
+static void _heapPlace(bg_task_heap_t* heap, bg_task_handle_t* entry, uint32_t index);
+static void _siftUp(bg_task_heap_t* heap, bg_task_handle_t* entry, uint32_t index);
+static void _siftDown(bg_task_heap_t* heap, bg_task_handle_t* entry, uint32_t index);
+static void _heapRemove(bg_task_heap_t* heap, bg_task_handle_t* entry);
+static void _sleep(bg_task_handle_t* entry);
+static void _dequeue(bg_task_handle_t* entry);
+static void _release(bg_task_handle_t* entry);
+static void _wake(bg_task_prio_t prio, uint64_t now);
+static void _run(bg_task_handle_t* entry, uint64_t now);
+static void _call(bg_task_handle_t* entry);
+static bg_task_handle_t* _add(bg_task_t task, bg_task_context_t contextTask, void* context, char const* name, bg_task_prio_t prio, uint32_t periodMs, uint32_t offsetMs);
+static bg_task_handle_t* _find(char const* name);
+#if BG_TASK_PROFILING
+static void _profile(bg_task_handle_t* entry, uint32_t cycles);
+static uint32_t _toNs(uint64_t cycles);
+#endif
 /*** interrupt service routines *******************************************/
 /*** functions ************************************************************/
+/*=============================== PRIVATE ==========================================*/
 /***************************************************************************
- * This function 
+ * This function
+ **************************************************************************/
+static void _append(bg_task_queue_t* queue, bg_task_handle_t* entry)
+{
+    entry->next = NULL;
+    entry->prev = queue->tail;
+
+    if(queue->tail != NULL)
+    {
+        queue->tail->next = entry;
+    }
+    else
+    {
+        queue->head = entry;
+    }
+    queue->tail = entry;
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+static void _unlink(bg_task_queue_t* queue, bg_task_handle_t* entry)
+{
+    if(entry->prev != NULL)
+    {
+        entry->prev->next = entry->next;
+    }
+    else
+    {
+        queue->head = entry->next;
+    }
+
+    if(entry->next != NULL)
+    {
+        entry->next->prev = entry->prev;
+    }
+    else
+    {
+        queue->tail = entry->prev;
+    }
+    entry->prev = NULL;
+    entry->next = NULL;
+}
+/***************************************************************************
+ * This function queues a task behind the ready tasks of its priority. It
+ * may still run in the current pass.
+ **************************************************************************/
+static void _makeReady(bg_task_handle_t* entry)
+{
+    _append(&_ready[entry->prio], entry);
+    _readyMask |= READY_BIT(entry->prio);
+    entry->pass = _pass[entry->prio] - 1u;
+    entry->state = E_BG_TASK_STATE_READY;
+}
+/***************************************************************************
+ * This function tells if task a wakes up before task b, in the order they
+ * went to sleep if both wake at the same time.
+ **************************************************************************/
+static bool _wakesBefore(const bg_task_handle_t* a, const bg_task_handle_t* b)
+{
+    if(a->wakeAt != b->wakeAt)
+    {
+        return (a->wakeAt < b->wakeAt);
+    }
+    return ((int32_t)(a->sleepOrder - b->sleepOrder) < 0);
+}
+/***************************************************************************
+ * This function stores a task at index of the heap and remembers where.
+ **************************************************************************/
+static void _heapPlace(bg_task_heap_t* heap, bg_task_handle_t* entry, uint32_t index)
+{
+    heap->entries[index] = entry;
+    entry->sleepIndex = index;
+}
+/***************************************************************************
+ * This function moves a task from index towards the root of the heap 
+ * until its parent wakes up before it.
+ **************************************************************************/
+static void _siftUp(bg_task_heap_t* heap, bg_task_handle_t* entry, uint32_t index)
+{
+    while(index > 0)
+    {
+        uint32_t parent = (index - 1u) / 2u;
+
+        if(!_wakesBefore(entry, heap->entries[parent]))
+        {
+            break;
+        }
+        _heapPlace(heap, heap->entries[parent], index);
+        index = parent;
+    }
+    _heapPlace(heap, entry, index);
+}
+/***************************************************************************
+ * This function moves a task from index towards the leaves of the heap 
+ * until it wakes up before both children.
+ **************************************************************************/
+static void _siftDown(bg_task_heap_t* heap, bg_task_handle_t* entry, uint32_t index)
+{
+    for(;;)
+    {
+        uint32_t child = 2u * index + 1u;
+
+        if(child >= heap->count)
+        {
+            break;
+        }
+        if(child + 1u < heap->count && _wakesBefore(heap->entries[child + 1u], heap->entries[child]))
+        {
+            child++;
+        }
+        if(!_wakesBefore(heap->entries[child], entry))
+        {
+            break;
+        }
+        _heapPlace(heap, heap->entries[child], index);
+        index = child;
+    }
+    _heapPlace(heap, entry, index);
+}
+/***************************************************************************
+ * This function takes a task out of the heap, the last one fills its 
+ * place and is sifted to where it belongs.
+ **************************************************************************/
+static void _heapRemove(bg_task_heap_t* heap, bg_task_handle_t* entry)
+{
+    uint32_t index = entry->sleepIndex;
+    bg_task_handle_t* last = heap->entries[--heap->count];
+
+    heap->entries[heap->count] = NULL;
+    if(last == entry)
+    {
+        return;
+    }
+    if(index > 0 && _wakesBefore(last, heap->entries[(index - 1u) / 2u]))
+    {
+        _siftUp(heap, last, index);
+    }
+    else
+    {
+        _siftDown(heap, last, index);
+    }
+}
+/***************************************************************************
+ * This function puts a task into the sleep heap of its priority by the 
+ * time it wakes up: its next periodic run or an earlier wake up that was
+ * asked for. Sleeping and waking cost O(log n) in the tasks of the 
+ * priority, the next due one is always at the root.
+ **************************************************************************/
+static void _sleep(bg_task_handle_t* entry)
+{
+    bg_task_heap_t* sleeping = &_sleeping[entry->prio];
+
+    entry->wakeAt = (entry->wakeRequest < entry->nextDue) ? entry->wakeRequest : entry->nextDue;
+    entry->wakeRequest = UINT64_MAX;
+    entry->sleepOrder = _sleepOrder++;
+
+    assert(sleeping->count < C_BG_TASK_MAX);
+    sleeping->count++;
+    _siftUp(sleeping, entry, sleeping->count - 1u);
+    entry->state = E_BG_TASK_STATE_SLEEPING;
+}
+/***************************************************************************
+ * This function takes a task out of the list it is queued in.
+ **************************************************************************/
+static void _dequeue(bg_task_handle_t* entry)
+{
+    if(entry->state == E_BG_TASK_STATE_READY)
+    {
+        _unlink(&_ready[entry->prio], entry);
+        if(_ready[entry->prio].head == NULL)
+        {
+            _readyMask &= ~READY_BIT(entry->prio);
+        }
+    }
+    else if(entry->state == E_BG_TASK_STATE_SLEEPING)
+    {
+        _heapRemove(&_sleeping[entry->prio], entry);
+    }
+}
+/***************************************************************************
+ * This function gives an entry back to the free list.
+ **************************************************************************/
+static void _release(bg_task_handle_t* entry)
+{
+    entry->state = E_BG_TASK_STATE_FREE;
+    entry->next = _free;
+    _free = entry;
+}
+/***************************************************************************
+ * This function moves the due tasks of a priority from its sleep heap to
+ * its ready queue. Without a time source all of them are due.
+ **************************************************************************/
+static void _wake(bg_task_prio_t prio, uint64_t now)
+{
+    while(_sleeping[prio].count > 0 && (_time == NULL || _sleeping[prio].entries[0]->wakeAt <= now))
+    {
+        bg_task_handle_t* entry = _sleeping[prio].entries[0];
+        _heapRemove(&_sleeping[prio], entry);
+        _makeReady(entry);
+    }
+}
+/***************************************************************************
+ * This function runs a ready task and queues it again, unless it was 
+ * removed or suspended meanwhile. The due time moves on by whole periods,
+ * so a late start does not shift the phase of later runs. A run before 
+ * the due time, after a wake up, leaves the schedule as it is. The lock
+ * is released while the task runs.
+ **************************************************************************/
+static void _run(bg_task_handle_t* entry, uint64_t now)
+{
+    _dequeue(entry);
+    entry->state = E_BG_TASK_STATE_RUNNING;
+    entry->runs++;
+
+    if(_time != NULL && entry->periodUs != 0 && now >= entry->nextDue)
+    {
+        uint64_t lateness = now - entry->nextDue;
+
+        entry->lastLateness = (lateness > UINT32_MAX) ? UINT32_MAX : (uint32_t)lateness;
+        if(entry->lastLateness > entry->maxLateness)
+        {
+            entry->maxLateness = entry->lastLateness;
+        }
+
+        uint64_t periods = lateness / entry->periodUs;
+        entry->missed += (uint32_t)periods;
+        entry->nextDue += (periods + 1u) * entry->periodUs;
+    }
+
+    UNLOCK();
+#if BG_TASK_PROFILING
+    uint32_t start = (_cycles != NULL) ? _cycles() : 0;
+    _call(entry);
+    uint32_t cycles = (_cycles != NULL) ? _cycles() - start : 0;
+    LOCK();
+    if(_cycles != NULL)
+    {
+        _profile(entry, cycles);
+    }
+#else
+    _call(entry);
+    LOCK();
+#endif
+
+    if(entry->state == E_BG_TASK_STATE_RUNNING)
+    {
+        if(_time == NULL || entry->periodUs == 0)
+        {
+            _makeReady(entry);
+            entry->pass = _pass[entry->prio];
+        }
+        else
+        {
+            _sleep(entry);
+        }
+    }
+    else if(entry->state == E_BG_TASK_STATE_REMOVED)
+    {
+        _release(entry);
+    }
+}
+/***************************************************************************
+ * This function calls the task, with its context if it was added with one.
+ **************************************************************************/
+static void _call(bg_task_handle_t* entry)
+{
+    if(entry->task != NULL)
+    {
+        entry->task();
+    }
+    else
+    {
+        entry->contextTask(entry->context);
+    }
+}
+/***************************************************************************
+ * This function registers a task, see bg_task_add.
+ **************************************************************************/
+static bg_task_handle_t* _add(bg_task_t task, bg_task_context_t contextTask, void* context, char const* name, bg_task_prio_t prio, uint32_t periodMs, uint32_t offsetMs)
+{
+    assert(_initialized);
+    assert(task != NULL || contextTask != NULL);
+    assert(prio < E_BG_TASK_PRIO_COUNT);
+
+    LOCK();
+    bg_task_handle_t* entry = _free;
+
+    if(entry != NULL)
+    {
+        _free = entry->next;
+        memset(entry, 0, sizeof(bg_task_handle_t));
+        entry->task = task;
+        entry->contextTask = contextTask;
+        entry->context = context;
+        entry->name = name;
+        entry->prio = prio;
+        entry->periodUs = (uint64_t)periodMs * 1000u;
+        entry->nextDue = ((_time != NULL) ? _time() : 0) + (uint64_t)offsetMs * 1000u;
+        entry->wakeRequest = UINT64_MAX;
+
+        if(offsetMs == 0 || _time == NULL)
+        {
+            _makeReady(entry);
+        }
+        else
+        {
+            _sleep(entry);
+        }
+    }
+    UNLOCK();
+
+    if(entry != NULL && _notify != NULL)
+    {
+        _notify(prio);
+    }
+    return entry;
+}
+/***************************************************************************
+ * This function returns the registered task with that name, NULL if there
+ * is none.
+ **************************************************************************/
+static bg_task_handle_t* _find(char const* name)
+{
+    for(uint32_t i = 0; i < C_BG_TASK_MAX; i++)
+    {
+        if(_tasks[i].state != E_BG_TASK_STATE_FREE && _tasks[i].name != NULL && strcmp(_tasks[i].name, name) == 0)
+        {
+            return &_tasks[i];
+        }
+    }
+    return NULL;
+}
+#if BG_TASK_PROFILING
+/***************************************************************************
+ * This function adds the execution time of one run. A run of a periodic
+ * task that takes longer than its period counts as overrun.
+ **************************************************************************/
+static void _profile(bg_task_handle_t* entry, uint32_t cycles)
+{
+    if(entry->calls == 0 || cycles < entry->execMin)
+    {
+        entry->execMin = cycles;
+    }
+    if(cycles > entry->execMax)
+    {
+        entry->execMax = cycles;
+    }
+    entry->execSum += cycles;
+    entry->calls++;
+
+    if(entry->periodUs != 0 && cycles > entry->periodUs * _cyclesPerUs)
+    {
+        entry->overruns++;
+    }
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+static uint32_t _toNs(uint64_t cycles)
+{
+    uint64_t ns = cycles * 1000u / _cyclesPerUs;
+    return (ns > UINT32_MAX) ? UINT32_MAX : (uint32_t)ns;
+}
+#endif
+/*=============================== PUBLIC ===========================================*/
+/***************************************************************************
+ * This function wakes the tasks that are due and runs the ready tasks, 
+ * highest priority first. The priority is picked from the ready bitmap 
+ * with find-first-set, tasks queued again during the pass wait for the 
+ * next one. Without a time source every task runs on every pass.
  **************************************************************************/
  void bg_task_cyclic(void)
  {
     assert(_initialized);
 
-    for(uint8_t i = 0; i < _taskCount; i++)
+    uint64_t now = (_time != NULL) ? _time() : 0;
+    uint32_t done = 0;
+
+    LOCK();
+    for(uint32_t prio = 0; prio < E_BG_TASK_PRIO_COUNT; prio++)
+    {
+        _pass[prio]++;
+        _wake((bg_task_prio_t)prio, now);
+    }
+
+    while((_readyMask & ~done) != 0)
     {
-        if(_tasks[i].task != NULL)
+        uint32_t bit = FIRST_SET(_readyMask & ~done);
+        bg_task_handle_t* entry = _ready[BIT_TO_PRIO(bit)].head;
+
+        if(entry->pass == _pass[entry->prio])
+        {
+            done |= (1u << bit);
+        }
+        else
         {
-             _tasks[i].task();
+            _run(entry, now);
         }
     }
+    UNLOCK();
  }
 /***************************************************************************
- * This function 
+ * This function makes one pass over the tasks of a single priority. It 
+ * is what an executor thread per priority runs instead of bg_task_cyclic.
+ **************************************************************************/
+void bg_task_cyclicPrio(bg_task_prio_t prio)
+{
+    assert(_initialized);
+    assert(prio < E_BG_TASK_PRIO_COUNT);
+
+    uint64_t now = (_time != NULL) ? _time() : 0;
+
+    LOCK();
+    _pass[prio]++;
+    _wake(prio, now);
+
+    while(_ready[prio].head != NULL && _ready[prio].head->pass != _pass[prio])
+    {
+        _run(_ready[prio].head, now);
+    }
+    UNLOCK();
+}
+/***************************************************************************
+ * This function registers a task that is due every periodMs, the first 
+ * time offsetMs after it was added. A periodMs of zero runs the task on 
+ * every pass. Tasks of the same priority run in the order they got due.
  * @todo LOCK INTERRUPTS
  **************************************************************************/
-void bg_task_add(bg_task_t task, char const* name, bg_task_prio_t prio)
+bg_task_handle_t* bg_task_add(bg_task_t task, char const* name, bg_task_prio_t prio, uint32_t periodMs, uint32_t offsetMs)
+{
+    assert(task);
+    return _add(task, NULL, NULL, name, prio, periodMs, offsetMs);
+}
+/***************************************************************************
+ * This function registers a task like bg_task_add that gets context passed
+ * on every run.
+ **************************************************************************/
+bg_task_handle_t* bg_task_addContext(bg_task_context_t task, void* context, char const* name, bg_task_prio_t prio, uint32_t periodMs, uint32_t offsetMs)
+{
+    assert(task);
+    return _add(NULL, task, context, name, prio, periodMs, offsetMs);
+}
+/***************************************************************************
+ * This function unregisters a task, also while it runs. A running task is
+ * freed once its run returns.
+ **************************************************************************/
+void bg_task_remove(bg_task_handle_t* handle)
 {
     assert(_initialized);
+    assert(handle);
 
-    uint8_t index = 0;
+    LOCK();
+    assert(handle->state != E_BG_TASK_STATE_FREE);
+    if(handle->state == E_BG_TASK_STATE_RUNNING)
+    {
+        handle->state = E_BG_TASK_STATE_REMOVED;
+    }
+    else if(handle->state != E_BG_TASK_STATE_REMOVED)
+    {
+        _dequeue(handle);
+        _release(handle);
+    }
+    UNLOCK();
+}
+/***************************************************************************
+ * This function stops a task from running until it is resumed.
+ **************************************************************************/
+void bg_task_suspend(bg_task_handle_t* handle)
+{
+    assert(_initialized);
+    assert(handle);
 
-    if(_taskCount < C_BG_TASK_MAX)
+    LOCK();
+    assert(handle->state != E_BG_TASK_STATE_FREE);
+    if(handle->state != E_BG_TASK_STATE_REMOVED)
     {
-        index = _taskCount;
+        _dequeue(handle);
+        handle->state = E_BG_TASK_STATE_SUSPENDED;
+    }
+    UNLOCK();
+}
+/***************************************************************************
+ * This function lets a suspended task run again. A periodic task keeps 
+ * its phase and is due at its next period boundary, the periods spent 
+ * suspended do not count as missed.
+ **************************************************************************/
+void bg_task_resume(bg_task_handle_t* handle)
+{
+    assert(_initialized);
+    assert(handle);
 
-        for(; index > 0; index--)
+    LOCK();
+    if(handle->state == E_BG_TASK_STATE_SUSPENDED)
+    {
+        if(_time == NULL || handle->periodUs == 0)
         {
-            if(_tasks[index - 1].prio < prio)
-            {
-                _tasks[index] = _tasks[index - 1]; 
-            }
-            else
+            _makeReady(handle);
+        }
+        else
+        {
+            uint64_t now = _time();
+            if(handle->nextDue < now)
             {
-                break;
+                handle->nextDue += ((now - handle->nextDue + handle->periodUs - 1u) / handle->periodUs) * handle->periodUs;
             }
+            _sleep(handle);
         }
-        _tasks[index].task = task;
-        _tasks[index].name = name;
-        _tasks[index].prio = prio;
-        _taskCount++;
+    }
+    UNLOCK();
+
+    if(_notify != NULL)
+    {
+        _notify(handle->prio);
+    }
+}
+/***************************************************************************
+ * This function lets a task run at timeUs at the latest, earlier than its
+ * next periodic run. It can be called from any thread and from the task 
+ * itself, the periodic schedule stays as it is.
+ **************************************************************************/
+void bg_task_wakeAt(bg_task_handle_t* handle, uint64_t timeUs)
+{
+    assert(_initialized);
+    assert(handle);
+
+    bool earlier = false;
+
+    LOCK();
+    if(handle->state == E_BG_TASK_STATE_SLEEPING && timeUs < handle->wakeAt)
+    {
+        _heapRemove(&_sleeping[handle->prio], handle);
+        handle->wakeRequest = timeUs;
+        _sleep(handle);
+        earlier = true;
+    }
+    else if(handle->state == E_BG_TASK_STATE_RUNNING && timeUs < handle->wakeRequest)
+    {
+        handle->wakeRequest = timeUs;
+    }
+    UNLOCK();
+
+    if(earlier && _notify != NULL)
+    {
+        _notify(handle->prio);
+    }
+}
+/***************************************************************************
+ * This function lets a task run with the next pass of its priority, e.g.
+ * when an event it waits for arrived.
+ **************************************************************************/
+void bg_task_wake(bg_task_handle_t* handle)
+{
+    bg_task_wakeAt(handle, 0);
+}
+/***************************************************************************
+ * This function copies the timing of the task registered under name.
+ **************************************************************************/
+bool bg_task_getStats(char const* name, bg_task_stats_t* stats)
+{
+    assert(_initialized);
+    assert(name);
+    assert(stats);
+
+    LOCK();
+    bg_task_handle_t* entry = _find(name);
+
+    if(entry != NULL)
+    {
+        stats->runs = entry->runs;
+        stats->missed = entry->missed;
+        stats->lastLatenessUs = entry->lastLateness;
+        stats->maxLatenessUs = entry->maxLateness;
+        stats->nextDueUs = entry->nextDue;
+    }
+    UNLOCK();
+    return (entry != NULL);
+}
+/***************************************************************************
+ * This function copies the execution times of the task registered under 
+ * name. Returns false if there is no such task or the build runs without
+ * BG_TASK_PROFILING.
+ **************************************************************************/
+bool bg_task_getProfile(char const* name, bg_task_profile_t* profile)
+{
+    assert(_initialized);
+    assert(name);
+    assert(profile);
+
+#if BG_TASK_PROFILING
+    LOCK();
+    bg_task_handle_t* entry = _find(name);
+
+    if(entry != NULL)
+    {
+        profile->calls = entry->calls;
+        profile->overruns = entry->overruns;
+        profile->minNs = _toNs(entry->execMin);
+        profile->maxNs = _toNs(entry->execMax);
+        profile->meanNs = (entry->calls != 0) ? _toNs(entry->execSum / entry->calls) : 0;
+    }
+    UNLOCK();
+    return (entry != NULL);
+#else
+    return false;
+#endif
+}
+/***************************************************************************
+ * This function returns the earliest due time of all tasks, 0 if a task 
+ * is ready and UINT64_MAX if there is none.
+ **************************************************************************/
+uint64_t bg_task_getNextDue(void)
+{
+    assert(_initialized);
+
+    uint64_t retval = UINT64_MAX;
+
+    for(uint32_t prio = 0; prio < E_BG_TASK_PRIO_COUNT; prio++)
+    {
+        uint64_t due = bg_task_getNextDuePrio((bg_task_prio_t)prio);
+        retval = (due < retval) ? due : retval;
+    }
+    return retval;
+}
+/***************************************************************************
+ * This function returns the earliest due time of the tasks of a single 
+ * priority, 0 if one is ready and UINT64_MAX if there is none.
+ **************************************************************************/
+uint64_t bg_task_getNextDuePrio(bg_task_prio_t prio)
+{
+    assert(_initialized);
+    assert(prio < E_BG_TASK_PRIO_COUNT);
+
+    uint64_t retval = UINT64_MAX;
+
+    LOCK();
+    if(_ready[prio].head != NULL)
+    {
+        retval = 0;
+    }
+    else if(_sleeping[prio].count > 0)
+    {
+        retval = _sleeping[prio].entries[0]->wakeAt;
+    }
+    UNLOCK();
+    return retval;
+}
+/***************************************************************************
+ * This function sets the clock in us the periods are measured with. Set
+ * it before adding periodic tasks, their first due time is based on it.
+ **************************************************************************/
+void bg_task_setTimeSource(bg_task_time_t time)
+{
+    assert(_initialized);
+    _time = time;
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+bg_task_time_t bg_task_getTimeSource(void)
+{
+    return _time;
+}
+/***************************************************************************
+ * This function sets the lock that guards the task lists when priorities 
+ * run in their own threads. It is not taken while a task runs.
+ **************************************************************************/
+void bg_task_setLock(bg_task_lock_t lock, bg_task_lock_t unlock)
+{
+    assert(_initialized);
+    assert((lock == NULL) == (unlock == NULL));
+
+    _lock = lock;
+    _unlock = unlock;
+}
+/***************************************************************************
+ * This function sets the hook that is called when the next due time of a
+ * priority moved earlier, from whatever thread caused it. An executor 
+ * uses it to wake the thread of that priority.
+ **************************************************************************/
+void bg_task_setNotify(bg_task_notify_t notify)
+{
+    assert(_initialized);
+    _notify = notify;
+}
+/***************************************************************************
+ * This function sets the free running cycle counter the runs are timed 
+ * with. Runs are expected to take less than one wrap of the counter.
+ **************************************************************************/
+void bg_task_setCycleCounter(bg_task_cycles_t counter, uint32_t cyclesPerUs)
+{
+    assert(_initialized);
+    assert(cyclesPerUs > 0);
+
+    _cycles = counter;
+    _cyclesPerUs = cyclesPerUs;
+}
+/***************************************************************************
+ * This function 
+ **************************************************************************/
+void bg_task_deinit(void)
+{
+    if(_initialized)
+    {
+        _time = NULL;
+        _lock = NULL;
+        _unlock = NULL;
+        _notify = NULL;
+        _cycles = NULL;
+        _cyclesPerUs = 1;
+        _initialized = false;
     }
 }
 /***************************************************************************
@@ -79,12 +838,19 @@ void bg_task_add(bg_task_t task, char const* name, bg_task_prio_t prio)
  {
     if(!_initialized)
     {
-        for(uint8_t i = 0; i < C_BG_TASK_MAX; i++)
+        memset(_tasks, 0, sizeof(_tasks));
+        memset(_ready, 0, sizeof(_ready));
+        memset(_sleeping, 0, sizeof(_sleeping));
+        memset(_pass, 0, sizeof(_pass));
+        _readyMask = 0;
+        _free = NULL;
+
+        for(uint32_t i = C_BG_TASK_MAX; i > 0; i--)
         {
-            _tasks[i].task = NULL;
+            _tasks[i - 1].next = _free;
+            _free = &_tasks[i - 1];
         }
         _initialized = true;
     }
  }
 
-
@@ -0,0 +1,504 @@
+/**************************************************************************
+bms_bus.c
+ Created on: Mar 06, 2026
+     Author: M. Schermutzki
+***************************************************************************/
+/*** includes *************************************************************/
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+#include "bms_bus.h"
+#include "bms_communication.h"
+#include "generic_hardware_interface.h"
+/*** local constants ******************************************************/
+#ifndef BMS_BUS_MEMBERS_MAX
+#define BMS_BUS_MEMBERS_MAX         (16)        // packs per controller, set with -DBMS_BUS_MEMBERS_MAX=n
+#endif
+#ifndef BMS_BUS_SLOTS
+#define BMS_BUS_SLOTS               (32)        // power of two, at least twice the members
+#endif
+#define C_BMS_BUS_INSTANCES_MAX     (2)
+#define C_BMS_BUS_MEMBERS_MAX       (BMS_BUS_MEMBERS_MAX)
+#define C_BMS_BUS_SLOTS             (BMS_BUS_SLOTS)
+#define C_BMS_BUS_WINDOW_DEFAULT    (8)         // requests in flight on one bus
+#define C_BUS_POLL_MAX              (16u)       // frames drained per poll, one batch read
+#if (C_BMS_BUS_SLOTS & (C_BMS_BUS_SLOTS - 1)) != 0 || C_BMS_BUS_SLOTS < 2 * C_BMS_BUS_MEMBERS_MAX
+#error "BMS_BUS_SLOTS must be a power of two and at least twice BMS_BUS_MEMBERS_MAX"
+#endif
+#if C_BMS_BUS_MEMBERS_MAX > 255
+#error "BMS_BUS_MEMBERS_MAX must not exceed 255"
+#endif
+static const uint8_t C_SLAVE_ID_SHIFT       =   12u;
+static const uint32_t C_SLAVE_ID_BITS       =   0x1FFFFu;
+static const uint32_t C_FUNCTION_CODE_MASK  =   0x0Cu << 8;     // GC2 responses only use function codes 0x01 and 0x02
+/*** structures ***********************************************************/
+typedef struct
+{
+    bms_com_t* bms;
+    uint32_t slaveID;
+    uint32_t round;         // last sweep round the member completed
+} bms_bus_member_t;
+
+/* Members are kept in an open addressing table indexed by the slave ID
+ * bits of the CAN ID, so a frame finds its owner in constant time. */
+struct bms_bus_s
+{
+    void* handle;
+    com_read_t read;
+    com_read_batch_t readBatch;
+    com_tx_status_t txStatus;
+    com_set_filter_t setFilter;
+    com_bus_off_count_t busOff;
+    uint32_t busOffSeen;    // last count read from the HAL
+    uint32_t busOffCount;   // bus-off events since the bus was attached
+    com_time_t time;
+    uint32_t filterCode;
+    uint32_t filterMask;
+    bool filterExact;       // the mask accepts no slave ID besides the members
+    bms_bus_member_t slots[C_BMS_BUS_SLOTS];
+    uint8_t memberCount;
+    uint32_t foreignCount;
+    uint8_t window;         // requests in flight shared by all members
+    uint32_t round;         // current sweep round, starts with 1
+    uint8_t roundDone;      // members that completed a sweep in this round
+    uint64_t roundStart;
+    uint32_t sweepTimeUs;   // time until every member completed a sweep
+    bool used;
+};
+/*** macros ***************************************************************/
+#define SLOT_INDEX(slaveID)     ((slaveID) & (C_BMS_BUS_SLOTS - 1u))
+/*** local variables ******************************************************/
+static bool _initialized = false;
+static bms_bus_t _instances[C_BMS_BUS_INSTANCES_MAX];
+/*** prototypes ***********************************************************/
+static bms_bus_t* _findBus(const hardware_interface_t* hw);
+static void _updateFilter(bms_bus_t* bus);
+static bms_bus_member_t* _findMember(bms_bus_t* bus, uint32_t slaveID);
+static void _restartRound(bms_bus_t* bus);
+static void _dispatch(bms_bus_t* bus, const can_frame_t* frame);
+/*** interrupt service routines *******************************************/
+/*** functions ************************************************************/
+/*=============================== PRIVATE ==========================================*/
+/***************************************************************************
+ * This function returns the bus that already serves the HAL handle or a 
+ * free one.
+ **************************************************************************/
+static bms_bus_t* _findBus(const hardware_interface_t* hw)
+{
+    bms_bus_t* freeBus = NULL;
+
+    for(uint8_t i = 0; i < C_BMS_BUS_INSTANCES_MAX; i++)
+    {
+        if(_instances[i].used)
+        {
+            if(_instances[i].handle == hw->halHandle && _instances[i].read == hw->comRead)
+            {
+                return &_instances[i];
+            }
+        }
+        else if(freeBus == NULL)
+        {
+            freeBus = &_instances[i];
+        }
+    }
+
+    if(freeBus != NULL)
+    {
+        memset(freeBus, 0, sizeof(bms_bus_t));
+        freeBus->handle = hw->halHandle;
+        freeBus->read = hw->comRead;
+        freeBus->readBatch = hw->comReadBatch;
+        freeBus->txStatus = hw->comTxStatus;
+        freeBus->setFilter = hw->comSetFilter;
+        freeBus->busOff = hw->comBusOffCount;
+        freeBus->busOffSeen = (hw->comBusOffCount != NULL) ? hw->comBusOffCount(hw->halHandle) : 0;
+        freeBus->time = hw->comTime;
+        freeBus->window = C_BMS_BUS_WINDOW_DEFAULT;
+        freeBus->used = true;
+    }
+    return freeBus;
+}
+/***************************************************************************
+ * This function computes the tightest single code / mask pair that accepts
+ * the responses of all members: slave ID bits that are equal in every 
+ * member must match, all others are don't care. If the mask lets other 
+ * slave IDs through they are still dropped by the dispatcher in 
+ * bms_bus_poll, which is the software filter behind the hardware one.
+ **************************************************************************/
+static void _updateFilter(bms_bus_t* bus)
+{
+    uint32_t andIds = C_SLAVE_ID_BITS;
+    uint32_t orIds = 0;
+
+    for(uint16_t i = 0; i < C_BMS_BUS_SLOTS; i++)
+    {
+        if(bus->slots[i].bms != NULL)
+        {
+            andIds &= bus->slots[i].slaveID;
+            orIds |= bus->slots[i].slaveID;
+        }
+    }
+
+    if(bus->memberCount == 0)
+    {
+        bus->filterCode = 0;
+        bus->filterMask = 0;
+        bus->filterExact = false;
+    }
+    else
+    {
+        uint32_t matchBits = ~(andIds ^ orIds) & C_SLAVE_ID_BITS;
+        uint32_t dontCare = (uint32_t)__builtin_popcount(~matchBits & C_SLAVE_ID_BITS);
+
+        bus->filterCode = (andIds & matchBits) << C_SLAVE_ID_SHIFT;
+        bus->filterMask = (matchBits << C_SLAVE_ID_SHIFT) | C_FUNCTION_CODE_MASK;
+        bus->filterExact = (dontCare < 8u) && ((1u << dontCare) == bus->memberCount);
+    }
+
+    if(bus->setFilter != NULL)
+    {
+        bus->setFilter(bus->handle, bus->filterCode, bus->filterMask);
+    }
+}
+/***************************************************************************
+ * This function returns the table entry of a slave ID or NULL.
+ **************************************************************************/
+static bms_bus_member_t* _findMember(bms_bus_t* bus, uint32_t slaveID)
+{
+    uint32_t index = SLOT_INDEX(slaveID);
+
+    for(uint16_t probe = 0; probe < C_BMS_BUS_SLOTS; probe++)
+    {
+        bms_bus_member_t* slot = &bus->slots[index];
+
+        if(slot->bms == NULL)
+        {
+            return NULL;
+        }
+        if(slot->slaveID == slaveID)
+        {
+            return slot;
+        }
+        index = SLOT_INDEX(index + 1u);
+    }
+    return NULL;
+}
+/***************************************************************************
+ * This function starts a new sweep round, e.g. after the members changed.
+ **************************************************************************/
+static void _restartRound(bms_bus_t* bus)
+{
+    bus->round++;
+    bus->roundDone = 0;
+    bus->roundStart = bus->time();
+}
+/***************************************************************************
+ * This function hands a received frame to the member it belongs to.
+ **************************************************************************/
+static void _dispatch(bms_bus_t* bus, const can_frame_t* frame)
+{
+    bms_com_t* owner = bms_bus_lookup(bus, frame->id >> C_SLAVE_ID_SHIFT);
+
+    if(owner != NULL)
+    {
+        bms_communication_receive(owner, frame);
+    }
+    else
+    {
+        bus->foreignCount++;
+    }
+}
+/*=============================== PUBLIC ===========================================*/
+/***************************************************************************
+ * This function returns the acceptance filter of the bus. Returns true if
+ * the hardware filter alone is exact.
+ **************************************************************************/
+bool bms_bus_getFilter(bms_bus_t* bus, uint32_t* code, uint32_t* mask)
+{
+    assert(bus);
+    assert(code);
+    assert(mask);
+
+    *code = bus->filterCode;
+    *mask = bus->filterMask;
+    return bus->filterExact;
+}
+/***************************************************************************
+ * This function returns the number of received frames no member owns.
+ **************************************************************************/
+uint32_t bms_bus_getForeignCount(bms_bus_t* bus)
+{
+    assert(bus);
+    return bus->foreignCount;
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+uint8_t bms_bus_getMemberCount(bms_bus_t* bus)
+{
+    assert(bus);
+    return bus->memberCount;
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+bms_com_t* bms_bus_lookup(bms_bus_t* bus, uint32_t slaveID)
+{
+    assert(bus);
+
+    bms_bus_member_t* member = _findMember(bus, slaveID);
+    return (member != NULL) ? member->bms : NULL;
+}
+/***************************************************************************
+ * This function sets how many requests all members together may have in 
+ * flight. Every member gets the same share of it, but at least one.
+ **************************************************************************/
+void bms_bus_setWindow(bms_bus_t* bus, uint8_t window)
+{
+    assert(bus);
+    bus->window = (window == 0) ? 1 : window;
+}
+/***************************************************************************
+ * This function returns the number of requests one member may have in 
+ * flight. The share shrinks as packs join, so a member with a deep 
+ * pipeline can not crowd out the others.
+ **************************************************************************/
+uint8_t bms_bus_getShare(bms_bus_t* bus)
+{
+    assert(bus);
+
+    if(bus->memberCount == 0 || bus->window <= bus->memberCount)
+    {
+        return 1;
+    }
+    return (uint8_t)(bus->window / bus->memberCount);
+}
+/***************************************************************************
+ * This function is called by a member that completed a sweep. Once every 
+ * member completed one the time of the round is taken as the aggregate 
+ * sweep time of the bus.
+ **************************************************************************/
+void bms_bus_sweepDone(bms_bus_t* bus, uint32_t slaveID, uint64_t now)
+{
+    assert(bus);
+
+    bms_bus_member_t* member = _findMember(bus, slaveID);
+
+    if(member == NULL || member->round == bus->round)
+    {
+        return;
+    }
+    member->round = bus->round;
+    bus->roundDone++;
+
+    if(bus->roundDone >= bus->memberCount)
+    {
+        bus->sweepTimeUs = (uint32_t)(now - bus->roundStart);
+        bus->round++;
+        bus->roundDone = 0;
+        bus->roundStart = now;
+    }
+}
+/***************************************************************************
+ * This function returns the time in us the last round took until every 
+ * member completed a sweep, 0 before the first round completed.
+ **************************************************************************/
+uint32_t bms_bus_getSweepTime(bms_bus_t* bus)
+{
+    assert(bus);
+    return bus->sweepTimeUs;
+}
+/***************************************************************************
+ * This function returns how many bus-off events the HAL recovered from
+ * since the bus was attached.
+ **************************************************************************/
+uint32_t bms_bus_getBusOffCount(bms_bus_t* bus)
+{
+    assert(bus);
+    return bus->busOffCount;
+}
+/***************************************************************************
+ * This function drains received frames and transmit completions of the 
+ * bus and hands each one to the instance that owns its slave ID. After a
+ * bus-off every member drops its outstanding requests first. Any 
+ * member may call it, frames of the other members are not lost. With a
+ * batch read the frames of one poll are fetched in a single call.
+ **************************************************************************/
+void bms_bus_poll(bms_bus_t* bus)
+{
+    assert(bus);
+
+    can_frame_t frame;
+    can_tx_status_t txStatus;
+
+    if(bus->busOff != NULL)
+    {
+        uint32_t count = bus->busOff(bus->handle);
+
+        if(count != bus->busOffSeen)
+        {
+            bus->busOffCount += count - bus->busOffSeen;
+            bus->busOffSeen = count;
+            for(uint16_t i = 0; i < C_BMS_BUS_SLOTS; i++)
+            {
+                if(bus->slots[i].bms != NULL)
+                {
+                    bms_communication_busOff(bus->slots[i].bms);
+                }
+            }
+        }
+    }
+
+    if(bus->txStatus != NULL)
+    {
+        while(bus->txStatus(bus->handle, &txStatus) == E_HAL_STATUS_OK)
+        {
+            bms_com_t* owner = bms_bus_lookup(bus, txStatus.id >> C_SLAVE_ID_SHIFT);
+
+            if(owner != NULL)
+            {
+                bms_communication_txComplete(owner, &txStatus);
+            }
+        }
+    }
+
+    if(bus->readBatch != NULL)
+    {
+        can_frame_t frames[C_BUS_POLL_MAX];
+        uint16_t count = 0;
+
+        bus->readBatch(bus->handle, frames, C_BUS_POLL_MAX, &count);
+        for(uint16_t i = 0; i < count; i++)
+        {
+            _dispatch(bus, &frames[i]);
+        }
+    }
+    else
+    {
+        for(uint8_t i = 0; i < C_BUS_POLL_MAX; i++)
+        {
+            if(bus->read(bus->handle, &frame) != E_HAL_STATUS_OK)
+            {
+                break;
+            }
+            _dispatch(bus, &frame);
+        }
+    }
+}
+/***************************************************************************
+ * This function removes a member. Following entries of the probe chain 
+ * are moved back so lookups never need tombstones. The bus is released 
+ * with its last member.
+ **************************************************************************/
+void bms_bus_detach(bms_bus_t* bus, uint32_t slaveID)
+{
+    assert(bus);
+
+    uint32_t index = SLOT_INDEX(slaveID);
+    uint16_t probe = 0;
+
+    for(; probe < C_BMS_BUS_SLOTS; probe++)
+    {
+        if(bus->slots[index].bms == NULL)
+        {
+            return;
+        }
+        if(bus->slots[index].slaveID == slaveID)
+        {
+            break;
+        }
+        index = SLOT_INDEX(index + 1u);
+    }
+    if(probe == C_BMS_BUS_SLOTS)
+    {
+        return;
+    }
+
+    uint32_t hole = index;
+    bus->slots[hole].bms = NULL;
+
+    for(uint32_t next = SLOT_INDEX(hole + 1u); bus->slots[next].bms != NULL; next = SLOT_INDEX(next + 1u))
+    {
+        uint32_t home = SLOT_INDEX(bus->slots[next].slaveID);
+
+        // move the entry if the hole lies between its home slot and its current slot
+        if(SLOT_INDEX(next - home) >= SLOT_INDEX(next - hole))
+        {
+            bus->slots[hole] = bus->slots[next];
+            bus->slots[next].bms = NULL;
+            hole = next;
+        }
+    }
+
+    bus->memberCount--;
+    _updateFilter(bus);
+    _restartRound(bus);
+    if(bus->memberCount == 0)
+    {
+        bus->used = false;
+    }
+}
+/***************************************************************************
+ * This function registers an instance on the bus behind hw. Instances 
+ * that share a HAL handle share one bus. Returns NULL if the slave ID is 
+ * already taken or no bus / member is left.
+ **************************************************************************/
+bms_bus_t* bms_bus_attach(const hardware_interface_t* hw, bms_com_t* bms, uint32_t slaveID)
+{
+    assert(_initialized);
+    assert(hw);
+    assert(bms);
+
+    bms_bus_t* bus = _findBus(hw);
+
+    if(bus == NULL || bus->memberCount >= C_BMS_BUS_MEMBERS_MAX || bms_bus_lookup(bus, slaveID) != NULL)
+    {
+        if(bus != NULL && bus->memberCount == 0)
+        {
+            bus->used = false;
+        }
+        return NULL;
+    }
+
+    uint32_t index = SLOT_INDEX(slaveID);
+    while(bus->slots[index].bms != NULL)
+    {
+        index = SLOT_INDEX(index + 1u);
+    }
+    bus->slots[index].bms = bms;
+    bus->slots[index].slaveID = slaveID;
+    bus->slots[index].round = 0;
+    bus->memberCount++;
+    _updateFilter(bus);
+    _restartRound(bus);
+
+    return bus;
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+void bms_bus_deinit(void)
+{
+    if(_initialized)
+    {
+        for(uint8_t i = 0; i < C_BMS_BUS_INSTANCES_MAX; i++)
+        {
+            memset(&_instances[i], 0, sizeof(bms_bus_t));
+        }
+        _initialized = false;
+    }
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+void bms_bus_init(void)
+{
+    if(!_initialized)
+    {
+        for(uint8_t i = 0; i < C_BMS_BUS_INSTANCES_MAX; i++)
+        {
+            _instances[i].used = false;
+        }
+        _initialized = true;
+    }
+}
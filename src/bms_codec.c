@@ -0,0 +1,239 @@
+/**************************************************************************
+bms_codec.c
+ Created on: Mar 14, 2026
+     Author: M. Schermutzki
+***************************************************************************/
+/*** includes *************************************************************/
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+#include "bms_codec.h"
+/*** local constants ******************************************************/
+static const uint8_t C_VARINT_MORE  =   0x80u;
+static const uint8_t C_VARINT_BITS  =   0x7Fu;
+static const uint8_t C_INDEX_BITS   =   5u;         // channel count and index gaps, BMS_CODEC_CHANNELS < 32
+static const int64_t C_JITTER_SHARE =   8;          // a time within step / 8 of the grid keeps the grid
+/*** structures ***********************************************************/
+/* Layout of one sample:
+ *  varint  zig-zag of the time - predicted time << 5 | number of changed
+ *          channels. The time is predicted on a grid of the sample 
+ *          period, a jittered sample does not move the grid.
+ *  varint  per changed channel: zig-zag delta << 5 | index gap to the 
+ *          previous changed channel. Channel 0 = total current, 
+ *          1 = total voltage - sum of the cells, 2.. = cells
+ * The first sample of a chunk is encoded against zero. A sample at the 
+ * usual rate without changes takes one byte, a 1 mV step one more. */
+/*** macros ***************************************************************/
+#define ZIGZAG32(value)     (((uint32_t)(value) << 1) ^ (uint32_t)((value) >> 31))
+#define ZIGZAG64(value)     (((uint64_t)(value) << 1) ^ (uint64_t)((value) >> 63))
+#define UNZIGZAG32(value)   ((int32_t)((value) >> 1) ^ -(int32_t)((value) & 1u))
+#define UNZIGZAG64(value)   ((int64_t)((value) >> 1) ^ -(int64_t)((value) & 1u))
+/*** local variables ******************************************************/
+/*** prototypes ***********************************************************/
+static size_t _putVarint(uint8_t* out, uint64_t value);
+static bool _getVarint(bms_decoder_t* decoder, uint64_t* value);
+static void _toChannels(const bms_sample_t* sample, int32_t* channel);
+static void _advanceGrid(uint64_t* gridTime, int64_t* step, uint32_t count, uint64_t timeUs, int64_t residual);
+/*** interrupt service routines *******************************************/
+/*** functions ************************************************************/
+/*=============================== PRIVATE ==========================================*/
+/***************************************************************************
+ * This function writes value as LEB128 varint and returns its length.
+ **************************************************************************/
+static size_t _putVarint(uint8_t* out, uint64_t value)
+{
+    size_t length = 0;
+
+    while(value > C_VARINT_BITS)
+    {
+        out[length++] = (uint8_t)((value & C_VARINT_BITS) | C_VARINT_MORE);
+        value >>= 7;
+    }
+    out[length++] = (uint8_t)value;
+    return length;
+}
+/***************************************************************************
+ * This function reads a LEB128 varint. Returns false at the end of the 
+ * chunk or on a truncated value.
+ **************************************************************************/
+static bool _getVarint(bms_decoder_t* decoder, uint64_t* value)
+{
+    uint64_t result = 0;
+
+    for(uint8_t shift = 0; shift < 64 && decoder->position < decoder->length; shift += 7)
+    {
+        uint8_t byte = decoder->buffer[decoder->position++];
+
+        result |= (uint64_t)(byte & C_VARINT_BITS) << shift;
+        if((byte & C_VARINT_MORE) == 0)
+        {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+/***************************************************************************
+ * This function maps a sample to the channels. The total voltage is kept 
+ * as its difference to the sum of the cells, which hardly changes when 
+ * the cells do.
+ **************************************************************************/
+static void _toChannels(const bms_sample_t* sample, int32_t* channel)
+{
+    uint32_t sum = 0;
+
+    channel[0] = sample->totalCurrent;
+    for(uint8_t cell = 0; cell < BMS_CELL_COUNT; cell++)
+    {
+        channel[2 + cell] = sample->cellVoltage[cell];
+        sum += sample->cellVoltage[cell];
+    }
+    channel[1] = (int32_t)(sample->totalVoltage - sum);
+}
+/***************************************************************************
+ * This function moves the time grid on after the count-th sample of a 
+ * chunk. A sample close to the grid advances it by one step, anything 
+ * else takes the new time and the distance to the last grid time as step.
+ * Encoder and decoder run it alike.
+ **************************************************************************/
+static void _advanceGrid(uint64_t* gridTime, int64_t* step, uint32_t count, uint64_t timeUs, int64_t residual)
+{
+    int64_t window = *step / C_JITTER_SHARE;
+
+    if(count > 2 && residual <= window && residual >= -window)
+    {
+        *gridTime += (uint64_t)*step;
+    }
+    else
+    {
+        *step = (count == 1) ? 0 : (int64_t)(timeUs - *gridTime);
+        *gridTime = timeUs;
+    }
+}
+/*=============================== PUBLIC ===========================================*/
+/***************************************************************************
+ * This function starts a new chunk in buffer. The next sample becomes its
+ * key frame.
+ **************************************************************************/
+void bms_codec_encoderInit(bms_encoder_t* encoder, uint8_t* buffer, size_t capacity)
+{
+    assert(encoder);
+    assert(buffer);
+
+    memset(encoder, 0, sizeof(bms_encoder_t));
+    encoder->buffer = buffer;
+    encoder->capacity = capacity;
+}
+/***************************************************************************
+ * This function appends a sample to the chunk. Only the time, the totals
+ * and the cell voltages are kept. Returns false and leaves the chunk 
+ * untouched if the sample does not fit, the caller then starts a new 
+ * chunk.
+ **************************************************************************/
+bool bms_codec_encode(bms_encoder_t* encoder, const bms_sample_t* sample)
+{
+    assert(encoder);
+    assert(sample);
+
+    uint8_t scratch[BMS_CODEC_SAMPLE_MAX];
+    int32_t channel[BMS_CODEC_CHANNELS];
+    uint8_t changed = 0;
+    size_t length = 0;
+
+    _toChannels(sample, channel);
+    for(uint8_t i = 0; i < BMS_CODEC_CHANNELS; i++)
+    {
+        changed += (channel[i] != encoder->last[i]);
+    }
+
+    int64_t residual = (int64_t)(sample->timeUs - (encoder->gridTime + (uint64_t)encoder->step));
+    length += _putVarint(&scratch[length], (ZIGZAG64(residual) << C_INDEX_BITS) | changed);
+
+    uint8_t next = 0;
+    for(uint8_t i = 0; i < BMS_CODEC_CHANNELS; i++)
+    {
+        if(channel[i] != encoder->last[i])
+        {
+            int32_t delta = (int32_t)((uint32_t)channel[i] - (uint32_t)encoder->last[i]);
+            length += _putVarint(&scratch[length], ((uint64_t)ZIGZAG32(delta) << C_INDEX_BITS) | (uint8_t)(i - next));
+            next = (uint8_t)(i + 1u);
+        }
+    }
+
+    if(encoder->length + length > encoder->capacity)
+    {
+        return false;
+    }
+    memcpy(&encoder->buffer[encoder->length], scratch, length);
+    encoder->length += length;
+    encoder->count++;
+    _advanceGrid(&encoder->gridTime, &encoder->step, encoder->count, sample->timeUs, residual);
+    memcpy(encoder->last, channel, sizeof(channel));
+    return true;
+}
+/***************************************************************************
+ * This function starts decoding a chunk of length bytes.
+ **************************************************************************/
+void bms_codec_decoderInit(bms_decoder_t* decoder, const uint8_t* buffer, size_t length)
+{
+    assert(decoder);
+    assert(buffer || length == 0);
+
+    memset(decoder, 0, sizeof(bms_decoder_t));
+    decoder->buffer = buffer;
+    decoder->length = length;
+}
+/***************************************************************************
+ * This function decodes the next sample of the chunk. Fields the codec 
+ * does not keep are zero. Returns false at the end of the chunk.
+ **************************************************************************/
+bool bms_codec_decode(bms_decoder_t* decoder, bms_sample_t* sample)
+{
+    assert(decoder);
+    assert(sample);
+
+    uint64_t header;
+
+    if(!_getVarint(decoder, &header))
+    {
+        return false;
+    }
+
+    int64_t residual = UNZIGZAG64(header >> C_INDEX_BITS);
+    uint8_t changed = (uint8_t)(header & ((1u << C_INDEX_BITS) - 1u));
+    uint8_t next = 0;
+
+    for(uint8_t n = 0; n < changed; n++)
+    {
+        uint64_t token;
+
+        if(!_getVarint(decoder, &token))
+        {
+            return false;
+        }
+
+        uint8_t i = (uint8_t)(next + (token & ((1u << C_INDEX_BITS) - 1u)));
+        if(i >= BMS_CODEC_CHANNELS)
+        {
+            return false;
+        }
+        decoder->last[i] = (int32_t)((uint32_t)decoder->last[i] + (uint32_t)UNZIGZAG32((uint32_t)(token >> C_INDEX_BITS)));
+        next = (uint8_t)(i + 1u);
+    }
+
+    uint64_t timeUs = decoder->gridTime + (uint64_t)decoder->step + (uint64_t)residual;
+    decoder->count++;
+    _advanceGrid(&decoder->gridTime, &decoder->step, decoder->count, timeUs, residual);
+
+    uint32_t sum = 0;
+    memset(sample, 0, sizeof(bms_sample_t));
+    sample->timeUs = timeUs;
+    sample->totalCurrent = decoder->last[0];
+    for(uint8_t cell = 0; cell < BMS_CELL_COUNT; cell++)
+    {
+        sample->cellVoltage[cell] = (uint16_t)decoder->last[2 + cell];
+        sum += sample->cellVoltage[cell];
+    }
+    sample->totalVoltage = (uint32_t)decoder->last[1] + sum;
+    return true;
+}
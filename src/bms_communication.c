@@ -7,38 +7,27 @@ bms_communication.c
 #include <assert.h>
 #include <stdbool.h>
 #include <string.h>
+#include "bms_bus.h"
 #include "bms_communication.h"
 #include "generic_hardware_interface.h"
-#include "interrupt_handler.h"
+#include "seqlock.h"
 /*** local constants ******************************************************/
-#define C_BMS_COM_INSTANCES_MAX (2)
+#ifndef BMS_COM_INSTANCES_MAX
+#define BMS_COM_INSTANCES_MAX   (2)     // size of the built-in pool, set with -DBMS_COM_INSTANCES_MAX=n
+#endif
+#define C_BMS_COM_INSTANCES_MAX (BMS_COM_INSTANCES_MAX)
+#define C_BMS_PIPELINE_DEPTH_MAX (8)
+#define C_BMS_OBSERVERS_MAX     (8)
+static const uint32_t C_RESPONSE_TIMEOUT_US =   50000u;
+static const uint32_t C_WRITE_RETRY_US      =   1000u;  // first retry after a write the HAL did not take, doubles
+static const uint32_t C_WRITE_RETRY_MAX_US  =   100000u;
+static const uint64_t C_POLL_NEVER          =   UINT64_MAX;
+static const uint32_t C_MAX_AGE_PERIODS     =   3u;     // default max age in poll periods
+static const int16_t C_CELL_STATS_TOLERANCE_MV  =   5;  // allowed deviation from the BMS cell limits
+#define C_CELL_BLOCKS           (BMS_CELL_COUNT / BMS_CELL_BLOCK_SIZE)
 static const uint8_t C_DATA_REQUEST_BITS    =   14u;
 static const uint8_t C_DLC_BYTES            =   8u;
 /*** definitions***********************************************************/
-typedef enum
-{
-    E_BMS_CMD1_TOTAL_VALUES,
-    E_BMS_CMD1_CAPACITY,
-    E_BMS_CMD1_SOC_SOH,
-    E_BMS_CMD1_CELL_VLTG,
-    E_BMS_CMD1_ACCU_STATUS,
-    E_BMS_CMD1_ALARM_STATUS,
-    E_BMS_CMD1_PROTECT_B,
-    E_BMS_CMD1_CHASSIS_ID,
-    E_BMS_CMD1_BATTERY_STATUS,
-    E_BMS_CMD1_CELL_VLTG_1_TO_4,
-    E_BMS_CMD1_CELL_VLTG_5_TO_8,
-    E_BMS_CMD1_CELL_VLTG_9_TO_12,
-    E_BMS_CMD1_CELL_VLTG_13_TO_16,  
-    E_BMS_CMD2_TEMPERATURE_DATA1,
-    E_BMS_CMD2_TEMPERATURE_DATA2,
-    E_BMS_CMD2_TEMEPRATURE_DATA3,
-    E_BMS_CMD2_CHASSIS_VLTG,
-    E_BMS_CMD2_CHASSIS_TEMPERATURE, 
-    /*=============================*/
-    E_BMS_CMD_COUNT
-} bms_cmd_list_t;
-
 typedef enum
 {
     E_BMS_STATE_IDLE = 0,
@@ -49,6 +38,16 @@ typedef enum
 } bms_state_t;
 
 /*** structures ***********************************************************/
+typedef struct
+{
+    uint16_t min;
+    uint16_t max;
+    uint8_t minIndex;
+    uint8_t maxIndex;
+    uint32_t sum;
+    bool valid;
+} bms_block_stats_t;
+
 typedef struct 
 {
     uint32_t totalVoltage;
@@ -73,106 +72,228 @@ typedef struct
     uint16_t bmsFailure;
 
     uint16_t numberOfCells;
-    uint16_t cellVoltage[16];
+    uint16_t cellVoltage[BMS_CELL_COUNT];
+    bms_block_stats_t cellBlock[C_CELL_BLOCKS];
+    bms_cell_stats_t cellStats;
+
+    uint32_t sweepCount;        // completed sweeps
+    uint64_t updateTime;        // time of the last decoded response
+    uint64_t groupTime[E_BMS_GROUP_COUNT];  // time each group was decoded last
+    uint32_t validGroups;       // groups whose last request got answered
 }bms_data_t;
 
+typedef struct 
+{
+    uint8_t cmdFctTable;
+    uint8_t cmdID;
+    bms_group_t group;      // data group the response is decoded into
+    uint32_t periodMs;      // default poll period, 0 = once after start
+    uint32_t phaseMs;       // default offset of the first request
+} bms_command_t;
+
+typedef struct
+{
+    uint64_t nextDue;       // time of the next request in us
+    uint32_t periodMs;
+} bms_schedule_t;
+
+typedef struct
+{
+    uint8_t cmd;            // index into _command[]
+    uint64_t deadline;      // time in us after which the request is dropped
+    bool sent;              // transmit completion was reported
+    bool active;
+} bms_pending_t;
+
+typedef struct
+{
+    bms_observer_t callback;
+    void* context;
+    bms_field_t field;
+    bms_deadband_t deadbandType;
+    uint32_t deadband;      // field units, or per mille of the last notified value
+    uint16_t notified;      // per index: lastValue holds a notified value
+    int32_t lastValue[BMS_CELL_COUNT];  // only [0] is used by single value fields
+} bms_observer_entry_t;
+
 struct bms_com_s
 {
     void* handle;
-    bms_data_t data;
-    com_read_t read;
+    bms_data_t data;        // published, only written inside the seqlock write section
+    bms_data_t work;        // the running sweep is decoded into it, only used by the owner
+    seqlock_t lock;         // guards data
+    bms_bus_t* bus;         // owns comRead and comTxStatus of the handle
     com_write_t write;
+    com_write_batch_t writeBatch;
     com_open_t open;
     com_close_t close;
+    bool txStatus;          // HAL reports transmit completions
     uint32_t slaveID;
     bms_state_t state;
+    com_time_t time;
+    uint32_t subscription;  // mask of bms_group_t that get polled
+    uint32_t maxAgeMs[E_BMS_GROUP_COUNT];   // 0 = never stale
+    bms_observer_entry_t observer[C_BMS_OBSERVERS_MAX];
+    uint8_t observerCount;
+    bms_schedule_t schedule[E_BMS_CMD_COUNT];
     uint8_t sendCount;
+    uint8_t pipelineDepth;
+    uint8_t pendingCount;
+    bms_pending_t pending[C_BMS_PIPELINE_DEPTH_MAX];
+    uint32_t responseTimeoutUs;
+    uint32_t timeoutCount;
+    uint32_t txErrorCount;
+    uint64_t retryAt;       // no request is written before, 0 = no failed write
+    uint32_t retryDelayUs;  // backoff of the failed writes in a row
+    bool slotReleased;      // a transmit error freed a slot
+    can_frame_t inbox[C_BMS_PIPELINE_DEPTH_MAX];   // frames routed here by the bus
+    uint8_t inboxHead;
+    uint8_t inboxCount;
+    uint32_t inboxDropCount;
+    uint32_t lateCount;     // responses dropped because their request was no longer pending
+    uint8_t rxCmd;
     can_frame_t rxFrame;
+    uint8_t sweepRequests;  // requests sent in the current sweep
+    uint64_t sweepStart;
+    uint32_t sweepTimeUs;   // duration of the last completed sweep
     bool used;
 };
 
-typedef struct 
-{
-    uint8_t cmdFctTable;
-    uint8_t cmdID;
-} bms_command_t;
-
 /*** macros ***************************************************************/
+// copies one published value, the read is only repeated if a sweep was published in the meantime
+#define READ_PUBLISHED(bms, out, field) \
+    do \
+    { \
+        uint32_t _start; \
+        do \
+        { \
+            _start = seqlock_readBegin(&(bms)->lock); \
+            (out) = (bms)->data.field; \
+        } while(seqlock_readRetry(&(bms)->lock, _start)); \
+    } while(0)
 /*** local variables ******************************************************/
 static bool _initialized = false;
-static bms_com_t _instances[C_BMS_COM_INSTANCES_MAX];
+static bms_com_t _staticInstances[C_BMS_COM_INSTANCES_MAX];
+static bms_com_t* _instances = _staticInstances;
+static uint16_t _instanceCount = C_BMS_COM_INSTANCES_MAX;
 static const bms_command_t _command[E_BMS_CMD_COUNT] =
 {
-    [E_BMS_CMD1_TOTAL_VALUES]           =   {.cmdFctTable = 0x01, .cmdID = 0x00},               
-    [E_BMS_CMD1_CAPACITY]               =   {.cmdFctTable = 0x01, .cmdID = 0x01},     
-    [E_BMS_CMD1_SOC_SOH]                =   {.cmdFctTable = 0x01, .cmdID = 0x02},
-    [E_BMS_CMD1_CELL_VLTG]              =   {.cmdFctTable = 0x01, .cmdID = 0x03},
-    [E_BMS_CMD1_ACCU_STATUS]            =   {.cmdFctTable = 0x01, .cmdID = 0x04},   
-    [E_BMS_CMD1_ALARM_STATUS]           =   {.cmdFctTable = 0x01, .cmdID = 0x05},   
-    [E_BMS_CMD1_PROTECT_B]              =   {.cmdFctTable = 0x01, .cmdID = 0x06},
-    [E_BMS_CMD1_CHASSIS_ID]             =   {.cmdFctTable = 0x01, .cmdID = 0x07},
-    [E_BMS_CMD1_BATTERY_STATUS]         =   {.cmdFctTable = 0x01, .cmdID = 0x08},   
-    [E_BMS_CMD1_CELL_VLTG_1_TO_4]       =   {.cmdFctTable = 0x01, .cmdID = 0x09},       
-    [E_BMS_CMD1_CELL_VLTG_5_TO_8]       =   {.cmdFctTable = 0x01, .cmdID = 0x0A},       
-    [E_BMS_CMD1_CELL_VLTG_9_TO_12]      =   {.cmdFctTable = 0x01, .cmdID = 0x0B},       
-    [E_BMS_CMD1_CELL_VLTG_13_TO_16]     =   {.cmdFctTable = 0x01, .cmdID = 0x0C},           
-    [E_BMS_CMD2_TEMPERATURE_DATA1]      =   {.cmdFctTable = 0x02, .cmdID = 0x00},       
-    [E_BMS_CMD2_TEMPERATURE_DATA2]      =   {.cmdFctTable = 0x02, .cmdID = 0x01},       
-    [E_BMS_CMD2_TEMEPRATURE_DATA3]      =   {.cmdFctTable = 0x02, .cmdID = 0x02},       
-    [E_BMS_CMD2_CHASSIS_VLTG]           =   {.cmdFctTable = 0x02, .cmdID = 0x03},   
-    [E_BMS_CMD2_CHASSIS_TEMPERATURE]    =   {.cmdFctTable = 0x02, .cmdID = 0x04}                
+    [E_BMS_CMD1_TOTAL_VALUES]           =   {.cmdFctTable = 0x01, .cmdID = 0x00, .group = E_BMS_GROUP_TOTALS,              .periodMs =   200, .phaseMs = 0},               
+    [E_BMS_CMD1_CAPACITY]               =   {.cmdFctTable = 0x01, .cmdID = 0x01, .group = E_BMS_GROUP_CAPACITY,            .periodMs = 10000, .phaseMs = 0},     
+    [E_BMS_CMD1_SOC_SOH]                =   {.cmdFctTable = 0x01, .cmdID = 0x02, .group = E_BMS_GROUP_SOC_SOH,             .periodMs = 10000, .phaseMs = 0},
+    [E_BMS_CMD1_CELL_VLTG]              =   {.cmdFctTable = 0x01, .cmdID = 0x03, .group = E_BMS_GROUP_CELL_LIMITS,         .periodMs =   200, .phaseMs = 0},
+    [E_BMS_CMD1_ACCU_STATUS]            =   {.cmdFctTable = 0x01, .cmdID = 0x04, .group = E_BMS_GROUP_ACCU_STATUS,         .periodMs =  1000, .phaseMs = 0},   
+    [E_BMS_CMD1_ALARM_STATUS]           =   {.cmdFctTable = 0x01, .cmdID = 0x05, .group = E_BMS_GROUP_ALARMS,              .periodMs =   100, .phaseMs = 0},   
+    [E_BMS_CMD1_PROTECT_B]              =   {.cmdFctTable = 0x01, .cmdID = 0x06, .group = E_BMS_GROUP_PROTECTION,          .periodMs =   100, .phaseMs = 0},
+    [E_BMS_CMD1_CHASSIS_ID]             =   {.cmdFctTable = 0x01, .cmdID = 0x07, .group = E_BMS_GROUP_CHASSIS_ID,          .periodMs =     0, .phaseMs = 0},
+    [E_BMS_CMD1_BATTERY_STATUS]         =   {.cmdFctTable = 0x01, .cmdID = 0x08, .group = E_BMS_GROUP_BATTERY_STATUS,      .periodMs =  1000, .phaseMs = 0},   
+    [E_BMS_CMD1_CELL_VLTG_1_TO_4]       =   {.cmdFctTable = 0x01, .cmdID = 0x09, .group = E_BMS_GROUP_CELLS_1_TO_4,        .periodMs =   200, .phaseMs = 0},       
+    [E_BMS_CMD1_CELL_VLTG_5_TO_8]       =   {.cmdFctTable = 0x01, .cmdID = 0x0A, .group = E_BMS_GROUP_CELLS_5_TO_8,        .periodMs =   200, .phaseMs = 0},       
+    [E_BMS_CMD1_CELL_VLTG_9_TO_12]      =   {.cmdFctTable = 0x01, .cmdID = 0x0B, .group = E_BMS_GROUP_CELLS_9_TO_12,       .periodMs =   200, .phaseMs = 0},       
+    [E_BMS_CMD1_CELL_VLTG_13_TO_16]     =   {.cmdFctTable = 0x01, .cmdID = 0x0C, .group = E_BMS_GROUP_CELLS_13_TO_16,      .periodMs =   200, .phaseMs = 0},           
+    [E_BMS_CMD2_TEMPERATURE_DATA1]      =   {.cmdFctTable = 0x02, .cmdID = 0x00, .group = E_BMS_GROUP_TEMPERATURES,        .periodMs =  1000, .phaseMs = 0},       
+    [E_BMS_CMD2_TEMPERATURE_DATA2]      =   {.cmdFctTable = 0x02, .cmdID = 0x01, .group = E_BMS_GROUP_TEMPERATURES,        .periodMs =  1000, .phaseMs = 0},       
+    [E_BMS_CMD2_TEMEPRATURE_DATA3]      =   {.cmdFctTable = 0x02, .cmdID = 0x02, .group = E_BMS_GROUP_TEMPERATURE_DATA3,   .periodMs =  1000, .phaseMs = 0},       
+    [E_BMS_CMD2_CHASSIS_VLTG]           =   {.cmdFctTable = 0x02, .cmdID = 0x03, .group = E_BMS_GROUP_CHASSIS_VLTG,        .periodMs =  1000, .phaseMs = 0},   
+    [E_BMS_CMD2_CHASSIS_TEMPERATURE]    =   {.cmdFctTable = 0x02, .cmdID = 0x04, .group = E_BMS_GROUP_CHASSIS_TEMPERATURE, .periodMs =  1000, .phaseMs = 0}                
 };
 /*** prototypes ***********************************************************/
-static void _decodeFrame(bms_com_t* bms);
+static void _decodeFrame(bms_com_t* bms, uint8_t cmd);
+static void _updateBlockStats(bms_data_t* data, uint8_t block);
+static void _updateCellStats(bms_data_t* data);
+static bool _beyondDeadband(const bms_observer_entry_t* entry, int32_t last, int32_t value);
+static void _notify(bms_com_t* bms, bms_field_t field, uint8_t index, int32_t value);
+static void _readData(bms_com_t* bms, bms_data_t* data);
+static void _readGroups(bms_com_t* bms, bms_data_t* data);
+static void _publishData(bms_com_t* bms);
+static uint32_t _freshGroups(bms_com_t* bms, const bms_data_t* data, uint64_t now);
+static bms_pending_t* _findPending(bms_com_t* bms, uint32_t id);
+static bool _matchPending(bms_com_t* bms, uint32_t id, uint8_t* cmd);
+static void _releasePending(bms_com_t* bms, bms_pending_t* slot);
+static bool _popInbox(bms_com_t* bms, can_frame_t* frame);
+static void _dropInbox(bms_com_t* bms, uint32_t id);
+static uint32_t _requestId(bms_com_t* bms, uint8_t cmd);
+static bool _expirePending(bms_com_t* bms, uint64_t now);
+static void _addPending(bms_com_t* bms, uint8_t cmd, uint64_t now);
+static bool _isDue(bms_com_t* bms, uint8_t cmd, uint64_t now);
+static void _reschedule(bms_com_t* bms, uint8_t cmd, uint64_t now);
+static uint8_t _pipelineLimit(bms_com_t* bms);
+static bool _retryDue(bms_com_t* bms, uint64_t now);
+static void _sweepDone(bms_com_t* bms, uint64_t now);
 static bms_state_t _canStatemachine(bms_com_t* bms);
-static hal_status_t _sendCanFrame(bms_com_t* bms, bms_command_t cmd);
+static void _sendRequests(bms_com_t* bms, uint8_t limit, uint64_t now);
+static uint16_t _writeFrames(bms_com_t* bms, const can_frame_t* frames, uint16_t count);
 static void _buildCanFrame(bms_com_t* bms, bms_command_t cmd, can_frame_t* frame);
 /*** interrupt service routines *******************************************/
 /*** functions ************************************************************/
 /*=============================== PRIVATE ==========================================*/
-static void _decodeFrame(bms_com_t* bms)
+/***************************************************************************
+ * This function decodes a response into the back buffer. Readers do not 
+ * see the values before the sweep is published.
+ **************************************************************************/
+static void _decodeFrame(bms_com_t* bms, uint8_t cmd)
 {
 
-    uint8_t fct = _command[bms->sendCount].cmdFctTable;
-    uint8_t idx = _command[bms->sendCount].cmdID;
+    uint8_t fct = _command[cmd].cmdFctTable;
+    uint8_t idx = _command[cmd].cmdID;
     const uint8_t* d = bms->rxFrame.data;
+    bms_data_t* back = &bms->work;
+
+    back->updateTime = bms->time();
+    back->groupTime[_command[cmd].group] = back->updateTime;
+    back->validGroups |= BMS_GROUP_MASK(_command[cmd].group);
 
     if (fct == 0x01) 
     {
         switch (idx)
         {
             case 0x00: // Total Voltage (u32) & Current (i32)
-                bms->data.totalVoltage = (uint32_t)((d[3] << 24) | (d[2] << 16) | (d[1] << 8) | d[0]); 
-                bms->data.totalCurrent = (int32_t)((d[7] << 24) | (d[6] << 16) | (d[5] << 8) | d[4]); 
+                back->totalVoltage = (uint32_t)((d[3] << 24) | (d[2] << 16) | (d[1] << 8) | d[0]); 
+                back->totalCurrent = (int32_t)((d[7] << 24) | (d[6] << 16) | (d[5] << 8) | d[4]); 
+                _notify(bms, E_BMS_FIELD_TOTAL_VOLTAGE, 0, (int32_t)back->totalVoltage);
+                _notify(bms, E_BMS_FIELD_TOTAL_CURRENT, 0, back->totalCurrent);
                 break;
 
             case 0x01: // Full & Remaining Capacity (u32)
-                bms->data.fullChargeCapacity = (uint32_t)((d[3] << 24) | (d[2] << 16) | (d[1] << 8) | d[0]);
-                bms->data.remainingCapacity = (uint32_t)((d[7] << 24) | (d[6] << 16) | (d[5] << 8) | d[4]);
+                back->fullChargeCapacity = (uint32_t)((d[3] << 24) | (d[2] << 16) | (d[1] << 8) | d[0]);
+                back->remainingCapacity = (uint32_t)((d[7] << 24) | (d[6] << 16) | (d[5] << 8) | d[4]);
+                _notify(bms, E_BMS_FIELD_FULL_CAPACITY, 0, (int32_t)back->fullChargeCapacity);
+                _notify(bms, E_BMS_FIELD_REMAINING_CAPACITY, 0, (int32_t)back->remainingCapacity);
                 break;
 
             case 0x03: // Cell Limits & Diff 
-                bms->data.maxCellVoltage  = (uint16_t)((d[1] << 8) | d[0]);
-                bms->data.minCellVoltage  = (uint16_t)((d[3] << 8) | d[2]);
-                bms->data.cellDiffVoltage = (uint16_t)((d[5] << 8) | d[4]);
+                back->maxCellVoltage  = (uint16_t)((d[1] << 8) | d[0]);
+                back->minCellVoltage  = (uint16_t)((d[3] << 8) | d[2]);
+                back->cellDiffVoltage = (uint16_t)((d[5] << 8) | d[4]);
+                _notify(bms, E_BMS_FIELD_MAX_CELL_VOLTAGE, 0, back->maxCellVoltage);
+                _notify(bms, E_BMS_FIELD_MIN_CELL_VOLTAGE, 0, back->minCellVoltage);
+                _notify(bms, E_BMS_FIELD_CELL_DIFF_VOLTAGE, 0, back->cellDiffVoltage);
+                _updateCellStats(back);
                 break;
 
             case 0x05: // Alarm Status A & B 
-                bms->data.alarmStatusA = (uint16_t)((d[1] << 8) | d[0]);
-                bms->data.alarmStatusB = (uint16_t)((d[3] << 8) | d[2]);
+                back->alarmStatusA = (uint16_t)((d[1] << 8) | d[0]);
+                back->alarmStatusB = (uint16_t)((d[3] << 8) | d[2]);
+                _notify(bms, E_BMS_FIELD_ALARM_STATUS_A, 0, back->alarmStatusA);
+                _notify(bms, E_BMS_FIELD_ALARM_STATUS_B, 0, back->alarmStatusB);
                 break;
 
             case 0x06: // Protect A & B 
-                bms->data.protectA = (uint16_t)((d[1] << 8) | d[0]);
-                bms->data.protectB = (uint16_t)((d[3] << 8) | d[2]);
+                back->protectA = (uint16_t)((d[1] << 8) | d[0]);
+                back->protectB = (uint16_t)((d[3] << 8) | d[2]);
+                _notify(bms, E_BMS_FIELD_PROTECT_A, 0, back->protectA);
+                _notify(bms, E_BMS_FIELD_PROTECT_B, 0, back->protectB);
                 break;
 
             case 0x09: case 0x0A: case 0x0B: case 0x0C: 
             {
                 uint8_t startCell = (idx - 0x09) * 4;
                 for (int i = 0; i < 4; i++) {
-                    bms->data.cellVoltage[startCell + i] = (uint16_t)((d[i*2+1] << 8) | d[i*2]);
+                    back->cellVoltage[startCell + i] = (uint16_t)((d[i*2+1] << 8) | d[i*2]);
+                    _notify(bms, E_BMS_FIELD_CELL_VOLTAGE, (uint8_t)(startCell + i), back->cellVoltage[startCell + i]);
                 }
+                _updateBlockStats(back, (uint8_t)(idx - 0x09));
+                _updateCellStats(back);
                 break;
             }
         }
@@ -184,22 +305,425 @@ static void _decodeFrame(bms_com_t* bms)
         if (idx == 0x00) 
         { 
             uint16_t rawMax = (uint16_t)((d[1] << 8) | d[0]);
-            bms->data.maxTemperature = K_TO_C(rawMax); 
+            back->maxTemperature = K_TO_C(rawMax); 
+            _notify(bms, E_BMS_FIELD_MAX_TEMPERATURE, 0, (int16_t)back->maxTemperature);
         }
         else if (idx == 0x01) 
         { 
             uint16_t rawMin = (uint16_t)((d[1] << 8) | d[0]); 
-            bms->data.lowestTempertaure = K_TO_C(rawMin);
+            back->lowestTempertaure = K_TO_C(rawMin);
+            _notify(bms, E_BMS_FIELD_MIN_TEMPERATURE, 0, (int16_t)back->lowestTempertaure);
         }
     }
 }
+/***************************************************************************
+ * This function summarizes the four cells of a freshly decoded block.
+ **************************************************************************/
+static void _updateBlockStats(bms_data_t* data, uint8_t block)
+{
+    bms_block_stats_t* stats = &data->cellBlock[block];
+    uint8_t first = (uint8_t)(block * BMS_CELL_BLOCK_SIZE);
+
+    stats->min = UINT16_MAX;
+    stats->max = 0;
+    stats->sum = 0;
+
+    for(uint8_t cell = first; cell < first + BMS_CELL_BLOCK_SIZE; cell++)
+    {
+        uint16_t voltage = data->cellVoltage[cell];
+
+        if(voltage < stats->min)
+        {
+            stats->min = voltage;
+            stats->minIndex = cell;
+        }
+        if(voltage > stats->max)
+        {
+            stats->max = voltage;
+            stats->maxIndex = cell;
+        }
+        stats->sum += voltage;
+    }
+    stats->valid = true;
+}
+/***************************************************************************
+ * This function combines the block summaries into the cell statistics, 
+ * so a new block costs four cells plus four blocks instead of all cells.
+ * The result is compared with the cell limits the BMS reports itself.
+ **************************************************************************/
+static void _updateCellStats(bms_data_t* data)
+{
+    bms_cell_stats_t* stats = &data->cellStats;
+    uint32_t sum = 0;
+
+    memset(stats, 0, sizeof(bms_cell_stats_t));
+    stats->min = UINT16_MAX;
+
+    for(uint8_t block = 0; block < C_CELL_BLOCKS; block++)
+    {
+        const bms_block_stats_t* entry = &data->cellBlock[block];
+
+        if(!entry->valid)
+        {
+            continue;
+        }
+        if(entry->min < stats->min)
+        {
+            stats->min = entry->min;
+            stats->minIndex = entry->minIndex;
+        }
+        if(entry->max > stats->max)
+        {
+            stats->max = entry->max;
+            stats->maxIndex = entry->maxIndex;
+        }
+        sum += entry->sum;
+        stats->cellCount += BMS_CELL_BLOCK_SIZE;
+    }
+
+    if(stats->cellCount == 0)
+    {
+        stats->min = 0;
+        return;
+    }
+    stats->mean = (uint16_t)((sum + stats->cellCount / 2u) / stats->cellCount);
+    stats->spread = (uint16_t)(stats->max - stats->min);
+    stats->maxDeviation = (int16_t)((int32_t)stats->max - (int32_t)data->maxCellVoltage);
+    stats->minDeviation = (int16_t)((int32_t)stats->min - (int32_t)data->minCellVoltage);
+    stats->consistent = (stats->maxDeviation <= C_CELL_STATS_TOLERANCE_MV && stats->maxDeviation >= -C_CELL_STATS_TOLERANCE_MV &&
+                         stats->minDeviation <= C_CELL_STATS_TOLERANCE_MV && stats->minDeviation >= -C_CELL_STATS_TOLERANCE_MV);
+}
 /***************************************************************************
  * This function
  **************************************************************************/
+static bool _beyondDeadband(const bms_observer_entry_t* entry, int32_t last, int32_t value)
+{
+    int64_t delta = (int64_t)value - (int64_t)last;
+    int64_t reference = (int64_t)last;
+
+    if(delta < 0)
+    {
+        delta = -delta;
+    }
+    if(entry->deadbandType == E_BMS_DEADBAND_RELATIVE)
+    {
+        if(reference < 0)
+        {
+            reference = -reference;
+        }
+        return (delta * 1000) > ((int64_t)entry->deadband * reference);
+    }
+    return delta > (int64_t)entry->deadband;
+}
+/***************************************************************************
+ * This function calls the observers of a field for a freshly decoded 
+ * value. The first value is always reported, later ones when they moved
+ * beyond the deadband from the last reported value. Alarm and protect 
+ * words are reported on every bit flip, their deadband is ignored.
+ **************************************************************************/
+static void _notify(bms_com_t* bms, bms_field_t field, uint8_t index, int32_t value)
+{
+    for(uint8_t i = 0; i < bms->observerCount; i++)
+    {
+        bms_observer_entry_t* entry = &bms->observer[i];
+        uint16_t indexMask = (uint16_t)(1u << index);
+
+        if(entry->field != field)
+        {
+            continue;
+        }
+
+        if(entry->notified & indexMask)
+        {
+            int32_t last = entry->lastValue[index];
+            bool changed = (field >= E_BMS_FIELD_ALARM_STATUS_A && field <= E_BMS_FIELD_PROTECT_B) ?
+                           (value != last) : _beyondDeadband(entry, last, value);
+            if(!changed)
+            {
+                continue;
+            }
+        }
+        entry->notified |= indexMask;
+        entry->lastValue[index] = value;
+        entry->callback(bms, field, index, value, entry->context);
+    }
+}
+/***************************************************************************
+ * This function copies the published data without disabling interrupts. 
+ * The copy is only repeated if a sweep was published in the meantime.
+ **************************************************************************/
+static void _readData(bms_com_t* bms, bms_data_t* data)
+{
+    uint32_t start;
+
+    do
+    {
+        start = seqlock_readBegin(&bms->lock);
+        *data = bms->data;
+    } while(seqlock_readRetry(&bms->lock, start));
+}
+/***************************************************************************
+ * This function copies only the receive times and valid groups of the 
+ * published data, the rest of data is left as it is.
+ **************************************************************************/
+static void _readGroups(bms_com_t* bms, bms_data_t* data)
+{
+    uint32_t start;
+
+    do
+    {
+        start = seqlock_readBegin(&bms->lock);
+        memcpy(data->groupTime, bms->data.groupTime, sizeof(data->groupTime));
+        data->validGroups = bms->data.validGroups;
+    } while(seqlock_readRetry(&bms->lock, start));
+}
+/***************************************************************************
+ * This function returns the mask of groups that are valid and not older
+ * than their max age.
+ **************************************************************************/
+static uint32_t _freshGroups(bms_com_t* bms, const bms_data_t* data, uint64_t now)
+{
+    uint32_t fresh = 0;
+
+    for(uint8_t group = 0; group < E_BMS_GROUP_COUNT; group++)
+    {
+        if((data->validGroups & BMS_GROUP_MASK(group)) == 0)
+        {
+            continue;
+        }
+        if(bms->maxAgeMs[group] == 0 || 
+           now - data->groupTime[group] <= (uint64_t)bms->maxAgeMs[group] * 1000u)
+        {
+            fresh |= BMS_GROUP_MASK(group);
+        }
+    }
+    return fresh;
+}
+/***************************************************************************
+ * This function publishes the work buffer at the end of a sweep. It is 
+ * copied inside the write section, so a reader either gets the whole 
+ * sweep or repeats its copy. The work buffer keeps its values, groups 
+ * that are not polled in the next sweep keep their last state.
+ **************************************************************************/
+static void _publishData(bms_com_t* bms)
+{
+    bms->work.sweepCount = bms->data.sweepCount + 1u;
+
+    seqlock_writeBegin(&bms->lock);
+    bms->data = bms->work;
+    seqlock_writeEnd(&bms->lock);
+}
+/***************************************************************************
+ * This function searches the outstanding requests for the command that 
+ * belongs to the CAN ID.
+ **************************************************************************/
+static bms_pending_t* _findPending(bms_com_t* bms, uint32_t id)
+{
+    for(uint8_t i = 0; i < C_BMS_PIPELINE_DEPTH_MAX; i++)
+    {
+        bms_pending_t* slot = &bms->pending[i];
+
+        if(slot->active && id == _requestId(bms, slot->cmd))
+        {
+            return slot;
+        }
+    }
+    return NULL;
+}
+/***************************************************************************
+ * This function matches a response to its request and releases the slot.
+ * Responses may arrive in any order.
+ **************************************************************************/
+static bool _matchPending(bms_com_t* bms, uint32_t id, uint8_t* cmd)
+{
+    bms_pending_t* slot = _findPending(bms, id);
+
+    if(slot != NULL)
+    {
+        *cmd = slot->cmd;
+        slot->active = false;
+        bms->pendingCount--;
+        return true;
+    }
+    return false;
+}
+/***************************************************************************
+ * This function gives up an unanswered request. Its group is marked as 
+ * invalid with the next sweep. One shot requests are repeated until they
+ * get answered.
+ **************************************************************************/
+static void _releasePending(bms_com_t* bms, bms_pending_t* slot)
+{
+    bms->work.validGroups &= ~BMS_GROUP_MASK(_command[slot->cmd].group);
+
+    if(bms->schedule[slot->cmd].periodMs == 0)
+    {
+        bms->schedule[slot->cmd].nextDue = 0;
+    }
+    slot->active = false;
+    bms->pendingCount--;
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+static bool _popInbox(bms_com_t* bms, can_frame_t* frame)
+{
+    if(bms->inboxCount == 0)
+    {
+        return false;
+    }
+    *frame = bms->inbox[bms->inboxHead];
+    bms->inboxHead = (uint8_t)((bms->inboxHead + 1u) % C_BMS_PIPELINE_DEPTH_MAX);
+    bms->inboxCount--;
+    return true;
+}
+/***************************************************************************
+ * This function removes the frames with that CAN ID from the inbox. They
+ * answer a request that is no longer pending and must not be taken as the
+ * response to the next request of the same command.
+ **************************************************************************/
+static void _dropInbox(bms_com_t* bms, uint32_t id)
+{
+    uint8_t kept = 0;
+
+    for(uint8_t i = 0; i < bms->inboxCount; i++)
+    {
+        can_frame_t* frame = &bms->inbox[(bms->inboxHead + i) % C_BMS_PIPELINE_DEPTH_MAX];
+
+        if(frame->id == id)
+        {
+            bms->lateCount++;
+        }
+        else
+        {
+            bms->inbox[(bms->inboxHead + kept) % C_BMS_PIPELINE_DEPTH_MAX] = *frame;
+            kept++;
+        }
+    }
+    bms->inboxCount = kept;
+}
+/***************************************************************************
+ * This function returns the CAN ID of the request for a command, which is
+ * also the ID of its response.
+ **************************************************************************/
+static uint32_t _requestId(bms_com_t* bms, uint8_t cmd)
+{
+    return ((uint32_t)bms->slaveID << 12) | 
+           ((uint32_t)_command[cmd].cmdFctTable << 8) | 
+            (uint32_t)_command[cmd].cmdID;
+}
+/***************************************************************************
+ * This function drops all outstanding requests whose deadline passed.
+ * Returns true if at least one slot got free.
+ **************************************************************************/
+static bool _expirePending(bms_com_t* bms, uint64_t now)
+{
+    bool expired = false;
+
+    for(uint8_t i = 0; i < C_BMS_PIPELINE_DEPTH_MAX; i++)
+    {
+        bms_pending_t* slot = &bms->pending[i];
+
+        if(slot->active && now >= slot->deadline)
+        {
+            _dropInbox(bms, _requestId(bms, slot->cmd));
+            _releasePending(bms, slot);
+            bms->timeoutCount++;
+            expired = true;
+        }
+    }
+    return expired;
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+static void _addPending(bms_com_t* bms, uint8_t cmd, uint64_t now)
+{
+    for(uint8_t i = 0; i < C_BMS_PIPELINE_DEPTH_MAX; i++)
+    {
+        bms_pending_t* slot = &bms->pending[i];
+
+        if(!slot->active)
+        {
+            slot->cmd = cmd;
+            slot->deadline = now + bms->responseTimeoutUs;
+            slot->sent = !bms->txStatus;
+            slot->active = true;
+            bms->pendingCount++;
+            return;
+        }
+    }
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+static bool _isDue(bms_com_t* bms, uint8_t cmd, uint64_t now)
+{
+    if((bms->subscription & BMS_GROUP_MASK(_command[cmd].group)) == 0)
+    {
+        return false;
+    }
+    return (bms->schedule[cmd].nextDue <= now);
+}
+/***************************************************************************
+ * This function moves the due time of a sent command by one period. If
+ * the schedule fell behind by more than a period it is re-anchored to now
+ * instead of sending a burst of catch-up requests.
+ **************************************************************************/
+static void _reschedule(bms_com_t* bms, uint8_t cmd, uint64_t now)
+{
+    bms_schedule_t* entry = &bms->schedule[cmd];
+    uint64_t period = (uint64_t)entry->periodMs * 1000u;
+
+    if(period == 0)
+    {
+        entry->nextDue = C_POLL_NEVER;
+    }
+    else
+    {
+        entry->nextDue += period;
+        if(entry->nextDue <= now)
+        {
+            entry->nextDue = now + period;
+        }
+    }
+}
+/***************************************************************************
+ * This function returns how many requests may be in flight: the pipeline
+ * depth, but never more than the fair share of the bus.
+ **************************************************************************/
+static uint8_t _pipelineLimit(bms_com_t* bms)
+{
+    uint8_t share = bms_bus_getShare(bms->bus);
+    return (bms->pipelineDepth < share) ? bms->pipelineDepth : share;
+}
+/***************************************************************************
+ * This function tells if requests that did not fit into a write are to be
+ * tried again, the backoff passed and the pipeline has room for them.
+ **************************************************************************/
+static bool _retryDue(bms_com_t* bms, uint64_t now)
+{
+    return (bms->retryAt != 0 && now >= bms->retryAt && bms->pendingCount < _pipelineLimit(bms));
+}
+/***************************************************************************
+ * This function closes a sweep that sent at least one request and all of
+ * whose requests were answered or dropped, and publishes its data.
+ **************************************************************************/
+static void _sweepDone(bms_com_t* bms, uint64_t now)
+{
+    bms->sweepTimeUs = (uint32_t)(now - bms->sweepStart);
+    _publishData(bms);
+    bms->sweepRequests = 0;
+    bms_bus_sweepDone(bms->bus, bms->slaveID, now);
+}
+/***************************************************************************
+ * This function keeps up to pipelineDepth requests in flight. A depth of
+ * one is the classic send / wait / decode sequence. A sweep walks 
+ * _command[] once and only requests the commands that are due.
+ **************************************************************************/
 static bms_state_t _canStatemachine(bms_com_t* bms)
 {
     bool stateChanged = true;
-    static uint32_t timeoutRetry = 0; 
 
     while(stateChanged)
     {
@@ -208,56 +732,59 @@ static bms_state_t _canStatemachine(bms_com_t* bms)
         switch(bms->state)
         {
             case E_BMS_STATE_IDLE:
-                if(bms->sendCount < E_BMS_CMD_COUNT) 
+            {
+                uint64_t now = bms->time();
+
+                _sendRequests(bms, _pipelineLimit(bms), now);
+
+                if(bms->pendingCount > 0)
                 {
-                    if(_sendCanFrame(bms, _command[bms->sendCount]) == E_HAL_STATUS_OK) 
-                    {
-                        bms->state = E_BMS_STATE_WAIT_FOR_RESPONSE;
-                        timeoutRetry = 0; 
-                    }
+                    bms->state = E_BMS_STATE_WAIT_FOR_RESPONSE;
                 }
-                else 
+                else if(bms->sendCount >= E_BMS_CMD_COUNT)
                 {
+                    if(bms->sweepRequests > 0)
+                    {
+                        _sweepDone(bms, now);
+                    }
                     bms->sendCount = 0; 
                 }
-                break;
+            }
+            break;
 
             case E_BMS_STATE_WAIT_FOR_RESPONSE:
             {
                 can_frame_t frameBuffer; 
-                if(bms->read(bms->handle, &frameBuffer) == E_HAL_STATUS_OK)
-                {
-                    uint32_t expectedId = ((uint32_t)bms->slaveID << 12) | 
-                                          ((uint32_t)_command[bms->sendCount].cmdFctTable << 8) | 
-                                           (uint32_t)_command[bms->sendCount].cmdID;
+                bms_bus_poll(bms->bus);
 
-                    if (frameBuffer.id == expectedId) 
-                    {
-                        bms->rxFrame = frameBuffer;
-                        bms->state = E_BMS_STATE_EXTRACT_DATA;
-                        stateChanged = true; 
-                    }
+                if(bms->slotReleased)
+                {
+                    bms->slotReleased = false;
+                    bms->state = E_BMS_STATE_IDLE;
+                    stateChanged = true;
                 }
-                else 
+                else if(_popInbox(bms, &frameBuffer) &&
+                        _matchPending(bms, frameBuffer.id, &bms->rxCmd))
                 {
-                    timeoutRetry++;
-                    if(timeoutRetry > 100) {
-                        bms->sendCount++; 
-                        bms->state = E_BMS_STATE_IDLE;
-                        stateChanged = true;
-                    }
+                    bms->rxFrame = frameBuffer;
+                    bms->state = E_BMS_STATE_EXTRACT_DATA;
+                    stateChanged = true; 
+                }
+                else if(_expirePending(bms, bms->time()) || _retryDue(bms, bms->time()))
+                {
+                    bms->state = E_BMS_STATE_IDLE;
+                    stateChanged = true;
                 }
             }
             break;
 
             case E_BMS_STATE_EXTRACT_DATA:
-                _decodeFrame(bms); 
+                _decodeFrame(bms, bms->rxCmd); 
                 bms->state = E_BMS_STATE_NEW_DATA_AVALAIBLE;
                 stateChanged = true; 
                 break;
 
             case E_BMS_STATE_NEW_DATA_AVALAIBLE:
-                bms->sendCount++;
                 bms->state = E_BMS_STATE_IDLE;
                 //stateChanged = true; 
                 break;
@@ -285,14 +812,93 @@ static void _buildCanFrame(bms_com_t* bms, bms_command_t cmd, can_frame_t* frame
     }
 }
 /***************************************************************************
- * This function
+ * This function sends the due requests of the sweep that fit into the 
+ * pipeline with one write. Only the frames the HAL took become pending, 
+ * the sweep goes on with the first one it did not take. After a write 
+ * that was not taken completely the next one waits for a backoff.
  **************************************************************************/
-static hal_status_t _sendCanFrame(bms_com_t* bms, bms_command_t cmd)
+static void _sendRequests(bms_com_t* bms, uint8_t limit, uint64_t now)
 {
-    can_frame_t frame; 
-    _buildCanFrame(bms, cmd, &frame); 
-    
-    return bms->write(bms->handle, &frame, 1);
+    can_frame_t frames[C_BMS_PIPELINE_DEPTH_MAX];
+    uint8_t cmds[C_BMS_PIPELINE_DEPTH_MAX];
+    uint8_t count = 0;
+    uint8_t next = bms->sendCount;
+
+    while(bms->pendingCount + count < limit && next < E_BMS_CMD_COUNT)
+    {
+        if(_isDue(bms, next, now))
+        {
+            _buildCanFrame(bms, _command[next], &frames[count]);
+            cmds[count++] = next;
+        }
+        next++;
+    }
+
+    if(count > 0 && now < bms->retryAt)
+    {
+        return;
+    }
+
+    // responses that are still on their way to the inbox arrived before these requests were sent
+    if(count > 0)
+    {
+        bms_bus_poll(bms->bus);
+        for(uint8_t i = 0; i < count; i++)
+        {
+            _dropInbox(bms, frames[i].id);
+        }
+    }
+
+    uint16_t sent = _writeFrames(bms, frames, count);
+
+    for(uint16_t i = 0; i < sent; i++)
+    {
+        if(bms->sweepRequests == 0)
+        {
+            bms->sweepStart = now;
+        }
+        bms->sweepRequests++;
+        _reschedule(bms, cmds[i], now);
+        _addPending(bms, cmds[i], now);
+    }
+    bms->sendCount = (sent < count) ? cmds[sent] : next;
+
+    // the HAL is full or down, retry later instead of on every pass
+    if(sent < count)
+    {
+        bms->retryDelayUs = (bms->retryDelayUs == 0) ? C_WRITE_RETRY_US : bms->retryDelayUs * 2u;
+        bms->retryDelayUs = (bms->retryDelayUs > C_WRITE_RETRY_MAX_US) ? C_WRITE_RETRY_MAX_US : bms->retryDelayUs;
+        bms->retryAt = now + bms->retryDelayUs;
+    }
+    else if(count > 0)
+    {
+        bms->retryDelayUs = 0;
+        bms->retryAt = 0;
+    }
+}
+/***************************************************************************
+ * This function writes the frames in order and returns how many the HAL
+ * took. Without a batch write they are written one by one up to the first
+ * one that fails.
+ **************************************************************************/
+static uint16_t _writeFrames(bms_com_t* bms, const can_frame_t* frames, uint16_t count)
+{
+    uint16_t done = 0;
+
+    if(count == 0)
+    {
+        return 0;
+    }
+    if(bms->writeBatch != NULL)
+    {
+        bms->writeBatch(bms->handle, frames, count, &done);
+        return (done > count) ? count : done;
+    }
+    while(done < count && bms->write(bms->handle, &frames[done], 1) == E_HAL_STATUS_OK)
+    {
+        done++;
+    }
+    return done;
 }
 /*=============================== PUBLIC ===========================================*/
 /***************************************************************************
@@ -302,9 +908,8 @@ uint32_t bms_communication_getTotalVoltage(bms_com_t* bms)
 {
     assert(bms);
 
-    interrupt_handler_enterCritical();
-    uint32_t retval = bms->data.totalVoltage; 
-    interrupt_handler_leaveCritical();
+    uint32_t retval;
+    READ_PUBLISHED(bms, retval, totalVoltage);
 
     return retval;
 
@@ -315,9 +920,8 @@ uint32_t bms_communication_getTotalVoltage(bms_com_t* bms)
 int32_t bms_communication_getTotalCurrent(bms_com_t* bms) 
 {
     assert(bms);
-    interrupt_handler_enterCritical();
-    int32_t retval = bms->data.totalCurrent; 
-    interrupt_handler_leaveCritical();
+    int32_t retval;
+    READ_PUBLISHED(bms, retval, totalCurrent);
 
     return retval;
 }
@@ -328,9 +932,8 @@ uint32_t bms_communication_getFullCapacity(bms_com_t* bms)
 {
     assert(bms);
 
-    interrupt_handler_enterCritical();
-    uint32_t retval = bms->data.fullChargeCapacity; 
-    interrupt_handler_leaveCritical();
+    uint32_t retval;
+    READ_PUBLISHED(bms, retval, fullChargeCapacity);
     
     return retval;
 }
@@ -341,9 +944,8 @@ uint32_t bms_communication_getRemainingCapacity(bms_com_t* bms)
 {
     assert(bms);
 
-    interrupt_handler_enterCritical();
-    uint32_t retval = bms->data.remainingCapacity; 
-    interrupt_handler_leaveCritical();
+    uint32_t retval;
+    READ_PUBLISHED(bms, retval, remainingCapacity);
 
     return retval;
 
@@ -355,15 +957,37 @@ uint16_t bms_communication_getCellVoltage(bms_com_t* bms, uint8_t cellIndex)
 {
     assert(bms);
 
-    if (cellIndex >= 16) return 0xFFFF; 
+    if (cellIndex >= BMS_CELL_COUNT) return 0xFFFF; 
 
-    interrupt_handler_enterCritical();
-    uint16_t retval = bms->data.cellVoltage[cellIndex]; 
-    interrupt_handler_leaveCritical();
+    uint16_t retval;
+    READ_PUBLISHED(bms, retval, cellVoltage[cellIndex]);
 
     return retval;
 
 }
+/***************************************************************************
+ * This function copies all cell voltages in one read.
+ **************************************************************************/
+void bms_communication_getCellVoltages(bms_com_t* bms, uint16_t cellVoltage[BMS_CELL_COUNT])
+{
+    assert(bms);
+    assert(cellVoltage);
+
+    bms_data_t data;
+    _readData(bms, &data);
+    memcpy(cellVoltage, data.cellVoltage, sizeof(data.cellVoltage));
+}
+/***************************************************************************
+ * This function returns the cell statistics of the published sweep. They
+ * are kept up to date while the cell blocks are decoded.
+ **************************************************************************/
+void bms_communication_getCellStats(bms_com_t* bms, bms_cell_stats_t* stats)
+{
+    assert(bms);
+    assert(stats);
+
+    READ_PUBLISHED(bms, *stats, cellStats);
+}
 /***************************************************************************
  * This function
  **************************************************************************/
@@ -371,9 +995,8 @@ uint16_t bms_communication_getMaxCellVoltage(bms_com_t* bms)
 {
     assert(bms);
 
-    interrupt_handler_enterCritical();
-    uint16_t retval = bms->data.maxCellVoltage; 
-    interrupt_handler_leaveCritical();
+    uint16_t retval;
+    READ_PUBLISHED(bms, retval, maxCellVoltage);
 
     return retval;
 
@@ -385,9 +1008,8 @@ uint16_t bms_communication_getMinCellVoltage(bms_com_t* bms)
 {
     assert(bms);
 
-    interrupt_handler_enterCritical();
-    uint16_t retval = bms->data.minCellVoltage; 
-    interrupt_handler_leaveCritical();
+    uint16_t retval;
+    READ_PUBLISHED(bms, retval, minCellVoltage);
 
     return retval;
 
@@ -399,9 +1021,9 @@ int16_t bms_communication_getMaxTemperature(bms_com_t* bms)
 {
     assert(bms);
 
-    interrupt_handler_enterCritical();
-    int16_t retval =  (int16_t)bms->data.maxTemperature; 
-    interrupt_handler_leaveCritical();
+    uint16_t raw;
+    READ_PUBLISHED(bms, raw, maxTemperature);
+    int16_t retval = (int16_t)raw;
 
     return retval;
 
@@ -413,9 +1035,9 @@ int16_t bms_communication_getMinTemperature(bms_com_t* bms)
 {
     assert(bms);
 
-    interrupt_handler_enterCritical();
-    int16_t retval = (int16_t)bms->data.lowestTempertaure; 
-    interrupt_handler_leaveCritical();
+    uint16_t raw;
+    READ_PUBLISHED(bms, raw, lowestTempertaure);
+    int16_t retval = (int16_t)raw;
 
     return retval;
 
@@ -427,9 +1049,8 @@ uint16_t bms_communication_getAlarmStatusA(bms_com_t* bms)
 {
     assert(bms);
 
-    interrupt_handler_enterCritical();
-    uint16_t retval = bms->data.alarmStatusA; 
-    interrupt_handler_leaveCritical();
+    uint16_t retval;
+    READ_PUBLISHED(bms, retval, alarmStatusA);
 
     return retval;
 
@@ -441,9 +1062,8 @@ uint16_t bms_communication_getAlarmStatusB(bms_com_t* bms)
 {
     assert(bms);
 
-    interrupt_handler_enterCritical();
-    uint16_t retval = bms->data.alarmStatusB; 
-    interrupt_handler_leaveCritical();
+    uint16_t retval;
+    READ_PUBLISHED(bms, retval, alarmStatusB);
 
     return retval;
 
@@ -455,9 +1075,8 @@ uint16_t bms_communication_getProtectA(bms_com_t* bms)
 {
     assert(bms);
 
-    interrupt_handler_enterCritical();
-    uint16_t retval = bms->data.protectA; 
-    interrupt_handler_leaveCritical();
+    uint16_t retval;
+    READ_PUBLISHED(bms, retval, protectA);
 
     return retval;
 
@@ -469,12 +1088,411 @@ uint16_t bms_communication_getProtectB(bms_com_t* bms)
 {
     assert(bms);
 
-    interrupt_handler_enterCritical();
-    uint16_t retval = bms->data.protectB; 
-    interrupt_handler_leaveCritical();
+    uint16_t retval;
+    READ_PUBLISHED(bms, retval, protectB);
 
     return retval;
 }
+/***************************************************************************
+ * This function copies all decoded values in one consistent read, so 
+ * they can not change while the copy is taken. Prefer it over the single 
+ * getters when several values are needed.
+ **************************************************************************/
+void bms_communication_getSnapshot(bms_com_t* bms, bms_snapshot_t* snapshot)
+{
+    assert(bms);
+    assert(snapshot);
+
+    bms_data_t data;
+    _readData(bms, &data);
+
+    snapshot->sequence = data.sweepCount;
+    snapshot->timestampUs = data.updateTime;
+    snapshot->freshGroups = _freshGroups(bms, &data, bms->time());
+    snapshot->totalVoltage = data.totalVoltage;
+    snapshot->totalCurrent = data.totalCurrent;
+    snapshot->fullCapacity = data.fullChargeCapacity;
+    snapshot->remainingCapacity = data.remainingCapacity;
+    snapshot->maxCellVoltage = data.maxCellVoltage;
+    snapshot->minCellVoltage = data.minCellVoltage;
+    snapshot->cellDiffVoltage = data.cellDiffVoltage;
+    snapshot->maxTemperature = (int16_t)data.maxTemperature;
+    snapshot->minTemperature = (int16_t)data.lowestTempertaure;
+    snapshot->alarmStatusA = data.alarmStatusA;
+    snapshot->alarmStatusB = data.alarmStatusB;
+    snapshot->protectA = data.protectA;
+    snapshot->protectB = data.protectB;
+    memcpy(snapshot->cellVoltage, data.cellVoltage, sizeof(snapshot->cellVoltage));
+    snapshot->cellStats = data.cellStats;
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+uint32_t bms_communication_getSubscription(bms_com_t* bms)
+{
+    assert(bms);
+    return bms->subscription;
+}
+/***************************************************************************
+ * This function selects the data groups (BMS_GROUP_MASK) that get polled.
+ * Commands of all other groups are skipped by the state machine, requests
+ * that are already in flight are still completed.
+ **************************************************************************/
+void bms_communication_setSubscription(bms_com_t* bms, uint32_t groupMask)
+{
+    assert(bms);
+    bms->subscription = groupMask & BMS_GROUP_MASK_ALL;
+}
+/***************************************************************************
+ * This function registers a callback for a decoded field. It is called 
+ * from bms_communication_cyclic as soon as a response is decoded, before
+ * the sweep is published, so it gets the new value as argument. Returns
+ * false if no observer slot is left.
+ **************************************************************************/
+bool bms_communication_addObserver(bms_com_t* bms, bms_field_t field, bms_deadband_t deadbandType, 
+                                   uint32_t deadband, bms_observer_t callback, void* context)
+{
+    assert(bms);
+    assert(field < E_BMS_FIELD_COUNT);
+    assert(callback);
+
+    if(bms->observerCount >= C_BMS_OBSERVERS_MAX)
+    {
+        return false;
+    }
+
+    bms_observer_entry_t* entry = &bms->observer[bms->observerCount];
+    memset(entry, 0, sizeof(bms_observer_entry_t));
+    entry->callback = callback;
+    entry->context = context;
+    entry->field = field;
+    entry->deadbandType = deadbandType;
+    entry->deadband = deadband;
+    bms->observerCount++;
+    return true;
+}
+/***************************************************************************
+ * This function removes every registration of the callback / context 
+ * pair.
+ **************************************************************************/
+void bms_communication_removeObserver(bms_com_t* bms, bms_observer_t callback, void* context)
+{
+    assert(bms);
+
+    uint8_t kept = 0;
+
+    for(uint8_t i = 0; i < bms->observerCount; i++)
+    {
+        if(bms->observer[i].callback != callback || bms->observer[i].context != context)
+        {
+            bms->observer[kept++] = bms->observer[i];
+        }
+    }
+    bms->observerCount = kept;
+}
+/***************************************************************************
+ * This function overrides the poll period and phase of one command. A 
+ * period of zero requests the command once, phaseMs after this call.
+ **************************************************************************/
+void bms_communication_setPollPeriod(bms_com_t* bms, bms_cmd_list_t cmd, uint32_t periodMs, uint32_t phaseMs)
+{
+    assert(bms);
+    assert(cmd < E_BMS_CMD_COUNT);
+
+    bms->schedule[cmd].periodMs = periodMs;
+    bms->schedule[cmd].nextDue = bms->time() + (uint64_t)phaseMs * 1000u;
+}
+/***************************************************************************
+ * This function sets the age after which the values of a group count as
+ * stale. Zero disables the check. The default is three poll periods of 
+ * the group, setPollPeriod does not change it.
+ **************************************************************************/
+void bms_communication_setMaxAge(bms_com_t* bms, bms_group_t group, uint32_t maxAgeMs)
+{
+    assert(bms);
+    assert(group < E_BMS_GROUP_COUNT);
+    bms->maxAgeMs[group] = maxAgeMs;
+}
+/***************************************************************************
+ * This function returns the time in us since the published values of a 
+ * group were received, UINT64_MAX if they never were.
+ **************************************************************************/
+uint64_t bms_communication_getAge(bms_com_t* bms, bms_group_t group)
+{
+    assert(bms);
+    assert(group < E_BMS_GROUP_COUNT);
+
+    bms_data_t data;
+    _readGroups(bms, &data);
+
+    if(data.groupTime[group] == 0 && (data.validGroups & BMS_GROUP_MASK(group)) == 0)
+    {
+        return UINT64_MAX;
+    }
+    return bms->time() - data.groupTime[group];
+}
+/***************************************************************************
+ * This function returns true if the last request of the group got 
+ * answered and the values are not older than the max age.
+ **************************************************************************/
+bool bms_communication_isFresh(bms_com_t* bms, bms_group_t group)
+{
+    assert(group < E_BMS_GROUP_COUNT);
+    return (bms_communication_getFreshGroups(bms) & BMS_GROUP_MASK(group)) != 0;
+}
+/***************************************************************************
+ * This function returns the mask of all fresh groups (BMS_GROUP_MASK). A 
+ * control loop can compare it against the groups it depends on in one go.
+ **************************************************************************/
+uint32_t bms_communication_getFreshGroups(bms_com_t* bms)
+{
+    assert(bms);
+
+    bms_data_t data;
+    _readGroups(bms, &data);
+    return _freshGroups(bms, &data, bms->time());
+}
+/***************************************************************************
+ * This function returns the number of requests that were dropped because
+ * no response arrived before their deadline.
+ **************************************************************************/
+uint32_t bms_communication_getTimeoutCount(bms_com_t* bms)
+{
+    assert(bms);
+    return bms->timeoutCount;
+}
+/***************************************************************************
+ * This function queues a frame the bus routed to this instance. It is 
+ * matched against the pending requests in the next wait state.
+ **************************************************************************/
+void bms_communication_receive(bms_com_t* bms, const can_frame_t* frame)
+{
+    assert(bms);
+    assert(frame);
+
+    if(bms->inboxCount >= C_BMS_PIPELINE_DEPTH_MAX)
+    {
+        bms->inboxDropCount++;
+        return;
+    }
+    uint8_t tail = (uint8_t)((bms->inboxHead + bms->inboxCount) % C_BMS_PIPELINE_DEPTH_MAX);
+    bms->inbox[tail] = *frame;
+    bms->inboxCount++;
+}
+/***************************************************************************
+ * This function takes a transmit completion routed here by the bus. A 
+ * request waits for its response from the moment the frame actually left
+ * the controller, a failed transmission frees its slot right away.
+ **************************************************************************/
+void bms_communication_txComplete(bms_com_t* bms, const can_tx_status_t* txStatus)
+{
+    assert(bms);
+    assert(txStatus);
+
+    bms_pending_t* slot = _findPending(bms, txStatus->id);
+
+    if(slot == NULL || slot->sent)
+    {
+        return;
+    }
+
+    if(txStatus->status == E_HAL_STATUS_OK)
+    {
+        slot->sent = true;
+        slot->deadline = bms->time() + bms->responseTimeoutUs;
+    }
+    else
+    {
+        _releasePending(bms, slot);
+        bms->txErrorCount++;
+        bms->slotReleased = true;
+    }
+}
+/***************************************************************************
+ * This function is called by the bus after the controller went bus-off.
+ * Requests in flight and responses not yet matched were lost with the
+ * reset of the controller, so all slots are freed and the requests count
+ * as transmit errors.
+ **************************************************************************/
+void bms_communication_busOff(bms_com_t* bms)
+{
+    assert(bms);
+
+    for(uint8_t i = 0; i < C_BMS_PIPELINE_DEPTH_MAX; i++)
+    {
+        if(bms->pending[i].active)
+        {
+            _releasePending(bms, &bms->pending[i]);
+            bms->txErrorCount++;
+            bms->slotReleased = true;
+        }
+    }
+    bms->inboxCount = 0;
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+bms_bus_t* bms_communication_getBus(bms_com_t* bms)
+{
+    assert(bms);
+    return bms->bus;
+}
+/***************************************************************************
+ * This function returns the duration in us of the last completed sweep,
+ * from its first request until its last response or timeout.
+ **************************************************************************/
+uint32_t bms_communication_getSweepTime(bms_com_t* bms)
+{
+    assert(bms);
+    return bms->sweepTimeUs;
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+uint32_t bms_communication_getSweepCount(bms_com_t* bms)
+{
+    assert(bms);
+    uint32_t retval;
+    READ_PUBLISHED(bms, retval, sweepCount);
+    return retval;
+}
+/***************************************************************************
+ * This function returns true once per published sweep. lastSeen holds the
+ * sweep the caller consumed last and is updated, start it with 0.
+ **************************************************************************/
+bool bms_communication_newSweepAvailable(bms_com_t* bms, uint32_t* lastSeen)
+{
+    assert(bms);
+    assert(lastSeen);
+
+    uint32_t sweepCount = bms_communication_getSweepCount(bms);
+
+    if(sweepCount == *lastSeen)
+    {
+        return false;
+    }
+    *lastSeen = sweepCount;
+    return true;
+}
+/***************************************************************************
+ * This function returns how often a reader found the state machine in the
+ * middle of an update and had to wait for it.
+ **************************************************************************/
+uint32_t bms_communication_getReadContentionCount(bms_com_t* bms)
+{
+    assert(bms);
+    return seqlock_getContentionCount(&bms->lock);
+}
+/***************************************************************************
+ * This function returns how often a reader had to repeat its copy because
+ * the data changed underneath it.
+ **************************************************************************/
+uint32_t bms_communication_getReadRetryCount(bms_com_t* bms)
+{
+    assert(bms);
+    return seqlock_getRetryCount(&bms->lock);
+}
+/***************************************************************************
+ * This function returns the number of responses that arrived after their
+ * request had timed out and were dropped.
+ **************************************************************************/
+uint32_t bms_communication_getLateResponseCount(bms_com_t* bms)
+{
+    assert(bms);
+    return bms->lateCount;
+}
+/***************************************************************************
+ * This function returns the number of requests the HAL failed to transmit.
+ **************************************************************************/
+uint32_t bms_communication_getTxErrorCount(bms_com_t* bms)
+{
+    assert(bms);
+    return bms->txErrorCount;
+}
+/***************************************************************************
+ * This function sets how long a request waits for its response, measured
+ * from the moment it was sent (or reported as transmitted by the HAL).
+ **************************************************************************/
+void bms_communication_setResponseTimeout(bms_com_t* bms, uint32_t timeoutUs)
+{
+    assert(bms);
+    bms->responseTimeoutUs = timeoutUs;
+}
+/***************************************************************************
+ * This function sets the number of requests that may be outstanding at 
+ * once. Values are clamped to 1..C_BMS_PIPELINE_DEPTH_MAX.
+ **************************************************************************/
+void bms_communication_setPipelineDepth(bms_com_t* bms, uint8_t depth)
+{
+    assert(bms);
+
+    if(depth == 0)
+    {
+        depth = 1;
+    }
+    else if(depth > C_BMS_PIPELINE_DEPTH_MAX)
+    {
+        depth = C_BMS_PIPELINE_DEPTH_MAX;
+    }
+    bms->pipelineDepth = depth;
+}
+/***************************************************************************
+ * This function returns the time in us at which bms_communication_cyclic
+ * has work to do next unless a frame arrives first: the next poll that 
+ * is due, the deadline of an outstanding request or the retry of a write
+ * the HAL did not take. 0 means at once, 
+ * UINT64_MAX never.
+ **************************************************************************/
+uint64_t bms_communication_getNextDeadline(bms_com_t* bms)
+{
+    assert(bms);
+
+    uint64_t retval = UINT64_MAX;
+
+    if(bms->state == E_BMS_STATE_WAIT_FOR_RESPONSE)
+    {
+        if(bms->slotReleased || bms->inboxCount > 0)
+        {
+            return 0;
+        }
+
+        for(uint8_t i = 0; i < C_BMS_PIPELINE_DEPTH_MAX; i++)
+        {
+            if(bms->pending[i].active && bms->pending[i].deadline < retval)
+            {
+                retval = bms->pending[i].deadline;
+            }
+        }
+        if(bms->retryAt != 0 && bms->retryAt < retval && bms->pendingCount < _pipelineLimit(bms))
+        {
+            retval = bms->retryAt;
+        }
+        return retval;
+    }
+
+    // a sweep that is under way or data that waits to be handed over
+    if(bms->state != E_BMS_STATE_IDLE || bms->sendCount != 0)
+    {
+        retval = 0;
+    }
+    else
+    {
+        for(uint8_t cmd = 0; cmd < E_BMS_CMD_COUNT; cmd++)
+        {
+            if((bms->subscription & BMS_GROUP_MASK(_command[cmd].group)) != 0 && bms->schedule[cmd].nextDue < retval)
+            {
+                retval = bms->schedule[cmd].nextDue;
+            }
+        }
+    }
+
+    // a failed write is not retried before its backoff
+    if(bms->state == E_BMS_STATE_IDLE && bms->retryAt > retval)
+    {
+        retval = bms->retryAt;
+    }
+    return retval;
+}
 /***************************************************************************
  * This function
  **************************************************************************/
@@ -503,26 +1521,69 @@ bms_com_t* bms_communication_new(const hardware_interface_t* hw, uint32_t slaveI
 {
     assert(_initialized);
     assert(hw);
+    assert(hw->comTime);
 
-    for(uint8_t i = 0; i < C_BMS_COM_INSTANCES_MAX; i++)
+    for(uint16_t i = 0; i < _instanceCount; i++)
     {
         if(!_instances[i].used)
         {
             bms_com_t* retval = &_instances[i];
+            memset(retval, 0, sizeof(bms_com_t));
+            seqlock_init(&retval->lock);
+            retval->bus = bms_bus_attach(hw, retval, slaveID);
+            if(retval->bus == NULL)
+            {
+                return NULL;
+            }
             retval->handle = hw->halHandle;
-            retval->read = hw->comRead;
             retval->write = hw->comWrite;
+            retval->writeBatch = hw->comWriteBatch;
             retval->open = hw->comOpen;
             retval->close = hw->comClose;
+            retval->time = hw->comTime;
+            retval->txStatus = (hw->comTxStatus != NULL);
             retval->slaveID = slaveID;
             retval->state = E_BMS_STATE_IDLE;
             retval->sendCount = 0;
+            retval->pipelineDepth = 1;
+            retval->subscription = BMS_GROUP_MASK_DECODED;
+            retval->responseTimeoutUs = C_RESPONSE_TIMEOUT_US;
+
+            uint64_t now = retval->time();
+            for(uint8_t cmd = 0; cmd < E_BMS_CMD_COUNT; cmd++)
+            {
+                uint32_t maxAgeMs = _command[cmd].periodMs * C_MAX_AGE_PERIODS;
+                uint32_t* groupMaxAge = &retval->maxAgeMs[_command[cmd].group];
+
+                retval->schedule[cmd].periodMs = _command[cmd].periodMs;
+                retval->schedule[cmd].nextDue = now + (uint64_t)_command[cmd].phaseMs * 1000u;
+                if(maxAgeMs != 0 && (*groupMaxAge == 0 || maxAgeMs < *groupMaxAge))
+                {
+                    *groupMaxAge = maxAgeMs;
+                }
+            }
             retval->used = true;
             return retval;
         }
     }
     return NULL;
 }
+/***************************************************************************
+ * This function releases an instance and removes its slave ID from the 
+ * bus (and the acceptance filter). Late responses are counted as foreign.
+ **************************************************************************/
+void bms_communication_delete(bms_com_t* bms)
+{
+    assert(_initialized);
+    assert(bms);
+
+    if(bms->used)
+    {
+        bms_bus_detach(bms->bus, bms->slaveID);
+        bms->bus = NULL;
+        bms->used = false;
+    }
+}
 /***************************************************************************
  * This function
  **************************************************************************/
@@ -531,17 +1592,23 @@ void bms_communication_deinit(void)
     if(_initialized)
 
     {
-        for (uint8_t i = 0; i < C_BMS_COM_INSTANCES_MAX; i++)
+        for (uint16_t i = 0; i < _instanceCount; i++)
         {
             _instances[i].handle = NULL;
-            _instances[i].read = NULL;
+            _instances[i].bus = NULL;
             _instances[i].write = NULL;
+            _instances[i].writeBatch = NULL;
             _instances[i].open = NULL;
             _instances[i].close = NULL;
+            _instances[i].time = NULL;
+            _instances[i].txStatus = false;
             _instances[i].slaveID = 0;
             _instances[i].state = E_BMS_STATE_IDLE;
             _instances[i].used = false;  
         }
+        bms_bus_deinit();
+        _instances = _staticInstances;
+        _instanceCount = C_BMS_COM_INSTANCES_MAX;
         _initialized = false;
     }
 }
@@ -552,12 +1619,39 @@ void bms_communication_init(void)
 {
     if(!_initialized)
     {
-        interrupt_handler_init();
+        bms_bus_init();
 
-        for (uint8_t i = 0; i < C_BMS_COM_INSTANCES_MAX; i++)
+        for (uint16_t i = 0; i < _instanceCount; i++)
         {
             _instances[i].used = false;
         }
         _initialized = true;
     }
 }
+/***************************************************************************
+ * This function returns the bytes one instance takes in a caller supplied
+ * pool.
+ **************************************************************************/
+size_t bms_communication_getInstanceSize(void)
+{
+    return sizeof(bms_com_t);
+}
+/***************************************************************************
+ * This function initializes the module with instances taken from a memory
+ * region of the caller instead of the built-in pool, e.g. to serve more
+ * packs than BMS_COM_INSTANCES_MAX. The region must stay valid until 
+ * bms_communication_deinit, which falls back to the built-in pool.
+ **************************************************************************/
+void bms_communication_initPool(void* pool, size_t poolSize)
+{
+    assert(!_initialized);
+    assert(pool);
+    assert(((uintptr_t)pool % sizeof(uint64_t)) == 0);
+    assert(poolSize >= sizeof(bms_com_t));
+
+    size_t count = poolSize / sizeof(bms_com_t);
+
+    _instances = (bms_com_t*)pool;
+    _instanceCount = (count > UINT16_MAX) ? UINT16_MAX : (uint16_t)count;
+    bms_communication_init();
+}
@@ -0,0 +1,401 @@
+/**************************************************************************
+bms_history.c
+ Created on: Mar 12, 2026
+     Author: M. Schermutzki
+***************************************************************************/
+/*** includes *************************************************************/
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+#include "bms_codec.h"
+#include "bms_communication.h"
+#include "bms_history.h"
+/*** local constants ******************************************************/
+#ifndef BMS_HISTORY_INSTANCES_MAX
+#define BMS_HISTORY_INSTANCES_MAX   (1)     // set with -DBMS_HISTORY_INSTANCES_MAX=n
+#endif
+#ifndef BMS_HISTORY_DEPTH
+#define BMS_HISTORY_DEPTH           (150)   // samples per pack, 5 min at one sample every 2 s
+#endif
+#ifndef BMS_HISTORY_CHUNKS
+#define BMS_HISTORY_CHUNKS          (16)    // archive chunks per pack, about 6 min of sweeps at 5 Hz
+#endif
+#ifndef BMS_HISTORY_CHUNK_SIZE
+#define BMS_HISTORY_CHUNK_SIZE      (512)   // bytes, a smaller chunk spends more on key frames
+#endif
+#define C_BMS_HISTORY_INSTANCES_MAX (BMS_HISTORY_INSTANCES_MAX)
+#define C_BMS_HISTORY_DEPTH         (BMS_HISTORY_DEPTH)
+#define C_BMS_HISTORY_CHUNKS        (BMS_HISTORY_CHUNKS)
+#define C_BMS_HISTORY_CHUNK_SIZE    (BMS_HISTORY_CHUNK_SIZE)
+
+_Static_assert(C_BMS_HISTORY_CHUNK_SIZE >= BMS_CODEC_SAMPLE_MAX, "a key frame has to fit into an empty chunk");
+/*** structures ***********************************************************/
+/* One chunk of the archive, encoded with bms_codec. It decodes on its own
+ * from its first sample. */
+typedef struct
+{
+    uint64_t firstTime;
+    uint16_t length;
+    uint16_t count;
+    uint8_t data[C_BMS_HISTORY_CHUNK_SIZE];
+} bms_history_chunk_t;
+
+/* samples[] is a ring: oldest is the index of the oldest sample, count the
+ * number of valid samples. Timestamps rise monotonically through the 
+ * ring, which keeps range queries a binary search. chunks[] is a ring of
+ * the same kind that keeps the cells and totals of every sweep in about a
+ * tenth of the space, the encoder appends to the newest chunk. */
+struct bms_history_s
+{
+    bms_com_t* bms;
+    uint64_t periodUs;
+    uint32_t lastSweep;
+    uint64_t lastSample;
+    uint32_t oldest;
+    uint32_t count;
+    bms_sample_t samples[C_BMS_HISTORY_DEPTH];
+    uint32_t oldestChunk;
+    uint32_t chunkCount;
+    uint32_t archiveCount;
+    bms_encoder_t encoder;
+    bms_history_chunk_t chunks[C_BMS_HISTORY_CHUNKS];
+    bool used;
+};
+/*** macros ***************************************************************/
+/*** local variables ******************************************************/
+static bool _initialized = false;
+static bms_history_t _instances[C_BMS_HISTORY_INSTANCES_MAX];
+/*** prototypes ***********************************************************/
+static uint32_t _physical(const bms_history_t* history, uint32_t index);
+static uint32_t _lowerBound(const bms_history_t* history, uint64_t timeUs);
+static bms_history_chunk_t* _chunk(bms_history_t* history, uint32_t index);
+static void _openChunk(bms_history_t* history, uint64_t timeUs);
+static uint32_t _chunkOf(bms_history_t* history, uint64_t timeUs);
+/*** interrupt service routines *******************************************/
+/*** functions ************************************************************/
+/*=============================== PRIVATE ==========================================*/
+/***************************************************************************
+ * This function maps the age order index (0 = oldest) to the ring slot.
+ **************************************************************************/
+static uint32_t _physical(const bms_history_t* history, uint32_t index)
+{
+    uint32_t slot = history->oldest + index;
+    return (slot >= C_BMS_HISTORY_DEPTH) ? slot - C_BMS_HISTORY_DEPTH : slot;
+}
+/***************************************************************************
+ * This function returns the index of the first sample not older than 
+ * timeUs, count if there is none.
+ **************************************************************************/
+static uint32_t _lowerBound(const bms_history_t* history, uint64_t timeUs)
+{
+    uint32_t low = 0;
+    uint32_t high = history->count;
+
+    while(low < high)
+    {
+        uint32_t mid = low + (high - low) / 2u;
+
+        if(history->samples[_physical(history, mid)].timeUs < timeUs)
+        {
+            low = mid + 1u;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
+}
+/***************************************************************************
+ * This function maps the age order index of a chunk (0 = oldest) to the 
+ * chunk.
+ **************************************************************************/
+static bms_history_chunk_t* _chunk(bms_history_t* history, uint32_t index)
+{
+    uint32_t slot = history->oldestChunk + index;
+    return &history->chunks[(slot >= C_BMS_HISTORY_CHUNKS) ? slot - C_BMS_HISTORY_CHUNKS : slot];
+}
+/***************************************************************************
+ * This function starts a new chunk at timeUs. The oldest chunk is dropped
+ * once all of them are in use.
+ **************************************************************************/
+static void _openChunk(bms_history_t* history, uint64_t timeUs)
+{
+    if(history->chunkCount == C_BMS_HISTORY_CHUNKS)
+    {
+        history->archiveCount -= history->chunks[history->oldestChunk].count;
+        history->oldestChunk = (history->oldestChunk + 1u == C_BMS_HISTORY_CHUNKS) ? 0 : history->oldestChunk + 1u;
+        history->chunkCount--;
+    }
+
+    bms_history_chunk_t* chunk = _chunk(history, history->chunkCount);
+    history->chunkCount++;
+    chunk->firstTime = timeUs;
+    chunk->length = 0;
+    chunk->count = 0;
+    bms_codec_encoderInit(&history->encoder, chunk->data, sizeof(chunk->data));
+}
+/***************************************************************************
+ * This function returns the index of the chunk that holds timeUs, the 
+ * last one that starts at or before it. A binary search over the first
+ * times, 0 if timeUs is older than the archive.
+ **************************************************************************/
+static uint32_t _chunkOf(bms_history_t* history, uint64_t timeUs)
+{
+    uint32_t low = 0;
+    uint32_t high = history->chunkCount;
+
+    while(low < high)
+    {
+        uint32_t mid = low + (high - low) / 2u;
+
+        if(_chunk(history, mid)->firstTime <= timeUs)
+        {
+            low = mid + 1u;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return (low > 0) ? low - 1u : 0;
+}
+/*=============================== PUBLIC ===========================================*/
+/***************************************************************************
+ * This function stores a sample in O(1). The oldest sample is overwritten
+ * once the ring is full. Samples must be appended in time order.
+ **************************************************************************/
+void bms_history_append(bms_history_t* history, const bms_sample_t* sample)
+{
+    assert(history);
+    assert(sample);
+
+    if(history->count < C_BMS_HISTORY_DEPTH)
+    {
+        history->samples[_physical(history, history->count)] = *sample;
+        history->count++;
+    }
+    else
+    {
+        history->samples[history->oldest] = *sample;
+        history->oldest = (history->oldest + 1u == C_BMS_HISTORY_DEPTH) ? 0 : history->oldest + 1u;
+    }
+    history->lastSample = sample->timeUs;
+}
+/***************************************************************************
+ * This function archives the cells and totals of every published sweep 
+ * and takes a full sample of the pack when the sample period has passed.
+ * Returns true if a full sample was stored.
+ **************************************************************************/
+bool bms_history_cyclic(bms_history_t* history)
+{
+    assert(history);
+
+    if(!bms_communication_newSweepAvailable(history->bms, &history->lastSweep))
+    {
+        return false;
+    }
+
+    bms_snapshot_t snap;
+    bms_communication_getSnapshot(history->bms, &snap);
+
+    bms_sample_t sample;
+    sample.timeUs = snap.timestampUs;
+    sample.totalVoltage = snap.totalVoltage;
+    sample.totalCurrent = snap.totalCurrent;
+    sample.remainingCapacity = snap.remainingCapacity;
+    sample.maxTemperature = snap.maxTemperature;
+    sample.minTemperature = snap.minTemperature;
+    sample.alarmStatusA = snap.alarmStatusA;
+    sample.alarmStatusB = snap.alarmStatusB;
+    sample.protectA = snap.protectA;
+    sample.protectB = snap.protectB;
+    memcpy(sample.cellVoltage, snap.cellVoltage, sizeof(sample.cellVoltage));
+
+    bms_history_archive(history, &sample);
+    if(history->count > 0 && snap.timestampUs - history->lastSample < history->periodUs)
+    {
+        return false;
+    }
+    bms_history_append(history, &sample);
+    return true;
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+uint32_t bms_history_getCount(bms_history_t* history)
+{
+    assert(history);
+    return history->count;
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+uint32_t bms_history_getCapacity(bms_history_t* history)
+{
+    assert(history);
+    return C_BMS_HISTORY_DEPTH;
+}
+/***************************************************************************
+ * This function copies the sample at index, 0 being the oldest one.
+ **************************************************************************/
+bool bms_history_getSample(bms_history_t* history, uint32_t index, bms_sample_t* sample)
+{
+    assert(history);
+    assert(sample);
+
+    if(index >= history->count)
+    {
+        return false;
+    }
+    *sample = history->samples[_physical(history, index)];
+    return true;
+}
+/***************************************************************************
+ * This function copies up to maxSamples samples with fromUs <= time <= 
+ * toUs, oldest first, and returns their number. The start is found by 
+ * binary search.
+ **************************************************************************/
+uint32_t bms_history_query(bms_history_t* history, uint64_t fromUs, uint64_t toUs, bms_sample_t* samples, uint32_t maxSamples)
+{
+    assert(history);
+    assert(samples || maxSamples == 0);
+
+    uint32_t copied = 0;
+
+    for(uint32_t index = _lowerBound(history, fromUs); index < history->count && copied < maxSamples; index++)
+    {
+        const bms_sample_t* sample = &history->samples[_physical(history, index)];
+
+        if(sample->timeUs > toUs)
+        {
+            break;
+        }
+        samples[copied++] = *sample;
+    }
+    return copied;
+}
+/***************************************************************************
+ * This function compresses the time, the totals and the cell voltages of 
+ * a sample into the archive. Samples must be archived in time order.
+ **************************************************************************/
+void bms_history_archive(bms_history_t* history, const bms_sample_t* sample)
+{
+    assert(history);
+    assert(sample);
+
+    if(history->chunkCount == 0 || !bms_codec_encode(&history->encoder, sample))
+    {
+        _openChunk(history, sample->timeUs);
+        bms_codec_encode(&history->encoder, sample);
+    }
+
+    bms_history_chunk_t* chunk = _chunk(history, history->chunkCount - 1u);
+    chunk->length = (uint16_t)history->encoder.length;
+    chunk->count = (uint16_t)history->encoder.count;
+    history->archiveCount++;
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+uint32_t bms_history_getArchiveCount(bms_history_t* history)
+{
+    assert(history);
+    return history->archiveCount;
+}
+/***************************************************************************
+ * This function decodes up to maxSamples archived samples with fromUs <= 
+ * time <= toUs, oldest first, and returns their number. The first chunk 
+ * is found by binary search, it is decoded from its start. Only the time,
+ * the totals and the cell voltages are set.
+ **************************************************************************/
+uint32_t bms_history_queryArchive(bms_history_t* history, uint64_t fromUs, uint64_t toUs, bms_sample_t* samples, uint32_t maxSamples)
+{
+    assert(history);
+    assert(samples || maxSamples == 0);
+
+    uint32_t copied = 0;
+
+    for(uint32_t index = _chunkOf(history, fromUs); index < history->chunkCount && copied < maxSamples; index++)
+    {
+        bms_history_chunk_t* chunk = _chunk(history, index);
+        bms_decoder_t decoder;
+
+        if(chunk->firstTime > toUs)
+        {
+            break;
+        }
+        bms_codec_decoderInit(&decoder, chunk->data, chunk->length);
+        while(copied < maxSamples && bms_codec_decode(&decoder, &samples[copied]))
+        {
+            if(samples[copied].timeUs > toUs)
+            {
+                return copied;
+            }
+            if(samples[copied].timeUs >= fromUs)
+            {
+                copied++;
+            }
+        }
+    }
+    return copied;
+}
+/***************************************************************************
+ * This function returns the static memory one history takes.
+ **************************************************************************/
+size_t bms_history_getFootprint(void)
+{
+    return sizeof(bms_history_t);
+}
+/***************************************************************************
+ * This function binds a history to a pack. A periodMs of zero stores 
+ * every published sweep.
+ **************************************************************************/
+bms_history_t* bms_history_new(bms_com_t* bms, uint32_t periodMs)
+{
+    assert(_initialized);
+    assert(bms);
+
+    for(uint8_t i = 0; i < C_BMS_HISTORY_INSTANCES_MAX; i++)
+    {
+        if(!_instances[i].used)
+        {
+            bms_history_t* retval = &_instances[i];
+            memset(retval, 0, sizeof(bms_history_t));
+            retval->bms = bms;
+            retval->periodUs = (uint64_t)periodMs * 1000u;
+            retval->lastSweep = bms_communication_getSweepCount(bms);
+            retval->used = true;
+            return retval;
+        }
+    }
+    return NULL;
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+void bms_history_deinit(void)
+{
+    if(_initialized)
+    {
+        for(uint8_t i = 0; i < C_BMS_HISTORY_INSTANCES_MAX; i++)
+        {
+            _instances[i].used = false;
+        }
+        _initialized = false;
+    }
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+void bms_history_init(void)
+{
+    if(!_initialized)
+    {
+        for(uint8_t i = 0; i < C_BMS_HISTORY_INSTANCES_MAX; i++)
+        {
+            _instances[i].used = false;
+        }
+        _initialized = true;
+    }
+}
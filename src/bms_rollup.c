@@ -0,0 +1,293 @@
+/**************************************************************************
+bms_rollup.c
+ Created on: Mar 15, 2026
+     Author: M. Schermutzki
+***************************************************************************/
+/*** includes *************************************************************/
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+#include "bms_communication.h"
+#include "bms_rollup.h"
+/*** local constants ******************************************************/
+#ifndef BMS_ROLLUP_INSTANCES_MAX
+#define BMS_ROLLUP_INSTANCES_MAX    (1)     // set with -DBMS_ROLLUP_INSTANCES_MAX=n
+#endif
+#ifndef BMS_ROLLUP_SECONDS
+#define BMS_ROLLUP_SECONDS          (60)    // closed 1 s intervals kept per pack
+#endif
+#ifndef BMS_ROLLUP_MINUTES
+#define BMS_ROLLUP_MINUTES          (60)    // closed 1 min intervals kept per pack
+#endif
+#ifndef BMS_ROLLUP_HOURS
+#define BMS_ROLLUP_HOURS            (24)    // closed 1 h intervals kept per pack
+#endif
+#define C_BMS_ROLLUP_INSTANCES_MAX  (BMS_ROLLUP_INSTANCES_MAX)
+#define C_BMS_ROLLUP_ENTRIES        (BMS_ROLLUP_SECONDS + BMS_ROLLUP_MINUTES + BMS_ROLLUP_HOURS)
+
+static const uint64_t C_LENGTH_US[E_BMS_ROLLUP_LEVEL_COUNT] = { 1000000u, 60000000u, 3600000000u };
+static const uint32_t C_DEPTH[E_BMS_ROLLUP_LEVEL_COUNT] = { BMS_ROLLUP_SECONDS, BMS_ROLLUP_MINUTES, BMS_ROLLUP_HOURS };
+static const uint32_t C_OFFSET[E_BMS_ROLLUP_LEVEL_COUNT] = { 0, BMS_ROLLUP_SECONDS, BMS_ROLLUP_SECONDS + BMS_ROLLUP_MINUTES };
+/*** structures ***********************************************************/
+/* The open interval of a level keeps the sums, closed intervals only the
+ * compact entry. Every sweep updates the open interval of each level 
+ * directly, closing one costs a single ring write. */
+typedef struct
+{
+    uint64_t startUs;
+    uint32_t count;
+    int32_t min[E_BMS_ROLLUP_FIELD_COUNT];
+    int32_t max[E_BMS_ROLLUP_FIELD_COUNT];
+    int64_t sum[E_BMS_ROLLUP_FIELD_COUNT];
+} bms_rollup_open_t;
+
+typedef struct
+{
+    bms_rollup_open_t open;
+    uint32_t oldest;
+    uint32_t count;
+} bms_rollup_ring_t;
+
+struct bms_rollup_s
+{
+    bms_com_t* bms;
+    uint32_t lastSweep;
+    bms_rollup_ring_t level[E_BMS_ROLLUP_LEVEL_COUNT];
+    bms_rollup_entry_t entries[C_BMS_ROLLUP_ENTRIES];
+    bool used;
+};
+/*** macros ***************************************************************/
+/*** local variables ******************************************************/
+static bool _initialized = false;
+static bms_rollup_t _instances[C_BMS_ROLLUP_INSTANCES_MAX];
+/*** prototypes ***********************************************************/
+static bms_rollup_entry_t* _slot(bms_rollup_t* rollup, bms_rollup_level_t level, uint32_t index);
+static void _toEntry(const bms_rollup_open_t* open, bms_rollup_entry_t* entry);
+static void _close(bms_rollup_t* rollup, bms_rollup_level_t level);
+/*** interrupt service routines *******************************************/
+/*** functions ************************************************************/
+/*=============================== PRIVATE ==========================================*/
+/***************************************************************************
+ * This function maps the age order index (0 = oldest) of a level to its 
+ * ring slot.
+ **************************************************************************/
+static bms_rollup_entry_t* _slot(bms_rollup_t* rollup, bms_rollup_level_t level, uint32_t index)
+{
+    uint32_t slot = rollup->level[level].oldest + index;
+
+    if(slot >= C_DEPTH[level])
+    {
+        slot -= C_DEPTH[level];
+    }
+    return &rollup->entries[C_OFFSET[level] + slot];
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+static void _toEntry(const bms_rollup_open_t* open, bms_rollup_entry_t* entry)
+{
+    entry->startUs = open->startUs;
+    entry->count = open->count;
+
+    for(uint8_t i = 0; i < E_BMS_ROLLUP_FIELD_COUNT; i++)
+    {
+        entry->field[i].min = open->min[i];
+        entry->field[i].max = open->max[i];
+        entry->field[i].mean = (int32_t)(open->sum[i] / (int64_t)open->count);
+    }
+}
+/***************************************************************************
+ * This function moves the open interval of a level into its ring, the 
+ * oldest entry is overwritten once the ring is full.
+ **************************************************************************/
+static void _close(bms_rollup_t* rollup, bms_rollup_level_t level)
+{
+    bms_rollup_ring_t* ring = &rollup->level[level];
+
+    if(ring->count < C_DEPTH[level])
+    {
+        _toEntry(&ring->open, _slot(rollup, level, ring->count));
+        ring->count++;
+    }
+    else
+    {
+        _toEntry(&ring->open, _slot(rollup, level, 0));
+        ring->oldest = (ring->oldest + 1u == C_DEPTH[level]) ? 0 : ring->oldest + 1u;
+    }
+    ring->open.count = 0;
+}
+/*=============================== PUBLIC ===========================================*/
+/***************************************************************************
+ * This function adds one sweep to every level. Intervals are aligned to 
+ * their length, intervals without sweeps are left out. Returns the 
+ * BMS_ROLLUP_LEVEL_MASK of the levels that closed an interval.
+ **************************************************************************/
+uint8_t bms_rollup_add(bms_rollup_t* rollup, const bms_snapshot_t* snapshot)
+{
+    assert(rollup);
+    assert(snapshot);
+
+    int32_t value[E_BMS_ROLLUP_FIELD_COUNT];
+    uint8_t closed = 0;
+
+    value[E_BMS_ROLLUP_TOTAL_VOLTAGE] = (int32_t)snapshot->totalVoltage;
+    value[E_BMS_ROLLUP_TOTAL_CURRENT] = snapshot->totalCurrent;
+    value[E_BMS_ROLLUP_REMAINING_CAPACITY] = (int32_t)snapshot->remainingCapacity;
+    value[E_BMS_ROLLUP_MAX_TEMPERATURE] = snapshot->maxTemperature;
+    value[E_BMS_ROLLUP_MIN_TEMPERATURE] = snapshot->minTemperature;
+    value[E_BMS_ROLLUP_MAX_CELL_VOLTAGE] = snapshot->cellStats.max;
+    value[E_BMS_ROLLUP_MIN_CELL_VOLTAGE] = snapshot->cellStats.min;
+
+    for(uint8_t level = 0; level < E_BMS_ROLLUP_LEVEL_COUNT; level++)
+    {
+        bms_rollup_open_t* open = &rollup->level[level].open;
+        uint64_t startUs = snapshot->timestampUs - (snapshot->timestampUs % C_LENGTH_US[level]);
+
+        if(open->count > 0 && startUs != open->startUs)
+        {
+            _close(rollup, (bms_rollup_level_t)level);
+            closed |= BMS_ROLLUP_LEVEL_MASK(level);
+        }
+
+        if(open->count == 0)
+        {
+            open->startUs = startUs;
+            memcpy(open->min, value, sizeof(value));
+            memcpy(open->max, value, sizeof(value));
+            memset(open->sum, 0, sizeof(open->sum));
+        }
+
+        for(uint8_t i = 0; i < E_BMS_ROLLUP_FIELD_COUNT; i++)
+        {
+            open->min[i] = (value[i] < open->min[i]) ? value[i] : open->min[i];
+            open->max[i] = (value[i] > open->max[i]) ? value[i] : open->max[i];
+            open->sum[i] += value[i];
+        }
+        open->count++;
+    }
+    return closed;
+}
+/***************************************************************************
+ * This function adds every newly published sweep of the pack. Returns the
+ * BMS_ROLLUP_LEVEL_MASK of the levels that closed an interval.
+ **************************************************************************/
+uint8_t bms_rollup_cyclic(bms_rollup_t* rollup)
+{
+    assert(rollup);
+
+    if(!bms_communication_newSweepAvailable(rollup->bms, &rollup->lastSweep))
+    {
+        return 0;
+    }
+
+    bms_snapshot_t snap;
+    bms_communication_getSnapshot(rollup->bms, &snap);
+    return bms_rollup_add(rollup, &snap);
+}
+/***************************************************************************
+ * This function returns the number of closed intervals of a level.
+ **************************************************************************/
+uint32_t bms_rollup_getCount(bms_rollup_t* rollup, bms_rollup_level_t level)
+{
+    assert(rollup);
+    assert(level < E_BMS_ROLLUP_LEVEL_COUNT);
+    return rollup->level[level].count;
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+uint32_t bms_rollup_getCapacity(bms_rollup_level_t level)
+{
+    assert(level < E_BMS_ROLLUP_LEVEL_COUNT);
+    return C_DEPTH[level];
+}
+/***************************************************************************
+ * This function copies the closed interval at index, 0 being the oldest.
+ **************************************************************************/
+bool bms_rollup_getEntry(bms_rollup_t* rollup, bms_rollup_level_t level, uint32_t index, bms_rollup_entry_t* entry)
+{
+    assert(rollup);
+    assert(level < E_BMS_ROLLUP_LEVEL_COUNT);
+    assert(entry);
+
+    if(index >= rollup->level[level].count)
+    {
+        return false;
+    }
+    *entry = *_slot(rollup, level, index);
+    return true;
+}
+/***************************************************************************
+ * This function copies the interval that is still open, false if no 
+ * sweep went into it yet.
+ **************************************************************************/
+bool bms_rollup_getCurrent(bms_rollup_t* rollup, bms_rollup_level_t level, bms_rollup_entry_t* entry)
+{
+    assert(rollup);
+    assert(level < E_BMS_ROLLUP_LEVEL_COUNT);
+    assert(entry);
+
+    if(rollup->level[level].open.count == 0)
+    {
+        return false;
+    }
+    _toEntry(&rollup->level[level].open, entry);
+    return true;
+}
+/***************************************************************************
+ * This function returns the static memory one rollup takes.
+ **************************************************************************/
+size_t bms_rollup_getFootprint(void)
+{
+    return sizeof(bms_rollup_t);
+}
+/***************************************************************************
+ * This function binds a rollup to a pack.
+ **************************************************************************/
+bms_rollup_t* bms_rollup_new(bms_com_t* bms)
+{
+    assert(_initialized);
+    assert(bms);
+
+    for(uint8_t i = 0; i < C_BMS_ROLLUP_INSTANCES_MAX; i++)
+    {
+        if(!_instances[i].used)
+        {
+            bms_rollup_t* retval = &_instances[i];
+            memset(retval, 0, sizeof(bms_rollup_t));
+            retval->bms = bms;
+            retval->lastSweep = bms_communication_getSweepCount(bms);
+            retval->used = true;
+            return retval;
+        }
+    }
+    return NULL;
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+void bms_rollup_deinit(void)
+{
+    if(_initialized)
+    {
+        for(uint8_t i = 0; i < C_BMS_ROLLUP_INSTANCES_MAX; i++)
+        {
+            _instances[i].used = false;
+        }
+        _initialized = false;
+    }
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+void bms_rollup_init(void)
+{
+    if(!_initialized)
+    {
+        for(uint8_t i = 0; i < C_BMS_ROLLUP_INSTANCES_MAX; i++)
+        {
+            _instances[i].used = false;
+        }
+        _initialized = true;
+    }
+}
@@ -1,4 +1,5 @@
 #include <Arduino.h>
+#include "bg_executor.h"
 #include "bg_task.h"
 #include "application.hpp"
 
@@ -12,5 +13,9 @@ void setup()
 
 void loop() 
 {
+  if(bg_executor_isRunning())
+  {
+    vTaskDelete(NULL);    // the executor threads run the tasks from now on
+  }
   bg_task_cyclic();
 }
\ No newline at end of file
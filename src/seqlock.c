@@ -0,0 +1,104 @@
+/**************************************************************************
+seqlock.c
+ Created on: Mar 09, 2026
+     Author: M. Schermutzki
+***************************************************************************/
+/*** includes *************************************************************/
+#include <assert.h>
+#include <stdbool.h>
+#include "seqlock.h"
+/*** local constants ******************************************************/
+/*** structures ***********************************************************/
+/*** macros ***************************************************************/
+#define LOAD_ACQUIRE(ptr)           __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define LOAD_RELAXED(ptr)           __atomic_load_n((ptr), __ATOMIC_RELAXED)
+#define STORE_RELEASE(ptr, val)     __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#define STORE_RELAXED(ptr, val)     __atomic_store_n((ptr), (val), __ATOMIC_RELAXED)
+#define COUNT_RELAXED(ptr)          __atomic_fetch_add((ptr), 1u, __ATOMIC_RELAXED)
+/*** local variables ******************************************************/
+/*** prototypes ***********************************************************/
+/*** interrupt service routines *******************************************/
+/*** functions ************************************************************/
+/***************************************************************************
+ * This function marks the start of an update. There must only be one 
+ * writer per lock, it never waits for readers.
+ **************************************************************************/
+void seqlock_writeBegin(seqlock_t* lock)
+{
+    assert(lock);
+
+    STORE_RELAXED(&lock->sequence, LOAD_RELAXED(&lock->sequence) + 1u);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+/***************************************************************************
+ * This function publishes the update.
+ **************************************************************************/
+void seqlock_writeEnd(seqlock_t* lock)
+{
+    assert(lock);
+    STORE_RELEASE(&lock->sequence, LOAD_RELAXED(&lock->sequence) + 1u);
+}
+/***************************************************************************
+ * This function returns the sequence a read starts with. While the writer
+ * is busy it spins, so a reader must not preempt the writer on the same 
+ * core with a higher priority.
+ **************************************************************************/
+uint32_t seqlock_readBegin(seqlock_t* lock)
+{
+    assert(lock);
+
+    uint32_t start = LOAD_ACQUIRE(&lock->sequence);
+
+    if(start & 1u)
+    {
+        COUNT_RELAXED(&lock->contentionCount);
+        do
+        {
+            start = LOAD_ACQUIRE(&lock->sequence);
+        } while(start & 1u);
+    }
+    return start;
+}
+/***************************************************************************
+ * This function returns true if the data was changed while it was copied
+ * and the copy has to be repeated.
+ **************************************************************************/
+bool seqlock_readRetry(seqlock_t* lock, uint32_t start)
+{
+    assert(lock);
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if(LOAD_RELAXED(&lock->sequence) != start)
+    {
+        COUNT_RELAXED(&lock->retryCount);
+        return true;
+    }
+    return false;
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+uint32_t seqlock_getContentionCount(seqlock_t* lock)
+{
+    assert(lock);
+    return LOAD_RELAXED(&lock->contentionCount);
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+uint32_t seqlock_getRetryCount(seqlock_t* lock)
+{
+    assert(lock);
+    return LOAD_RELAXED(&lock->retryCount);
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+void seqlock_init(seqlock_t* lock)
+{
+    assert(lock);
+
+    lock->sequence = 0;
+    lock->contentionCount = 0;
+    lock->retryCount = 0;
+}
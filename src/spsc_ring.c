@@ -0,0 +1,230 @@
+/**************************************************************************
+spsc_ring.c
+ Created on: Mar 04, 2026
+     Author: M. Schermutzki
+***************************************************************************/
+/*** includes *************************************************************/
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+#include "spsc_ring.h"
+/*** local constants ******************************************************/
+#define C_SPSC_RING_INSTANCES_MAX (4)
+/*** structures ***********************************************************/
+/* head is only written by the producer, tail only by the consumer. Both run
+ * freely and are masked on access, so capacity has to be a power of two. */
+struct spsc_ring_s
+{
+    uint8_t* buffer;
+    size_t elementSize;
+    uint32_t mask;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t highWater;     // producer side statistics
+    uint32_t dropCount;
+    bool used;
+};
+/*** macros ***************************************************************/
+#define LOAD_ACQUIRE(ptr)           __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define LOAD_RELAXED(ptr)           __atomic_load_n((ptr), __ATOMIC_RELAXED)
+#define STORE_RELEASE(ptr, val)     __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#define STORE_RELAXED(ptr, val)     __atomic_store_n((ptr), (val), __ATOMIC_RELAXED)
+/*** local variables ******************************************************/
+static bool _initialized = false;
+static spsc_ring_t _instances[C_SPSC_RING_INSTANCES_MAX];
+/*** prototypes ***********************************************************/
+/*** interrupt service routines *******************************************/
+/*** functions ************************************************************/
+/***************************************************************************
+ * This function is called by the producer only. If the ring is full the
+ * element is dropped and counted. Safe to call from an ISR.
+ **************************************************************************/
+bool spsc_ring_push(spsc_ring_t* ring, const void* element)
+{
+    assert(ring);
+    assert(element);
+
+    uint32_t head = LOAD_RELAXED(&ring->head);
+    uint32_t tail = LOAD_ACQUIRE(&ring->tail);
+    uint32_t count = head - tail;
+
+    if(count > ring->mask)
+    {
+        STORE_RELAXED(&ring->dropCount, ring->dropCount + 1u);
+        return false;
+    }
+
+    memcpy(&ring->buffer[(head & ring->mask) * ring->elementSize], element, ring->elementSize);
+    STORE_RELEASE(&ring->head, head + 1u);
+
+    if(count + 1u > ring->highWater)
+    {
+        STORE_RELAXED(&ring->highWater, count + 1u);
+    }
+    return true;
+}
+/***************************************************************************
+ * This function is called by the consumer only and never blocks.
+ **************************************************************************/
+bool spsc_ring_pop(spsc_ring_t* ring, void* element)
+{
+    assert(ring);
+    assert(element);
+
+    uint32_t tail = LOAD_RELAXED(&ring->tail);
+    uint32_t head = LOAD_ACQUIRE(&ring->head);
+
+    if(head == tail)
+    {
+        return false;
+    }
+
+    memcpy(element, &ring->buffer[(tail & ring->mask) * ring->elementSize], ring->elementSize);
+    STORE_RELEASE(&ring->tail, tail + 1u);
+    return true;
+}
+/***************************************************************************
+ * This function pushes as many of the elements as fit and returns their
+ * number. The rest is left to the caller and not counted as dropped. The
+ * consumer sees the whole batch at once.
+ **************************************************************************/
+uint32_t spsc_ring_pushBatch(spsc_ring_t* ring, const void* elements, uint32_t count)
+{
+    assert(ring);
+    assert(elements || count == 0);
+
+    uint32_t head = LOAD_RELAXED(&ring->head);
+    uint32_t tail = LOAD_ACQUIRE(&ring->tail);
+    uint32_t space = ring->mask + 1u - (head - tail);
+    uint32_t pushed = (count < space) ? count : space;
+
+    if(pushed == 0)
+    {
+        return 0;
+    }
+
+    uint32_t first = ring->mask + 1u - (head & ring->mask);     // elements up to the end of the buffer
+    if(first > pushed)
+    {
+        first = pushed;
+    }
+    memcpy(&ring->buffer[(head & ring->mask) * ring->elementSize], elements, first * ring->elementSize);
+    memcpy(ring->buffer, (const uint8_t*)elements + first * ring->elementSize, (pushed - first) * ring->elementSize);
+    STORE_RELEASE(&ring->head, head + pushed);
+
+    if((head - tail) + pushed > ring->highWater)
+    {
+        STORE_RELAXED(&ring->highWater, (head - tail) + pushed);
+    }
+    return pushed;
+}
+/***************************************************************************
+ * This function pops up to count elements and returns their number. It is
+ * called by the consumer only and never blocks.
+ **************************************************************************/
+uint32_t spsc_ring_popBatch(spsc_ring_t* ring, void* elements, uint32_t count)
+{
+    assert(ring);
+    assert(elements || count == 0);
+
+    uint32_t tail = LOAD_RELAXED(&ring->tail);
+    uint32_t head = LOAD_ACQUIRE(&ring->head);
+    uint32_t popped = ((head - tail) < count) ? (head - tail) : count;
+
+    if(popped == 0)
+    {
+        return 0;
+    }
+
+    uint32_t first = ring->mask + 1u - (tail & ring->mask);
+    if(first > popped)
+    {
+        first = popped;
+    }
+    memcpy(elements, &ring->buffer[(tail & ring->mask) * ring->elementSize], first * ring->elementSize);
+    memcpy((uint8_t*)elements + first * ring->elementSize, ring->buffer, (popped - first) * ring->elementSize);
+    STORE_RELEASE(&ring->tail, tail + popped);
+    return popped;
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+uint32_t spsc_ring_getCount(spsc_ring_t* ring)
+{
+    assert(ring);
+    return LOAD_ACQUIRE(&ring->head) - LOAD_ACQUIRE(&ring->tail);
+}
+/***************************************************************************
+ * This function returns the highest fill level seen so far.
+ **************************************************************************/
+uint32_t spsc_ring_getHighWater(spsc_ring_t* ring)
+{
+    assert(ring);
+    return LOAD_RELAXED(&ring->highWater);
+}
+/***************************************************************************
+ * This function returns the number of elements rejected on a full ring.
+ **************************************************************************/
+uint32_t spsc_ring_getDropCount(spsc_ring_t* ring)
+{
+    assert(ring);
+    return LOAD_RELAXED(&ring->dropCount);
+}
+/***************************************************************************
+ * This function creates a ring on caller supplied storage of 
+ * capacity * elementSize bytes. capacity has to be a power of two.
+ **************************************************************************/
+spsc_ring_t* spsc_ring_new(void* buffer, size_t elementSize, uint32_t capacity)
+{
+    assert(_initialized);
+    assert(buffer);
+    assert(elementSize > 0);
+    assert(capacity > 0 && (capacity & (capacity - 1u)) == 0);
+
+    for(uint8_t i = 0; i < C_SPSC_RING_INSTANCES_MAX; i++)
+    {
+        if(!_instances[i].used)
+        {
+            spsc_ring_t* retval = &_instances[i];
+            retval->buffer = (uint8_t*)buffer;
+            retval->elementSize = elementSize;
+            retval->mask = capacity - 1u;
+            retval->head = 0;
+            retval->tail = 0;
+            retval->highWater = 0;
+            retval->dropCount = 0;
+            retval->used = true;
+            return retval;
+        }
+    }
+    return NULL;
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+void spsc_ring_deinit(void)
+{
+    if(_initialized)
+    {
+        for(uint8_t i = 0; i < C_SPSC_RING_INSTANCES_MAX; i++)
+        {
+            _instances[i].buffer = NULL;
+            _instances[i].used = false;
+        }
+        _initialized = false;
+    }
+}
+/***************************************************************************
+ * This function
+ **************************************************************************/
+void spsc_ring_init(void)
+{
+    if(!_initialized)
+    {
+        for(uint8_t i = 0; i < C_SPSC_RING_INSTANCES_MAX; i++)
+        {
+            _instances[i].used = false;
+        }
+        _initialized = true;
+    }
+}
@@ -0,0 +1,154 @@
+/******************************************************************************************************************
+ * bg_coroutine_bench.c
+ *  Created on: Mar 20, 2026
+ *      Author: M. Schermutzki
+ *
+ * Host benchmark of the switch cost of a coroutine against the while(stateChanged) switch dispatch of
+ * _canStatemachine. Both run the same request / response sequence: send, await the response, parse, and
+ * yield until the next request. Every resume either returns on an unmet await or advances one step.
+ *  meson test -C build --benchmark -v
+ *****************************************************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+#include "bg_coroutine.h"
+#include "bg_task.h"
+/*** local constants *********************************************************************************************/
+#define C_RESUME_COUNT  (10000000u)
+#define C_PASS_COUNT    (1000000u)
+/*** local variables *********************************************************************************************/
+typedef enum
+{
+    E_STATE_SEND,
+    E_STATE_WAIT,
+    E_STATE_PARSE,
+    E_STATE_IDLE
+} state_t;
+
+static state_t _state = E_STATE_SEND;
+static volatile uint32_t _tick = 0;
+static volatile uint32_t _sent = 0;
+static volatile uint32_t _parsed = 0;
+/*** local functions *********************************************************************************************/
+static uint64_t _nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// the response arrives on every second resume
+static bool _responseReady(void)
+{
+    return (_tick & 1u) != 0;
+}
+
+static void _switchMachine(void)
+{
+    bool stateChanged = true;
+
+    while(stateChanged)
+    {
+        stateChanged = false;
+        switch(_state)
+        {
+            case E_STATE_SEND:
+                _sent++;
+                _state = E_STATE_WAIT;
+                stateChanged = true;
+                break;
+            case E_STATE_WAIT:
+                if(_responseReady())
+                {
+                    _state = E_STATE_PARSE;
+                    stateChanged = true;
+                }
+                break;
+            case E_STATE_PARSE:
+                _parsed++;
+                _state = E_STATE_IDLE;
+                break;
+            case E_STATE_IDLE:
+                _state = E_STATE_SEND;
+                stateChanged = true;
+                break;
+        }
+    }
+}
+
+static bg_co_status_t _coroutine(bg_co_t* co)
+{
+    BG_CO_BEGIN(co);
+    for(;;)
+    {
+        _sent++;
+        BG_CO_AWAIT(co, _responseReady());
+        _parsed++;
+        BG_CO_YIELD(co);
+    }
+    BG_CO_END(co);
+}
+
+static void _switchTask(void)
+{
+    _tick++;
+    _switchMachine();
+}
+/*** main ********************************************************************************************************/
+int main(void)
+{
+    bg_co_t co;
+
+    uint64_t start = _nowNs();
+    for(uint32_t i = 0; i < C_RESUME_COUNT; i++)
+    {
+        _tick = i;
+        _switchMachine();
+    }
+    uint64_t switchNs = _nowNs() - start;
+    uint32_t switchParsed = _parsed;
+
+    _parsed = 0;
+    bg_co_setup(&co, _coroutine, NULL);
+    start = _nowNs();
+    for(uint32_t i = 0; i < C_RESUME_COUNT; i++)
+    {
+        _tick = i;
+        bg_co_resume(&co, 0);
+    }
+    uint64_t coroutineNs = _nowNs() - start;
+    uint32_t coroutineParsed = _parsed;
+
+    // the same two through bg_task, without time source every task runs on every pass
+    bg_task_init();
+    bg_co_init();
+    bg_task_handle_t* task = bg_task_add(_switchTask, "switch", E_BG_TASK_PRIO_LOW, 0, 0);
+    start = _nowNs();
+    for(uint32_t i = 0; i < C_PASS_COUNT; i++)
+    {
+        bg_task_cyclic();
+    }
+    uint64_t switchTaskNs = _nowNs() - start;
+    bg_task_remove(task);
+
+    bg_co_start(_coroutine, NULL, "coroutine", E_BG_TASK_PRIO_LOW, 0);
+    start = _nowNs();
+    for(uint32_t i = 0; i < C_PASS_COUNT; i++)
+    {
+        _tick++;
+        bg_task_cyclic();
+    }
+    uint64_t coroutineTaskNs = _nowNs() - start;
+    bg_co_deinit();
+    bg_task_deinit();
+
+    printf("resumes:           %u, sequences %u switch / %u coroutine\n",
+           (unsigned)C_RESUME_COUNT, (unsigned)switchParsed, (unsigned)coroutineParsed);
+    printf("switch dispatch:   %.2f ns per resume\n", (double)switchNs / C_RESUME_COUNT);
+    printf("coroutine:         %.2f ns per resume\n", (double)coroutineNs / C_RESUME_COUNT);
+    printf("as bg_task:        %.2f ns switch / %.2f ns coroutine per pass\n",
+           (double)switchTaskNs / C_PASS_COUNT, (double)coroutineTaskNs / C_PASS_COUNT);
+    printf("context:           %u bytes per coroutine, no stack\n", (unsigned)sizeof(bg_co_t));
+    return (switchParsed == coroutineParsed) ? 0 : 1;
+}
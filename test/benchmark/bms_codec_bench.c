@@ -0,0 +1,132 @@
+/******************************************************************************************************************
+ * bms_codec_bench.c
+ *  Created on: Mar 14, 2026
+ *      Author: M. Schermutzki
+ *
+ * Host benchmark of the history codec: compression ratio and encode / decode cost on a synthetic
+ * one hour trace at 5 Hz (slow cell drift with 1 mV flicker, stepping load current, 1 ms jitter on
+ * every fourth sample, a total voltage measured apart from the cells with +-10 mV noise). The ratio that counts is the one against the packed fields, the bytes the 
+ * samples would take without the padding of bms_sample_t. The chunk size is the one of bms_history.
+ *  meson test -C build --benchmark -v
+ *****************************************************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "bms_codec.h"
+/*** local constants *********************************************************************************************/
+#define C_SAMPLE_COUNT  (18000u)
+#define C_CHUNK_SIZE    (512u)
+#define C_TARGET_RATIO  (10.0)
+#define C_CHUNK_COUNT   (C_SAMPLE_COUNT * sizeof(bms_sample_t) / C_CHUNK_SIZE)
+/*** local variables *********************************************************************************************/
+static bms_sample_t _trace[C_SAMPLE_COUNT];
+static uint8_t _chunks[C_CHUNK_COUNT][C_CHUNK_SIZE];
+static size_t _chunkLength[C_CHUNK_COUNT];
+static uint32_t _random = 12345u;
+/*** local functions *********************************************************************************************/
+static uint64_t _nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t _nextRandom(void)
+{
+    _random = _random * 1103515245u + 12345u;
+    return _random >> 16;
+}
+
+static void _buildTrace(void)
+{
+    uint16_t base[BMS_CELL_COUNT];
+    int32_t current = 5000;
+
+    for(uint8_t cell = 0; cell < BMS_CELL_COUNT; cell++)
+    {
+        base[cell] = (uint16_t)(3300u + cell);
+    }
+    for(uint32_t i = 0; i < C_SAMPLE_COUNT; i++)
+    {
+        bms_sample_t* sample = &_trace[i];
+        uint32_t total = 0;
+
+        memset(sample, 0, sizeof(bms_sample_t));
+        sample->timeUs = (uint64_t)i * 200000u + (_nextRandom() % 4u == 0 ? 1000u : 0u);
+        if(_nextRandom() % 5u == 0)
+        {
+            current += (int32_t)(_nextRandom() % 201u) - 100;
+        }
+        sample->totalCurrent = current;
+        for(uint8_t cell = 0; cell < BMS_CELL_COUNT; cell++)
+        {
+            if(i % 50u == 0 && _nextRandom() % 4u == 0)
+            {
+                base[cell]--;
+            }
+            sample->cellVoltage[cell] = (uint16_t)(base[cell] + (_nextRandom() % 20u == 0 ? 1u : 0u));
+            total += sample->cellVoltage[cell];
+        }
+        // the pack measures its total on a channel of its own, it follows the cell sum within +-10 mV
+        sample->totalVoltage = total + (_nextRandom() % 21u) - 10u;
+    }
+}
+/*** main ********************************************************************************************************/
+int main(void)
+{
+    bms_encoder_t encoder;
+    bms_decoder_t decoder;
+    bms_sample_t sample;
+    uint32_t chunk = 0;
+    size_t encoded = 0;
+    uint32_t errors = 0;
+
+    _buildTrace();
+
+    uint64_t start = _nowNs();
+    bms_codec_encoderInit(&encoder, _chunks[chunk], C_CHUNK_SIZE);
+    for(uint32_t i = 0; i < C_SAMPLE_COUNT; i++)
+    {
+        if(!bms_codec_encode(&encoder, &_trace[i]))
+        {
+            _chunkLength[chunk++] = encoder.length;
+            bms_codec_encoderInit(&encoder, _chunks[chunk], C_CHUNK_SIZE);
+            bms_codec_encode(&encoder, &_trace[i]);
+        }
+    }
+    _chunkLength[chunk++] = encoder.length;
+    uint64_t encodeNs = _nowNs() - start;
+
+    uint32_t index = 0;
+    start = _nowNs();
+    for(uint32_t i = 0; i < chunk; i++)
+    {
+        bms_codec_decoderInit(&decoder, _chunks[i], _chunkLength[i]);
+        while(bms_codec_decode(&decoder, &sample))
+        {
+            errors += (sample.timeUs != _trace[index].timeUs || sample.totalCurrent != _trace[index].totalCurrent ||
+                       sample.totalVoltage != _trace[index].totalVoltage ||
+                       memcmp(sample.cellVoltage, _trace[index].cellVoltage, sizeof(sample.cellVoltage)) != 0);
+            index++;
+        }
+        encoded += _chunkLength[i];
+    }
+    uint64_t decodeNs = _nowNs() - start;
+
+    size_t payload = (size_t)C_SAMPLE_COUNT * (8u + 4u + 4u + BMS_CELL_COUNT * 2u);
+    size_t raw = (size_t)C_SAMPLE_COUNT * sizeof(bms_sample_t);
+    size_t used = (size_t)chunk * C_CHUNK_SIZE;
+    double ratio = (double)payload / encoded;
+
+    printf("samples:           %u in %u chunks of %u bytes, %u mismatches\n",
+           (unsigned)index, (unsigned)chunk, (unsigned)C_CHUNK_SIZE, (unsigned)errors);
+    printf("encoded:           %.2f bytes per sample\n", (double)encoded / C_SAMPLE_COUNT);
+    printf("ratio:             %.1fx vs packed fields (%u bytes), target %.0fx %s\n",
+           ratio, (unsigned)(payload / C_SAMPLE_COUNT), C_TARGET_RATIO, (ratio >= C_TARGET_RATIO) ? "met" : "MISSED");
+    printf("                   %.1fx vs packed fields incl. chunk slack, %.1fx vs bms_sample_t\n",
+           (double)payload / used, (double)raw / encoded);
+    printf("encode:            %.1f ns per sample\n", (double)encodeNs / C_SAMPLE_COUNT);
+    printf("decode:            %.1f ns per sample\n", (double)decodeNs / C_SAMPLE_COUNT);
+    return (errors == 0 && index == C_SAMPLE_COUNT) ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+/******************************************************************************************************************
+ * bms_history_bench.c
+ *  Created on: Mar 12, 2026
+ *      Author: M. Schermutzki
+ *
+ * Host benchmark of the history ring and its compressed archive: static footprint, append and query cost.
+ *  meson test -C build --benchmark -v
+ *****************************************************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <time.h>
+#include "bms_communication.h"
+#include "bms_history.h"
+#include "can_mock.h"
+#include "timer_mock.h"
+/*** local constants *********************************************************************************************/
+#define C_APPEND_COUNT  (1000000u)
+#define C_QUERY_COUNT   (100000u)
+/*** local functions *********************************************************************************************/
+static uint64_t _nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+/*** main ********************************************************************************************************/
+int main(void)
+{
+    hardware_interface_t hw = {0};
+    bms_sample_t sample = {0};
+    bms_sample_t result[8];
+    volatile uint32_t sink = 0;
+
+    can_init();
+    bms_communication_init();
+    bms_history_init();
+    hw.halHandle = (void*)can_new();
+    hw.comRead = (com_read_t)can_read;
+    hw.comWrite = (com_write_t)can_write;
+    hw.comTime = timer_mock_getTimeUs;
+
+    bms_history_t* history = bms_history_new(bms_communication_new(&hw, 0x1FFFC), 0);
+    uint32_t capacity = bms_history_getCapacity(history);
+
+    uint64_t start = _nowNs();
+    for(uint32_t i = 0; i < C_APPEND_COUNT; i++)
+    {
+        sample.timeUs = (uint64_t)i * 200000u;
+        sample.cellVoltage[i & 15u] = (uint16_t)i;
+        bms_history_append(history, &sample);
+    }
+    uint64_t appendNs = _nowNs() - start;
+
+    uint64_t first = (uint64_t)(C_APPEND_COUNT - capacity) * 200000u;
+    start = _nowNs();
+    for(uint32_t i = 0; i < C_QUERY_COUNT; i++)
+    {
+        uint64_t from = first + (uint64_t)(i % capacity) * 200000u;
+        sink += bms_history_query(history, from, from + 1000000u, result, 8);
+    }
+    uint64_t queryNs = _nowNs() - start;
+
+    // the archive on a trace of drifting cells with 1 mV flicker
+    start = _nowNs();
+    for(uint32_t i = 0; i < C_APPEND_COUNT; i++)
+    {
+        sample.timeUs = (uint64_t)i * 200000u;
+        sample.cellVoltage[i & 15u] = (uint16_t)(3300u - i / 5000u + ((i & 3u) == 0));
+        sample.totalVoltage = 52800u - i / 400u;
+        bms_history_archive(history, &sample);
+    }
+    uint64_t archiveNs = _nowNs() - start;
+    uint32_t archived = bms_history_getArchiveCount(history);
+
+    first = (uint64_t)(C_APPEND_COUNT - archived) * 200000u;
+    start = _nowNs();
+    for(uint32_t i = 0; i < C_QUERY_COUNT; i++)
+    {
+        uint64_t from = first + (uint64_t)(i % archived) * 200000u;
+        sink += bms_history_queryArchive(history, from, from + 1000000u, result, 8);
+    }
+    uint64_t archiveQueryNs = _nowNs() - start;
+
+    printf("history footprint: %zu bytes per pack (%u samples of %zu bytes and the archive)\n",
+           bms_history_getFootprint(), (unsigned)capacity, sizeof(bms_sample_t));
+    printf("archive:           %u samples of this trace, bms_codec_bench measures the ratio on a noisier one\n", (unsigned)archived);
+    printf("append:            %.1f ns per sample, %.1f ns archived\n",
+           (double)appendNs / C_APPEND_COUNT, (double)archiveNs / C_APPEND_COUNT);
+    printf("query (5 samples): %.1f ns per query, %.1f ns from the archive\n",
+           (double)queryNs / C_QUERY_COUNT, (double)archiveQueryNs / C_QUERY_COUNT);
+    (void)sink;
+
+    bms_history_deinit();
+    bms_communication_deinit();
+    can_deinit();
+    return 0;
+}
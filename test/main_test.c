@@ -4,6 +4,14 @@
 static void run_all_tests(void)
 {
     RUN_TEST_GROUP(BmsCommunication);
+    RUN_TEST_GROUP(SpscRing);
+    RUN_TEST_GROUP(SeqLock);
+    RUN_TEST_GROUP(BmsHistory);
+    RUN_TEST_GROUP(BmsCodec);
+    RUN_TEST_GROUP(BmsRollup);
+    RUN_TEST_GROUP(BgTask);
+    RUN_TEST_GROUP(BgExecutor);
+    RUN_TEST_GROUP(BgCoroutine);
 }
 
 int main(int argc, const char * argv[])
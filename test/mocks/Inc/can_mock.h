@@ -17,6 +17,8 @@ extern "C"
 #include <stdbool.h>
 #include "generic_hardware_interface.h"
 /*** local constants ****************************************************/
+#define C_CAN_MOCK_RX_FIFO  (16)
+#define C_CAN_MOCK_TX_LOG   (32)
 /*** macros *************************************************************/
 /*** definitions ********************************************************/
 typedef struct can_s
@@ -30,8 +32,26 @@ typedef struct can_s
     bool used;
     bool opened;
 
-    bool newData;
-    can_frame_t lastReceivedFrame; 
+    can_frame_t rxFifo[C_CAN_MOCK_RX_FIFO];
+    uint8_t rxHead;
+    uint8_t rxCount;
+
+    can_frame_t txLog[C_CAN_MOCK_TX_LOG];   // every frame written since can_new()
+    uint16_t txCount;
+
+    can_tx_status_t txStatusFifo[C_CAN_MOCK_RX_FIFO];
+    uint8_t txStatusHead;
+    uint8_t txStatusCount;
+
+    uint32_t filterCode;
+    uint32_t filterMask;
+    uint16_t filterCount;   // number of filter reconfigurations
+
+    uint16_t txSpace;       // frames a batch write accepts, 0 = unlimited
+    uint16_t writeBatchCount;
+    uint16_t readBatchCount;
+
+    uint32_t busOffCount;   // bus-off events the controller recovered from
 } can_t;
 /*** functions **********************************************************/
 
@@ -39,7 +59,15 @@ hal_status_t can_read(can_t* handle, can_frame_t* frame);
 hal_status_t can_write(can_t* handle, const void* data, uint16_t count);
 hal_status_t can_open(can_t* can, uint32_t baudrate);
 hal_status_t can_close(can_t* can);
+hal_status_t can_txStatus(can_t* handle, can_tx_status_t* txStatus);
+hal_status_t can_setFilter(can_t* handle, uint32_t code, uint32_t mask);
+hal_status_t can_writeBatch(can_t* handle, const can_frame_t* frames, uint16_t count, uint16_t* done);
+hal_status_t can_readBatch(can_t* handle, can_frame_t* frames, uint16_t count, uint16_t* done);
+void canMockSetTxSpace(can_t* handle, uint16_t space);
+uint32_t can_getBusOffCount(can_t* handle);
+void canMockBusOff(can_t* handle);
 void canMockPushResponse(can_t* handle, const can_frame_t* frame);
+void canMockPushTxStatus(can_t* handle, uint32_t id, hal_status_t status);
 can_t* can_new();
 void can_deinit(void);
 void can_init();
@@ -0,0 +1,27 @@
+/**************************************************************************
+timer_mock.h
+ Created on: Mar 02, 2026
+     Author: M. Schermutzki
+
+*************************************************************************/
+#ifndef TIMER_MOCK_H
+#define TIMER_MOCK_H
+
+#ifdef __cplusplus
+extern "C" 
+{
+#endif
+/*** includes ***********************************************************/
+#include <stdint.h>
+/*** local constants ****************************************************/
+/*** macros *************************************************************/
+/*** definitions ********************************************************/
+/*** functions **********************************************************/
+uint64_t timer_mock_getTimeUs(void);
+void timer_mock_advanceUs(uint64_t us);
+void timer_mock_setTimeUs(uint64_t us);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* TIMER_MOCK_H */
@@ -45,6 +45,12 @@ hal_status_t can_write(can_t* handle, const void* data, uint16_t count)
         handle->data[i] = sent_msg->data[i];
     }
 
+    if(handle->txCount < C_CAN_MOCK_TX_LOG)
+    {
+        handle->txLog[handle->txCount] = *sent_msg;
+    }
+    handle->txCount++;
+
     return E_HAL_STATUS_OK;
 }
 
@@ -52,30 +58,141 @@ hal_status_t can_write(can_t* handle, const void* data, uint16_t count)
 /**
  * Diese Funktion ist NUR für den Test gedacht.
  * Sie simuliert, dass ein Frame vom CAN-Bus empfangen wurde.
+ * Mehrere Frames werden in Empfangsreihenfolge gepuffert.
  */
 void canMockPushResponse(can_t* handle, const can_frame_t* frame)
 {
     assert(handle);
     assert(frame);
 
-    memcpy(&handle->lastReceivedFrame, frame, sizeof(can_frame_t));
-    handle->newData = true; 
+    if(handle->rxCount < C_CAN_MOCK_RX_FIFO)
+    {
+        uint8_t tail = (uint8_t)((handle->rxHead + handle->rxCount) % C_CAN_MOCK_RX_FIFO);
+        memcpy(&handle->rxFifo[tail], frame, sizeof(can_frame_t));
+        handle->rxCount++;
+    }
 }
 
 hal_status_t can_read(can_t* handle, can_frame_t* frame)
 {
     assert(handle);
-    if (handle->newData) 
+    if (handle->rxCount > 0) 
     {
-        handle->newData = false;
         if (frame != NULL) {
-            memcpy(frame, &handle->lastReceivedFrame, sizeof(can_frame_t));
+            memcpy(frame, &handle->rxFifo[handle->rxHead], sizeof(can_frame_t));
         }
+        handle->rxHead = (uint8_t)((handle->rxHead + 1u) % C_CAN_MOCK_RX_FIFO);
+        handle->rxCount--;
         return E_HAL_STATUS_OK;
     }
     return E_HAL_STATUS_BUSY; 
 }
 
+/**
+ * Simuliert die Sendebestätigung (oder einen Sendefehler) des Controllers.
+ */
+void canMockPushTxStatus(can_t* handle, uint32_t id, hal_status_t status)
+{
+    assert(handle);
+
+    if(handle->txStatusCount < C_CAN_MOCK_RX_FIFO)
+    {
+        uint8_t tail = (uint8_t)((handle->txStatusHead + handle->txStatusCount) % C_CAN_MOCK_RX_FIFO);
+        handle->txStatusFifo[tail].id = id;
+        handle->txStatusFifo[tail].status = status;
+        handle->txStatusCount++;
+    }
+}
+
+hal_status_t can_txStatus(can_t* handle, can_tx_status_t* txStatus)
+{
+    assert(handle);
+    assert(txStatus);
+
+    if(handle->txStatusCount > 0)
+    {
+        *txStatus = handle->txStatusFifo[handle->txStatusHead];
+        handle->txStatusHead = (uint8_t)((handle->txStatusHead + 1u) % C_CAN_MOCK_RX_FIFO);
+        handle->txStatusCount--;
+        return E_HAL_STATUS_OK;
+    }
+    return E_HAL_STATUS_BUSY;
+}
+
+hal_status_t can_setFilter(can_t* handle, uint32_t code, uint32_t mask)
+{
+    assert(handle);
+
+    handle->filterCode = code;
+    handle->filterMask = mask;
+    handle->filterCount++;
+    return E_HAL_STATUS_OK;
+}
+
+/**
+ * Schreibt die Frames der Reihe nach, solange txSpace reicht.
+ */
+hal_status_t can_writeBatch(can_t* handle, const can_frame_t* frames, uint16_t count, uint16_t* done)
+{
+    assert(handle);
+    assert(frames);
+    assert(done);
+
+    handle->writeBatchCount++;
+    *done = 0;
+    while(*done < count)
+    {
+        if(handle->txSpace != 0 && *done >= handle->txSpace)
+        {
+            return E_HAL_STATUS_BUSY;
+        }
+        can_write(handle, &frames[*done], 1);
+        (*done)++;
+    }
+    return E_HAL_STATUS_OK;
+}
+
+hal_status_t can_readBatch(can_t* handle, can_frame_t* frames, uint16_t count, uint16_t* done)
+{
+    assert(handle);
+    assert(frames);
+    assert(done);
+
+    handle->readBatchCount++;
+    *done = 0;
+    while(*done < count && can_read(handle, &frames[*done]) == E_HAL_STATUS_OK)
+    {
+        (*done)++;
+    }
+    return (*done > 0) ? E_HAL_STATUS_OK : E_HAL_STATUS_BUSY;
+}
+
+/**
+ * Begrenzt, wie viele Frames ein Batch-Aufruf annimmt, 0 = unbegrenzt.
+ */
+void canMockSetTxSpace(can_t* handle, uint16_t space)
+{
+    assert(handle);
+    handle->txSpace = space;
+}
+
+uint32_t can_getBusOffCount(can_t* handle)
+{
+    assert(handle);
+    return handle->busOffCount;
+}
+
+/**
+ * Simuliert einen Bus-Off mit anschließender Recovery des Controllers:
+ * gesendete, aber noch nicht bestätigte Frames gehen verloren.
+ */
+void canMockBusOff(can_t* handle)
+{
+    assert(handle);
+    handle->busOffCount++;
+    handle->txStatusCount = 0;
+}
+
 hal_status_t can_open(can_t* can, uint32_t baudrate)
 {
     can->baudrate = baudrate;
@@ -97,6 +214,7 @@ can_t* can_new()
         if(!_instances[i].used)
         {
             can_t* retval = &_instances[i];
+            memset(retval, 0, sizeof(can_t));
             _instances[i].opened = true;
             retval->used = true;
             return retval;
@@ -115,6 +233,9 @@ void can_deinit(void)
             _instances[i].id = 0;
             _instances[i].dlc = 0;
             _instances[i].opened = false;
+            _instances[i].rxCount = 0;
+            _instances[i].txCount = 0;
+            _instances[i].txStatusCount = 0;
             for(int j=0; j < 8; j++) _instances[i].data[j] = 0;
         }
         _initialized = false;
@@ -0,0 +1,34 @@
+/**************************************************************************
+cpu_it.c
+ Created on: Feb 18, 2026
+     Author: M. Schermutzki
+***************************************************************************/
+/*** includes *************************************************************/
+#include <stdint.h>
+#include "cpu_it.h"
+#include "interrupt_handler.h"
+/*** structures ***********************************************************/
+/*** local constants ******************************************************/
+/*** macros ***************************************************************/
+/*** local variables ******************************************************/
+static uint8_t _irqCount = 0;
+/*** prototypes ***********************************************************/
+/*** interrupt service routines *******************************************/
+/*** functions ************************************************************/
+void interrupt_handler_leaveCritical(void)
+{
+    if(_irqCount > 0)
+    {
+        _irqCount--;
+    }
+}
+
+void interrupt_handler_enterCritical(void)
+{
+    _irqCount++;
+}
+
+void interrupt_handler_init(void)
+{
+    _irqCount = 0;
+}
@@ -0,0 +1,32 @@
+/**************************************************************************
+timer_mock.c
+ Created on: Mar 02, 2026
+     Author: M. Schermutzki
+***************************************************************************/
+/*** includes *************************************************************/
+#include "timer_mock.h"
+/*** structures ***********************************************************/
+/*** local constants ******************************************************/
+/*** macros ***************************************************************/
+/*** local variables ******************************************************/
+static uint64_t _nowUs = 0;
+/*** prototypes ***********************************************************/
+/*** interrupt service routines *******************************************/
+/*** functions ************************************************************/
+/**
+ * Monotone Testuhr, läuft nur wenn der Test sie weiterstellt.
+ */
+uint64_t timer_mock_getTimeUs(void)
+{
+    return _nowUs;
+}
+
+void timer_mock_advanceUs(uint64_t us)
+{
+    _nowUs += us;
+}
+
+void timer_mock_setTimeUs(uint64_t us)
+{
+    _nowUs = us;
+}
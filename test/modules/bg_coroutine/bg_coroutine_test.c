@@ -0,0 +1,142 @@
+/******************************************************************************************************************
+ * bg_coroutine_test.c
+ *  Created on: Mar 20, 2026
+ *      Author: M. Schermutzki
+ *****************************************************************************************************************/
+ #include <string.h>
+ #include "unity_fixture.h"
+ #include "bg_coroutine.h"
+ #include "bg_task.h"
+ #include "timer_mock.h"
+/*** includes ****************************************************************************************************/
+/*================================================ DEFINE TEST GROUP ============================================*/
+/*** define ******************************************************************************************************/
+TEST_GROUP(BgCoroutine);
+/*** local variables *********************************************************************************************/
+static char _trace[8];
+static uint8_t _traceLength = 0;
+static bool _frameReceived = false;
+static bg_co_signal_t _signal;
+/*** local functions *********************************************************************************************/
+static bool _takeFrame(void)
+{
+    bool received = _frameReceived;
+    _frameReceived = false;
+    return received;
+}
+
+static bg_co_status_t _sequence(bg_co_t* co)
+{
+    BG_CO_BEGIN(co);
+    _trace[_traceLength++] = 'A';
+    BG_CO_AWAIT(co, _takeFrame());
+    _trace[_traceLength++] = 'B';
+    BG_CO_YIELD(co);
+    _trace[_traceLength++] = 'C';
+    BG_CO_END(co);
+}
+
+static bg_co_status_t _request(bg_co_t* co)
+{
+    BG_CO_BEGIN(co);
+    for(;;)
+    {
+        BG_CO_AWAIT_TIMEOUT(co, _takeFrame(), 50000);
+        _trace[_traceLength++] = BG_CO_TIMED_OUT(co) ? 'T' : 'F';
+    }
+    BG_CO_END(co);
+}
+
+static bg_co_status_t _waiter(bg_co_t* co)
+{
+    BG_CO_BEGIN(co);
+    BG_CO_AWAIT_SIGNAL(co, &_signal);
+    _trace[_traceLength++] = 'S';
+    BG_CO_END(co);
+}
+/*** setup *******************************************************************************************************/
+TEST_SETUP(BgCoroutine)
+{
+    _traceLength = 0;
+    _frameReceived = false;
+    memset(_trace, 0, sizeof(_trace));
+    bg_co_signal_init(&_signal);
+    timer_mock_setTimeUs(0);
+    bg_task_init();
+    bg_task_setTimeSource(timer_mock_getTimeUs);
+    bg_co_init();
+}
+/*** tear down ***************************************************************************************************/
+TEST_TEAR_DOWN(BgCoroutine)
+{
+    bg_co_deinit();
+    bg_task_deinit();
+}
+/*==================================================== TEST LIST ================================================*/
+/*****************************************************************************************************************
+* This test checks that a coroutine continues after the await it returned from, not from the start
+******************************************************************************************************************/
+TEST(BgCoroutine, sequenceResumesWhereItAwaited)
+{
+    bg_co_t co;
+
+    bg_co_setup(&co, _sequence, NULL);
+
+    TEST_ASSERT_EQUAL(E_BG_CO_WAITING, bg_co_resume(&co, 0));
+    TEST_ASSERT_EQUAL(E_BG_CO_WAITING, bg_co_resume(&co, 0));
+    TEST_ASSERT_EQUAL_STRING("A", _trace);
+
+    _frameReceived = true;
+    TEST_ASSERT_EQUAL(E_BG_CO_WAITING, bg_co_resume(&co, 0));
+    TEST_ASSERT_EQUAL_STRING("AB", _trace);
+    TEST_ASSERT_EQUAL(E_BG_CO_DONE, bg_co_resume(&co, 0));
+    TEST_ASSERT_EQUAL_STRING("ABC", _trace);
+
+    // a finished coroutine starts over
+    TEST_ASSERT_EQUAL(E_BG_CO_WAITING, bg_co_resume(&co, 0));
+    TEST_ASSERT_EQUAL_STRING("ABCA", _trace);
+}
+/*****************************************************************************************************************
+* This test checks that a coroutine task sleeps until its timeout and that a frame ends the wait before it
+******************************************************************************************************************/
+TEST(BgCoroutine, awaitEndsWithFrameOrTimeout)
+{
+    TEST_ASSERT_NOT_NULL(bg_co_start(_request, NULL, "request", E_BG_TASK_PRIO_MID, 1000));
+
+    bg_task_cyclic();
+    TEST_ASSERT_EQUAL_UINT64(50000, bg_task_getNextDue());
+
+    timer_mock_setTimeUs(50000);
+    bg_task_cyclic();
+    TEST_ASSERT_EQUAL_STRING("T", _trace);
+    TEST_ASSERT_EQUAL_UINT64(100000, bg_task_getNextDue());
+
+    _frameReceived = true;
+    timer_mock_setTimeUs(60000);
+    bg_task_cyclic();
+    TEST_ASSERT_EQUAL_STRING("T", _trace);
+
+    timer_mock_setTimeUs(100000);
+    bg_task_cyclic();
+    TEST_ASSERT_EQUAL_STRING("TF", _trace);
+}
+/*****************************************************************************************************************
+* This test checks that raising a signal wakes the coroutine waiting on it and a finished coroutine frees its task
+******************************************************************************************************************/
+TEST(BgCoroutine, signalWakesWaitingCoroutine)
+{
+    bg_task_stats_t stats;
+
+    TEST_ASSERT_NOT_NULL(bg_co_start(_waiter, NULL, "waiter", E_BG_TASK_PRIO_LOW, 1000));
+
+    bg_task_cyclic();
+    TEST_ASSERT_EQUAL_UINT64(1000000, bg_task_getNextDue());
+
+    timer_mock_setTimeUs(1000);
+    bg_co_signal_raise(&_signal);
+    TEST_ASSERT_EQUAL_UINT64(0, bg_task_getNextDue());
+
+    bg_task_cyclic();
+    TEST_ASSERT_EQUAL_STRING("S", _trace);
+    TEST_ASSERT_FALSE(bg_task_getStats("waiter", &stats));
+}
@@ -0,0 +1,13 @@
+/******************************************************************************************************************
+ * bg_coroutine_test_runner.c
+ *  Created on: Mar 20, 2026
+ *      Author: M. Schermutzki
+ *****************************************************************************************************************/
+ #include "unity_fixture.h"
+/*** TEST CASE RUNNER ********************************************************************************************/
+TEST_GROUP_RUNNER(BgCoroutine) 
+{
+    RUN_TEST_CASE(BgCoroutine, sequenceResumesWhereItAwaited);
+    RUN_TEST_CASE(BgCoroutine, awaitEndsWithFrameOrTimeout);
+    RUN_TEST_CASE(BgCoroutine, signalWakesWaitingCoroutine);
+}
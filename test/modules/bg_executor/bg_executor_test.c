@@ -0,0 +1,195 @@
+/******************************************************************************************************************
+ * bg_executor_test.c
+ *  Created on: Mar 18, 2026
+ *      Author: M. Schermutzki
+ *****************************************************************************************************************/
+ #define _POSIX_C_SOURCE 200809L
+ #include <pthread.h>
+ #include <time.h>
+ #include "unity_fixture.h"
+ #include "bg_executor.h"
+ #include "bg_task.h"
+ #include "bms_communication.h"
+ #include "can_mock.h"
+/*** includes ****************************************************************************************************/
+/*================================================ DEFINE TEST GROUP ============================================*/
+/*** define ******************************************************************************************************/
+TEST_GROUP(BgExecutor);
+/*** local variables *********************************************************************************************/
+static const bg_executor_config_t C_CONFIG[E_BG_TASK_PRIO_COUNT] = 
+{
+    [E_BG_TASK_PRIO_LOW]  = { .stackSize = 4096, .priority = 1, .core = 1 },
+    [E_BG_TASK_PRIO_MID]  = { .stackSize = 4096, .priority = 2, .core = BG_EXECUTOR_ANY_CORE },
+    [E_BG_TASK_PRIO_HIGH] = { .stackSize = 4096, .priority = 3, .core = 0 },
+};
+static uint32_t _lowRuns = 0;
+static uint32_t _highRuns = 0;
+static pthread_t _lowThread;
+static pthread_t _highThread;
+static bms_com_t* _bms = NULL;
+static bg_task_handle_t* _bmsTask = NULL;
+static uint32_t _writeAttempts = 0;
+/*** local functions *********************************************************************************************/
+static uint64_t _clock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static void _sleepMs(uint32_t ms)
+{
+    struct timespec ts = { .tv_sec = 0, .tv_nsec = (long)ms * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+static void _low(void)
+{
+    _lowThread = pthread_self();
+    __atomic_fetch_add(&_lowRuns, 1u, __ATOMIC_RELAXED);
+}
+
+static void _high(void)
+{
+    _highThread = pthread_self();
+    __atomic_fetch_add(&_highRuns, 1u, __ATOMIC_RELAXED);
+}
+
+static hal_status_t _failingWriteBatch(void* handle, const can_frame_t* frames, uint16_t count, uint16_t* done)
+{
+    (void)handle;
+    (void)frames;
+    (void)count;
+    __atomic_fetch_add(&_writeAttempts, 1u, __ATOMIC_RELAXED);
+    *done = 0;
+    return E_HAL_STATUS_ERROR;
+}
+
+static void _bmsCyclic(void)
+{
+    bms_communication_cyclic(_bms);
+    bg_task_wakeAt(_bmsTask, bms_communication_getNextDeadline(_bms));
+}
+
+static uint32_t _waitForRuns(uint32_t* runs)
+{
+    for(uint32_t i = 0; i < 1000 && __atomic_load_n(runs, __ATOMIC_ACQUIRE) == 0; i++)
+    {
+        _sleepMs(1);
+    }
+    return __atomic_load_n(runs, __ATOMIC_ACQUIRE);
+}
+/*** setup *******************************************************************************************************/
+TEST_SETUP(BgExecutor) 
+{
+    _lowRuns = 0;
+    _highRuns = 0;
+    _writeAttempts = 0;
+    bg_task_init();
+    bg_task_setTimeSource(_clock);
+}
+/*** tear down ***************************************************************************************************/
+TEST_TEAR_DOWN(BgExecutor) 
+{
+    bg_executor_stop();
+    bg_task_deinit();
+}
+/*==================================================== TEST LIST ================================================*/
+/*****************************************************************************************************************
+* This test checks that every priority runs its tasks in a thread of its own
+******************************************************************************************************************/
+TEST(BgExecutor, prioritiesRunInThreadsOfTheirOwn)
+{
+    bg_task_add(_low, "low", E_BG_TASK_PRIO_LOW, 2, 0);
+    bg_task_add(_high, "high", E_BG_TASK_PRIO_HIGH, 1, 0);
+
+    TEST_ASSERT_TRUE(bg_executor_start(C_CONFIG));
+    TEST_ASSERT_TRUE(bg_executor_isRunning());
+    TEST_ASSERT_FALSE(bg_executor_start(C_CONFIG));
+    _sleepMs(30);
+    bg_executor_stop();
+    TEST_ASSERT_FALSE(bg_executor_isRunning());
+
+    TEST_ASSERT_GREATER_THAN_UINT32(2, _lowRuns);
+    TEST_ASSERT_GREATER_THAN_UINT32(_lowRuns, _highRuns);
+    TEST_ASSERT_FALSE(pthread_equal(_lowThread, _highThread));
+    TEST_ASSERT_FALSE(pthread_equal(_lowThread, pthread_self()));
+}
+/*****************************************************************************************************************
+* This test checks that tasks can be added and removed from another thread while the executor runs
+******************************************************************************************************************/
+TEST(BgExecutor, tasksCanBeAddedAndRemovedWhileRunning)
+{
+    TEST_ASSERT_TRUE(bg_executor_start(C_CONFIG));
+
+    bg_task_handle_t* high = bg_task_add(_high, "high", E_BG_TASK_PRIO_HIGH, 0, 0);
+    TEST_ASSERT_NOT_NULL(high);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, _waitForRuns(&_highRuns));
+
+    bg_task_remove(high);
+    _sleepMs(2);
+    uint32_t runs = __atomic_load_n(&_highRuns, __ATOMIC_ACQUIRE);
+    _sleepMs(20);
+    TEST_ASSERT_EQUAL_UINT32(runs, __atomic_load_n(&_highRuns, __ATOMIC_ACQUIRE));
+    TEST_ASSERT_FALSE(bg_task_getStats("high", &(bg_task_stats_t){0}));
+}
+/*****************************************************************************************************************
+* This test checks that a blocked thread is woken at once by a wake up and accounts its idle time
+******************************************************************************************************************/
+TEST(BgExecutor, wakeUpEndsTheWaitOfAThread)
+{
+    bg_executor_load_t start;
+    bg_executor_load_t end;
+
+    bg_task_handle_t* high = bg_task_add(_high, "high", E_BG_TASK_PRIO_HIGH, 5000, 5000);
+    TEST_ASSERT_TRUE(bg_executor_start(C_CONFIG));
+    bg_executor_getLoad(E_BG_TASK_PRIO_HIGH, &start);
+    _sleepMs(20);
+    TEST_ASSERT_EQUAL_UINT32(0, __atomic_load_n(&_highRuns, __ATOMIC_ACQUIRE));
+
+    uint64_t woken = _clock();
+    bg_task_wake(high);
+    TEST_ASSERT_EQUAL_UINT32(1, _waitForRuns(&_highRuns));
+    TEST_ASSERT_LESS_THAN_UINT64(500000, _clock() - woken);
+
+    _sleepMs(20);
+    bg_executor_getLoad(E_BG_TASK_PRIO_HIGH, &end);
+    TEST_ASSERT_GREATER_THAN_UINT32(15000, end.idleUs - start.idleUs);
+    TEST_ASSERT_LESS_THAN_UINT16(100, bg_executor_getDutyCycle(&start, &end));
+}
+/*****************************************************************************************************************
+* This test checks that a task sleeping until the next deadline of a bms does not spin while its writes fail
+******************************************************************************************************************/
+TEST(BgExecutor, failingWritesDoNotSpinTheBmsTask)
+{
+    bg_executor_load_t start;
+    bg_executor_load_t end;
+    hardware_interface_t hw = {0};
+
+    can_init();
+    bms_communication_init();
+    hw.halHandle = (void*)can_new();
+    hw.comRead = (com_read_t)can_read;
+    hw.comWrite = (com_write_t)can_write;
+    hw.comOpen = (com_open_t)can_open;
+    hw.comClose = (com_close_t)can_close;
+    hw.comTime = _clock;
+    hw.comTxStatus = (com_tx_status_t)can_txStatus;
+    hw.comSetFilter = (com_set_filter_t)can_setFilter;
+    hw.comWriteBatch = _failingWriteBatch;
+    _bms = bms_communication_new(&hw, 0x1FFFC);
+    TEST_ASSERT_NOT_NULL(_bms);
+    _bmsTask = bg_task_add(_bmsCyclic, "bms", E_BG_TASK_PRIO_HIGH, 1000, 0);
+
+    TEST_ASSERT_TRUE(bg_executor_start(C_CONFIG));
+    bg_executor_getLoad(E_BG_TASK_PRIO_HIGH, &start);
+    _sleepMs(200);
+    bg_executor_getLoad(E_BG_TASK_PRIO_HIGH, &end);
+    bg_executor_stop();
+
+    TEST_ASSERT_LESS_THAN_UINT32(50, end.wakeups - start.wakeups);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, _writeAttempts);
+    TEST_ASSERT_LESS_THAN_UINT32(50, _writeAttempts);
+    bms_communication_deinit();
+    can_deinit();
+}
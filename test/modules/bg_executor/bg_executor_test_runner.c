@@ -0,0 +1,14 @@
+/******************************************************************************************************************
+ * bg_executor_test_runner.c
+ *  Created on: Mar 18, 2026
+ *      Author: M. Schermutzki
+ *****************************************************************************************************************/
+ #include "unity_fixture.h"
+/*** TEST CASE RUNNER ********************************************************************************************/
+TEST_GROUP_RUNNER(BgExecutor) 
+{
+    RUN_TEST_CASE(BgExecutor, prioritiesRunInThreadsOfTheirOwn);
+    RUN_TEST_CASE(BgExecutor, tasksCanBeAddedAndRemovedWhileRunning);
+    RUN_TEST_CASE(BgExecutor, wakeUpEndsTheWaitOfAThread);
+    RUN_TEST_CASE(BgExecutor, failingWritesDoNotSpinTheBmsTask);
+}
@@ -0,0 +1,270 @@
+/******************************************************************************************************************
+ * bg_task_test.c
+ *  Created on: Mar 16, 2026
+ *      Author: M. Schermutzki
+ *****************************************************************************************************************/
+ #include <string.h>
+ #include "unity_fixture.h"
+ #include "bg_task.h"
+ #include "timer_mock.h"
+/*** includes ****************************************************************************************************/
+/*================================================ DEFINE TEST GROUP ============================================*/
+/*** define ******************************************************************************************************/
+TEST_GROUP(BgTask);
+/*** local variables *********************************************************************************************/
+static uint32_t _fastRuns = 0;
+static uint32_t _slowRuns = 0;
+static char _order[16];
+static uint8_t _orderLength = 0;
+static bg_task_handle_t* _self = NULL;
+static uint32_t _cycleCount = 0;
+static uint32_t _cost = 0;
+/*** local functions *********************************************************************************************/
+static void _fast(void)
+{
+    _fastRuns++;
+}
+
+static void _slow(void)
+{
+    _slowRuns++;
+}
+
+static void _low(void)
+{
+    _order[_orderLength++] = 'L';
+}
+
+static void _high(void)
+{
+    _order[_orderLength++] = 'H';
+}
+
+static void _named(void* context)
+{
+    _order[_orderLength++] = *(const char*)context;
+}
+
+static uint32_t _cycleCounter(void)
+{
+    return _cycleCount;
+}
+
+static void _work(void)
+{
+    _cycleCount += _cost;
+}
+
+static void _once(void)
+{
+    _fastRuns++;
+    bg_task_remove(_self);
+}
+/*** setup *******************************************************************************************************/
+TEST_SETUP(BgTask) 
+{
+    _fastRuns = 0;
+    _slowRuns = 0;
+    _orderLength = 0;
+    memset(_order, 0, sizeof(_order));
+    timer_mock_setTimeUs(0);
+    bg_task_init();
+    bg_task_setTimeSource(timer_mock_getTimeUs);
+}
+/*** tear down ***************************************************************************************************/
+TEST_TEAR_DOWN(BgTask) 
+{
+    bg_task_deinit();
+}
+/*==================================================== TEST LIST ================================================*/
+/*****************************************************************************************************************
+* This test checks that a periodic task only runs when due, the first time after its offset
+******************************************************************************************************************/
+TEST(BgTask, periodicTaskRunsOnlyWhenDue)
+{
+    bg_task_add(_slow, "slow", E_BG_TASK_PRIO_LOW, 10, 5);
+    TEST_ASSERT_EQUAL_UINT64(5000, bg_task_getNextDue());
+
+    for(uint64_t time = 0; time < 30000; time += 1000)
+    {
+        timer_mock_setTimeUs(time);
+        bg_task_cyclic();
+    }
+
+    // due at 5, 15 and 25 ms
+    TEST_ASSERT_EQUAL_UINT32(3, _slowRuns);
+    TEST_ASSERT_EQUAL_UINT64(35000, bg_task_getNextDue());
+}
+/*****************************************************************************************************************
+* This test checks that a late start is reported and does not shift the following due times
+******************************************************************************************************************/
+TEST(BgTask, lateStartIsReportedAndKeepsThePhase)
+{
+    bg_task_stats_t stats;
+
+    bg_task_add(_slow, "slow", E_BG_TASK_PRIO_LOW, 10, 0);
+
+    timer_mock_setTimeUs(3000);
+    bg_task_cyclic();
+    timer_mock_setTimeUs(34000);
+    bg_task_cyclic();
+
+    TEST_ASSERT_TRUE(bg_task_getStats("slow", &stats));
+    TEST_ASSERT_EQUAL_UINT32(2, stats.runs);
+    TEST_ASSERT_EQUAL_UINT32(24000, stats.lastLatenessUs);
+    TEST_ASSERT_EQUAL_UINT32(24000, stats.maxLatenessUs);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.missed);
+    TEST_ASSERT_EQUAL_UINT64(40000, stats.nextDueUs);
+    TEST_ASSERT_FALSE(bg_task_getStats("unknown", &stats));
+}
+/*****************************************************************************************************************
+* This test checks that a task without a period runs on every pass next to periodic ones
+******************************************************************************************************************/
+TEST(BgTask, taskWithoutPeriodRunsOnEveryPass)
+{
+    bg_task_add(_slow, "slow", E_BG_TASK_PRIO_LOW, 100, 0);
+    bg_task_add(_fast, "fast", E_BG_TASK_PRIO_HIGH, 0, 0);
+    TEST_ASSERT_EQUAL_UINT64(0, bg_task_getNextDue());
+
+    for(uint8_t i = 0; i < 5; i++)
+    {
+        timer_mock_advanceUs(1000);
+        bg_task_cyclic();
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(5, _fastRuns);
+    TEST_ASSERT_EQUAL_UINT32(1, _slowRuns);
+}
+/*****************************************************************************************************************
+* This test checks that ready tasks run highest priority first and in order of registration within a priority
+******************************************************************************************************************/
+TEST(BgTask, readyTasksRunHighestPriorityFirst)
+{
+    bg_task_add(_low, "low", E_BG_TASK_PRIO_LOW, 0, 0);
+    bg_task_add(_high, "high1", E_BG_TASK_PRIO_HIGH, 0, 0);
+    bg_task_add(_slow, "mid", E_BG_TASK_PRIO_MID, 10, 5);
+    bg_task_add(_high, "high2", E_BG_TASK_PRIO_HIGH, 0, 0);
+
+    bg_task_cyclic();
+    bg_task_cyclic();
+
+    TEST_ASSERT_EQUAL_STRING("HHLHHL", _order);
+    TEST_ASSERT_EQUAL_UINT32(0, _slowRuns);
+}
+/*****************************************************************************************************************
+* This test checks that tasks can be removed, also by themselves, and suspended and resumed in phase
+******************************************************************************************************************/
+TEST(BgTask, tasksCanBeRemovedSuspendedAndResumed)
+{
+    bg_task_stats_t stats;
+
+    _self = bg_task_add(_once, "once", E_BG_TASK_PRIO_MID, 0, 0);
+    bg_task_handle_t* slow = bg_task_add(_slow, "slow", E_BG_TASK_PRIO_LOW, 10, 0);
+    TEST_ASSERT_NOT_NULL(_self);
+
+    bg_task_cyclic();
+    bg_task_cyclic();
+    TEST_ASSERT_EQUAL_UINT32(1, _fastRuns);
+    TEST_ASSERT_FALSE(bg_task_getStats("once", &stats));
+
+    bg_task_suspend(slow);
+    TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, bg_task_getNextDue());
+    timer_mock_setTimeUs(35000);
+    bg_task_cyclic();
+    TEST_ASSERT_EQUAL_UINT32(1, _slowRuns);
+
+    bg_task_resume(slow);
+    TEST_ASSERT_EQUAL_UINT64(40000, bg_task_getNextDue());
+    timer_mock_setTimeUs(40000);
+    bg_task_cyclic();
+    TEST_ASSERT_EQUAL_UINT32(2, _slowRuns);
+    TEST_ASSERT_TRUE(bg_task_getStats("slow", &stats));
+    TEST_ASSERT_EQUAL_UINT32(0, stats.missed);
+
+    bg_task_remove(slow);
+    TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, bg_task_getNextDue());
+}
+/*****************************************************************************************************************
+* This test checks that runs are timed with the cycle counter and runs longer than the period count as overrun
+******************************************************************************************************************/
+TEST(BgTask, runsAreProfiledByName)
+{
+    bg_task_profile_t profile;
+    uint32_t cost[] = { 2400, 4800, 3600000 };
+
+    bg_task_setCycleCounter(_cycleCounter, 240);
+    _cycleCount = UINT32_MAX - 1000u;
+    bg_task_add(_work, "work", E_BG_TASK_PRIO_MID, 10, 0);
+
+    for(uint8_t i = 0; i < 3; i++)
+    {
+        _cost = cost[i];
+        timer_mock_setTimeUs((uint64_t)i * 10000u);
+        bg_task_cyclic();
+    }
+
+    TEST_ASSERT_TRUE(bg_task_getProfile("work", &profile));
+    TEST_ASSERT_EQUAL_UINT32(3, profile.calls);
+    TEST_ASSERT_EQUAL_UINT32(1, profile.overruns);
+    TEST_ASSERT_EQUAL_UINT32(10000, profile.minNs);
+    TEST_ASSERT_EQUAL_UINT32(15000000, profile.maxNs);
+    TEST_ASSERT_EQUAL_UINT32(5010000, profile.meanNs);
+    TEST_ASSERT_FALSE(bg_task_getProfile("unknown", &profile));
+}
+/*****************************************************************************************************************
+* This test checks that a wake up runs a task early without shifting its periodic runs
+******************************************************************************************************************/
+TEST(BgTask, wakeUpRunsTaskEarlyAndKeepsItsPeriod)
+{
+    bg_task_stats_t stats;
+    bg_task_handle_t* slow = bg_task_add(_slow, "slow", E_BG_TASK_PRIO_LOW, 100, 100);
+
+    bg_task_wakeAt(slow, 30000);
+    TEST_ASSERT_EQUAL_UINT64(30000, bg_task_getNextDue());
+    timer_mock_setTimeUs(30000);
+    bg_task_cyclic();
+    TEST_ASSERT_EQUAL_UINT32(1, _slowRuns);
+    TEST_ASSERT_EQUAL_UINT64(100000, bg_task_getNextDue());
+
+    bg_task_wake(slow);
+    TEST_ASSERT_EQUAL_UINT64(0, bg_task_getNextDue());
+    timer_mock_setTimeUs(31000);
+    bg_task_cyclic();
+    timer_mock_setTimeUs(100000);
+    bg_task_cyclic();
+
+    TEST_ASSERT_EQUAL_UINT32(3, _slowRuns);
+    TEST_ASSERT_TRUE(bg_task_getStats("slow", &stats));
+    TEST_ASSERT_EQUAL_UINT32(0, stats.lastLatenessUs);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.missed);
+    TEST_ASSERT_EQUAL_UINT64(200000, stats.nextDueUs);
+}
+/*****************************************************************************************************************
+* This test checks that sleeping tasks wake in the order of their due times, same ones in the order they slept
+******************************************************************************************************************/
+TEST(BgTask, sleepingTasksWakeInDueOrder)
+{
+    static const char names[] = "abcdefg";
+    static const uint32_t offsetsMs[] = {30, 10, 50, 20, 20, 40, 5};
+    bg_task_handle_t* tasks[7];
+
+    for(uint8_t i = 0; i < 7; i++)
+    {
+        tasks[i] = bg_task_addContext(_named, (void*)&names[i], "named", E_BG_TASK_PRIO_LOW, 100, offsetsMs[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT64(5000, bg_task_getNextDue());
+
+    // taken out from the root and from the middle of the heap
+    bg_task_remove(tasks[6]);
+    bg_task_remove(tasks[5]);
+    TEST_ASSERT_EQUAL_UINT64(10000, bg_task_getNextDue());
+
+    bg_task_wakeAt(tasks[2], 15000);
+    timer_mock_setTimeUs(60000);
+    bg_task_cyclic();
+    TEST_ASSERT_EQUAL_STRING("bcdea", _order);
+
+    timer_mock_setTimeUs(200000);
+    bg_task_cyclic();
+    TEST_ASSERT_EQUAL_STRING("bcdeabdeac", _order);
+}
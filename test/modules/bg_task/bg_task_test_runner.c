@@ -0,0 +1,18 @@
+/******************************************************************************************************************
+ * bg_task_test_runner.c
+ *  Created on: Mar 16, 2026
+ *      Author: M. Schermutzki
+ *****************************************************************************************************************/
+ #include "unity_fixture.h"
+/*** TEST CASE RUNNER ********************************************************************************************/
+TEST_GROUP_RUNNER(BgTask) 
+{
+    RUN_TEST_CASE(BgTask, periodicTaskRunsOnlyWhenDue);
+    RUN_TEST_CASE(BgTask, lateStartIsReportedAndKeepsThePhase);
+    RUN_TEST_CASE(BgTask, taskWithoutPeriodRunsOnEveryPass);
+    RUN_TEST_CASE(BgTask, readyTasksRunHighestPriorityFirst);
+    RUN_TEST_CASE(BgTask, tasksCanBeRemovedSuspendedAndResumed);
+    RUN_TEST_CASE(BgTask, runsAreProfiledByName);
+    RUN_TEST_CASE(BgTask, wakeUpRunsTaskEarlyAndKeepsItsPeriod);
+    RUN_TEST_CASE(BgTask, sleepingTasksWakeInDueOrder);
+}
@@ -0,0 +1,124 @@
+/******************************************************************************************************************
+ * bms_codec_test.c
+ *  Created on: Mar 14, 2026
+ *      Author: M. Schermutzki
+ *****************************************************************************************************************/
+ #include "unity_fixture.h"
+ #include <string.h>
+ #include "bms_codec.h"
+/*** includes ****************************************************************************************************/
+/*================================================ DEFINE TEST GROUP ============================================*/
+/*** define ******************************************************************************************************/
+TEST_GROUP(BmsCodec);
+/*** local variables *********************************************************************************************/
+static uint8_t _chunk[256];
+static bms_encoder_t _encoder;
+static bms_decoder_t _decoder;
+/*** local functions *********************************************************************************************/
+static void _makeSample(bms_sample_t* sample, uint32_t index)
+{
+    memset(sample, 0, sizeof(bms_sample_t));
+    sample->timeUs = 1000000u + (uint64_t)index * 200000u + ((index == 7) ? 150u : 0u);
+    sample->totalVoltage = 53000u + index;
+    sample->totalCurrent = (index & 1u) ? -12000 : 8000;
+    for(uint8_t cell = 0; cell < BMS_CELL_COUNT; cell++)
+    {
+        sample->cellVoltage[cell] = (uint16_t)(3300u + cell + ((cell == index % BMS_CELL_COUNT) ? 1u : 0u));
+    }
+}
+/*** setup *******************************************************************************************************/
+TEST_SETUP(BmsCodec) 
+{
+    bms_codec_encoderInit(&_encoder, _chunk, sizeof(_chunk));
+}
+/*** tear down ***************************************************************************************************/
+TEST_TEAR_DOWN(BmsCodec) 
+{
+}
+/*==================================================== TEST LIST ================================================*/
+/*****************************************************************************************************************
+* This test checks that decoded samples equal the encoded ones, including negative currents and jitter
+******************************************************************************************************************/
+TEST(BmsCodec, samplesSurviveTheRoundTrip)
+{
+    bms_sample_t in;
+    bms_sample_t out;
+
+    for(uint32_t i = 0; i < 10; i++)
+    {
+        _makeSample(&in, i);
+        TEST_ASSERT_TRUE(bms_codec_encode(&_encoder, &in));
+    }
+
+    bms_codec_decoderInit(&_decoder, _chunk, _encoder.length);
+    for(uint32_t i = 0; i < 10; i++)
+    {
+        _makeSample(&in, i);
+        TEST_ASSERT_TRUE(bms_codec_decode(&_decoder, &out));
+        TEST_ASSERT_EQUAL_UINT64(in.timeUs, out.timeUs);
+        TEST_ASSERT_EQUAL_UINT32(in.totalVoltage, out.totalVoltage);
+        TEST_ASSERT_EQUAL_INT32(in.totalCurrent, out.totalCurrent);
+        TEST_ASSERT_EQUAL_UINT16_ARRAY(in.cellVoltage, out.cellVoltage, BMS_CELL_COUNT);
+    }
+    TEST_ASSERT_FALSE(bms_codec_decode(&_decoder, &out));
+}
+/*****************************************************************************************************************
+* This test checks that a sample without changes at a constant rate takes one byte, a 1 mV step one more
+******************************************************************************************************************/
+TEST(BmsCodec, unchangedSampleTakesOneByte)
+{
+    bms_sample_t sample;
+
+    _makeSample(&sample, 0);
+    bms_codec_encode(&_encoder, &sample);
+    sample.timeUs += 200000u;
+    bms_codec_encode(&_encoder, &sample);
+
+    size_t length = _encoder.length;
+    sample.timeUs += 200000u;
+    TEST_ASSERT_TRUE(bms_codec_encode(&_encoder, &sample));
+    TEST_ASSERT_EQUAL_UINT32(1, _encoder.length - length);
+
+    length = _encoder.length;
+    sample.timeUs += 200000u;
+    sample.cellVoltage[9]--;
+    sample.totalVoltage--;
+    TEST_ASSERT_TRUE(bms_codec_encode(&_encoder, &sample));
+    TEST_ASSERT_EQUAL_UINT32(2, _encoder.length - length);
+
+    // a jittered sample costs its time once, the next one is back on the grid
+    length = _encoder.length;
+    sample.timeUs += 201000u;
+    TEST_ASSERT_TRUE(bms_codec_encode(&_encoder, &sample));
+    sample.timeUs += 199000u;
+    TEST_ASSERT_TRUE(bms_codec_encode(&_encoder, &sample));
+    TEST_ASSERT_EQUAL_UINT32(4, _encoder.length - length);
+}
+/*****************************************************************************************************************
+* This test checks that a sample that does not fit leaves the chunk intact and a new chunk decodes on its own
+******************************************************************************************************************/
+TEST(BmsCodec, fullChunkRejectsSample)
+{
+    bms_sample_t in;
+    bms_sample_t out;
+    uint32_t index = 0;
+
+    bms_codec_encoderInit(&_encoder, _chunk, 40);
+    _makeSample(&in, index);
+    while(bms_codec_encode(&_encoder, &in))
+    {
+        _makeSample(&in, ++index);
+    }
+    size_t length = _encoder.length;
+    TEST_ASSERT_FALSE(bms_codec_encode(&_encoder, &in));
+    TEST_ASSERT_EQUAL_UINT32(length, _encoder.length);
+    TEST_ASSERT_EQUAL_UINT32(index, _encoder.count);
+
+    // the rejected sample becomes the key frame of the next chunk
+    bms_codec_encoderInit(&_encoder, &_chunk[64], 64);
+    TEST_ASSERT_TRUE(bms_codec_encode(&_encoder, &in));
+    bms_codec_decoderInit(&_decoder, &_chunk[64], _encoder.length);
+    TEST_ASSERT_TRUE(bms_codec_decode(&_decoder, &out));
+    TEST_ASSERT_EQUAL_UINT64(in.timeUs, out.timeUs);
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(in.cellVoltage, out.cellVoltage, BMS_CELL_COUNT);
+}
@@ -0,0 +1,13 @@
+/******************************************************************************************************************
+ * bms_codec_test_runner.c
+ *  Created on: Mar 14, 2026
+ *      Author: M. Schermutzki
+ *****************************************************************************************************************/
+ #include "unity_fixture.h"
+/*** TEST CASE RUNNER ********************************************************************************************/
+TEST_GROUP_RUNNER(BmsCodec) 
+{
+    RUN_TEST_CASE(BmsCodec, samplesSurviveTheRoundTrip);
+    RUN_TEST_CASE(BmsCodec, unchangedSampleTakesOneByte);
+    RUN_TEST_CASE(BmsCodec, fullChunkRejectsSample);
+}
@@ -3,9 +3,13 @@
  *  Created on: Feb 11, 2026
  *      Author: M. Schermutzki
  *****************************************************************************************************************/
+ #include <pthread.h>
+ #include <sched.h>
  #include "unity_fixture.h"
+ #include "bms_bus.h"
  #include "bms_communication.h"
  #include "can_mock.h"
+ #include "timer_mock.h"
 /*** includes ****************************************************************************************************/
 /*================================================ DEFINE TEST GROUP ============================================*/
 /*** define ******************************************************************************************************/
@@ -16,11 +20,65 @@ static bms_com_t* _bms1 = NULL;
 static bms_com_t* _bms2 = NULL;
 static uint32_t _bms1Id = 0x1FFFC;
 static uint32_t _bms2Id = 0x1FFFD;
+static int32_t _observed[8];
+static uint8_t _observedIndex[8];
+static uint8_t _observedCount = 0;
+static bool _readerStop = false;
+static uint32_t _readerTorn = 0;
+static uint32_t _readerCopies = 0;
+
+/*** local functions *********************************************************************************************/
+static void _observer(bms_com_t* bms, bms_field_t field, uint8_t index, int32_t value, void* context)
+{
+    (void)bms;
+    (void)field;
+    (void)context;
+
+    if(_observedCount < 8)
+    {
+        _observedIndex[_observedCount] = index;
+        _observed[_observedCount++] = value;
+    }
+}
+
+// takes snapshots of _bms1 until it is stopped and counts the ones that mix two sweeps
+static void* _snapshotReader(void* arg)
+{
+    bms_snapshot_t snap;
+
+    (void)arg;
+    while(!__atomic_load_n(&_readerStop, __ATOMIC_ACQUIRE))
+    {
+        bms_communication_getSnapshot(_bms1, &snap);
+        uint16_t expected = (snap.sequence == 0) ? 0 : (uint16_t)(3000u + snap.sequence);
+        for(uint8_t i = 0; i < BMS_CELL_COUNT; i++)
+        {
+            if(snap.cellVoltage[i] != expected)
+            {
+                _readerTorn++;
+                break;
+            }
+        }
+        __atomic_fetch_add(&_readerCopies, 1u, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+// sends the due requests at timeUs and answers the first one with response
+static void _pollOnce(bms_com_t* bms, uint64_t timeUs, const can_frame_t* response)
+{
+    timer_mock_setTimeUs(timeUs);
+    bms_communication_cyclic(bms);
+    canMockPushResponse((can_t*)_bmsInit1.halHandle, response); 
+    bms_communication_cyclic(bms);
+    bms_communication_cyclic(bms);
+}
 
 /*** setup *******************************************************************************************************/
 TEST_SETUP(BmsCommunication) 
 {
     can_init();
+    timer_mock_setTimeUs(0);
     bms_communication_init();
 
     _bmsInit1.halHandle = (void*)can_new();
@@ -28,15 +86,25 @@ TEST_SETUP(BmsCommunication)
     _bmsInit1.comWrite = (com_write_t)can_write;
     _bmsInit1.comOpen = (com_open_t)can_open;
     _bmsInit1.comClose = (com_close_t)can_close;
+    _bmsInit1.comTime = timer_mock_getTimeUs;
+    _bmsInit1.comTxStatus = (com_tx_status_t)can_txStatus;
+    _bmsInit1.comSetFilter = (com_set_filter_t)can_setFilter;
+    _bmsInit1.comWriteBatch = NULL;
+    _bmsInit1.comReadBatch = NULL;
+    _bmsInit1.comBusOffCount = (com_bus_off_count_t)can_getBusOffCount;
 
     _bmsInit2.halHandle = (void*)can_new();
     _bmsInit2.comRead = (com_read_t)can_read;
     _bmsInit2.comWrite = (com_write_t)can_write;
     _bmsInit2.comOpen = (com_open_t)can_open;
     _bmsInit2.comClose = (com_close_t)can_close;
+    _bmsInit2.comTime = timer_mock_getTimeUs;
+    _bmsInit2.comTxStatus = (com_tx_status_t)can_txStatus;
+    _bmsInit2.comSetFilter = (com_set_filter_t)can_setFilter;
     
     _bms1 = bms_communication_new(&_bmsInit1, _bms1Id);
     _bms2 = bms_communication_new(&_bmsInit2,  _bms2Id);
+    _observedCount = 0;
 }
 /*** tear down ***************************************************************************************************/
 TEST_TEAR_DOWN(BmsCommunication) 
@@ -46,6 +114,30 @@ TEST_TEAR_DOWN(BmsCommunication)
 }
 /*==================================================== TEST LIST ================================================*/
 /*****************************************************************************************************************
+* This test checks that the next deadline is the response timeout while waiting and the next poll when idle
+******************************************************************************************************************/
+TEST(BmsCommunication, nextDeadlineFollowsPollsAndTimeouts)
+{
+    can_t* mockData = (can_t*)_bmsInit1.halHandle; 
+    can_frame_t totals = { .id = 0x1FFFC100, .length = 8, .data = {0xA0, 0x0F} }; 
+
+    bms_communication_setSubscription(_bms1, BMS_GROUP_MASK(E_BMS_GROUP_TOTALS));
+    bms_communication_setResponseTimeout(_bms1, 5000);
+    TEST_ASSERT_EQUAL_UINT64(0, bms_communication_getNextDeadline(_bms1));
+
+    timer_mock_setTimeUs(1000);
+    bms_communication_cyclic(_bms1);
+    TEST_ASSERT_EQUAL_UINT64(6000, bms_communication_getNextDeadline(_bms1));
+
+    canMockPushResponse(mockData, &totals); 
+    bms_communication_cyclic(_bms1);
+    bms_communication_cyclic(_bms1);
+    TEST_ASSERT_EQUAL_UINT64(200000, bms_communication_getNextDeadline(_bms1));
+
+    bms_communication_setSubscription(_bms1, 0);
+    TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, bms_communication_getNextDeadline(_bms1));
+}
+/*****************************************************************************************************************
 * This test
 ******************************************************************************************************************/
 TEST(BmsCommunication, instancesWereCreatedSuccessfully) 
@@ -175,6 +267,803 @@ TEST(BmsCommunication, getCellVoltageBoundaryCheck)
     TEST_ASSERT_EQUAL_UINT16(3874, voltage);
 }
 /*****************************************************************************************************************
+* This test checks that a pipelined instance keeps several requests in flight and matches the responses by 
+* CAN ID, regardless of the order they arrive in
+******************************************************************************************************************/
+TEST(BmsCommunication, pipelinedRequestsAreMatchedOutOfOrder)
+{
+    can_t* mockData = (can_t*)_bmsInit1.halHandle; 
+
+    bms_communication_setPipelineDepth(_bms1, 4);
+    bms_communication_cyclic(_bms1);
+
+    TEST_ASSERT_EQUAL_UINT16(4, mockData->txCount);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC100, mockData->txLog[0].id);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC101, mockData->txLog[1].id);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC103, mockData->txLog[2].id);     // SOC/SOH is not subscribed by default
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC105, mockData->txLog[3].id);
+
+    // capacity answers before total values
+    can_frame_t capacity = { .id = 0x1FFFC101, .length = 8, .data = {0x10, 0x27, 0x00, 0x00, 0x88, 0x13, 0x00, 0x00} };
+    can_frame_t total = { .id = 0x1FFFC100, .length = 8, .data = {0xA0, 0x0F, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x00} };
+    canMockPushResponse(mockData, &capacity);
+    canMockPushResponse(mockData, &total);
+
+    // every response is decoded in its own cycle, the freed slots are refilled in the following one
+    for(uint8_t i = 0; i < 4; i++)
+    {
+        bms_communication_cyclic(_bms1);
+    }
+
+    // both free slots were refilled with the next commands
+    TEST_ASSERT_EQUAL_UINT16(6, mockData->txCount);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC106, mockData->txLog[4].id);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC109, mockData->txLog[5].id);
+
+    // the decoded values are published when the sweep ends, the remaining requests time out
+    for(uint8_t i = 0; i < 16 && bms_communication_getSweepCount(_bms1) == 0; i++)
+    {
+        timer_mock_advanceUs(60000);
+        bms_communication_cyclic(_bms1);
+        bms_communication_cyclic(_bms1);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(10000, bms_communication_getFullCapacity(_bms1));
+    TEST_ASSERT_EQUAL_UINT32(5000, bms_communication_getRemainingCapacity(_bms1));
+    TEST_ASSERT_EQUAL_UINT32(4000, bms_communication_getTotalVoltage(_bms1));
+    TEST_ASSERT_EQUAL_INT32(10, bms_communication_getTotalCurrent(_bms1));
+}
+/*****************************************************************************************************************
+* This test checks that the default depth of one waits for each response before sending the next request
+******************************************************************************************************************/
+TEST(BmsCommunication, defaultPipelineDepthSendsOneRequest)
+{
+    can_t* mockData = (can_t*)_bmsInit1.halHandle; 
+
+    bms_communication_cyclic(_bms1);
+    bms_communication_cyclic(_bms1);
+
+    TEST_ASSERT_EQUAL_UINT16(1, mockData->txCount);
+}
+/*****************************************************************************************************************
+* This test checks that every command follows its own poll period and that one shot commands are not repeated
+******************************************************************************************************************/
+TEST(BmsCommunication, commandsArePolledWithTheirOwnPeriod)
+{
+    can_t* mockData = (can_t*)_bmsInit1.halHandle; 
+    uint16_t count = 0;
+
+    bms_communication_setPipelineDepth(_bms1, 8);
+    bms_communication_setSubscription(_bms1, BMS_GROUP_MASK_ALL);
+
+    // startup sweep requests every command once
+    for(uint8_t i = 0; i < 4; i++)
+    {
+        bms_communication_cyclic(_bms1);
+        for(uint16_t j = count; j < mockData->txCount; j++)
+        {
+            canMockPushResponse(mockData, &mockData->txLog[j]);
+        }
+        count = mockData->txCount;
+        for(uint8_t j = 0; j < 16; j++)
+        {
+            bms_communication_cyclic(_bms1);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT16(18, mockData->txCount);
+
+    // nothing is due before the fastest period elapsed
+    timer_mock_advanceUs(50000);
+    bms_communication_cyclic(_bms1);
+    bms_communication_cyclic(_bms1);
+    TEST_ASSERT_EQUAL_UINT16(18, mockData->txCount);
+
+    // alarm and protect status run at 100 ms
+    timer_mock_advanceUs(50000);
+    bms_communication_cyclic(_bms1);
+    bms_communication_cyclic(_bms1);
+    TEST_ASSERT_EQUAL_UINT16(20, mockData->txCount);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC105, mockData->txLog[18].id);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC106, mockData->txLog[19].id);
+}
+/*****************************************************************************************************************
+* This test checks that a command period can be overridden with a phase
+******************************************************************************************************************/
+TEST(BmsCommunication, pollPeriodCanBeOverridden)
+{
+    can_t* mockData = (can_t*)_bmsInit1.halHandle; 
+
+    for(uint8_t cmd = 0; cmd < E_BMS_CMD_COUNT; cmd++)
+    {
+        bms_communication_setPollPeriod(_bms1, (bms_cmd_list_t)cmd, 0, 60000);
+    }
+    bms_communication_setPollPeriod(_bms1, E_BMS_CMD1_CAPACITY, 0, 10);
+
+    bms_communication_cyclic(_bms1);
+    TEST_ASSERT_EQUAL_UINT16(0, mockData->txCount);
+
+    timer_mock_advanceUs(10000);
+    bms_communication_cyclic(_bms1);
+    bms_communication_cyclic(_bms1);
+    TEST_ASSERT_EQUAL_UINT16(1, mockData->txCount);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC101, mockData->txLog[0].id);
+}
+/*****************************************************************************************************************
+* This test checks that only the subscribed data groups are requested
+******************************************************************************************************************/
+TEST(BmsCommunication, onlySubscribedGroupsArePolled)
+{
+    can_t* mockData = (can_t*)_bmsInit1.halHandle; 
+
+    TEST_ASSERT_EQUAL_HEX32(BMS_GROUP_MASK_DECODED, bms_communication_getSubscription(_bms1));
+
+    bms_communication_setSubscription(_bms1, BMS_GROUP_MASK(E_BMS_GROUP_PROTECTION) | BMS_GROUP_MASK_CELLS);
+    bms_communication_setPipelineDepth(_bms1, 8);
+    bms_communication_cyclic(_bms1);
+
+    TEST_ASSERT_EQUAL_UINT16(5, mockData->txCount);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC106, mockData->txLog[0].id);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC109, mockData->txLog[1].id);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC10A, mockData->txLog[2].id);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC10B, mockData->txLog[3].id);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC10C, mockData->txLog[4].id);
+}
+/*****************************************************************************************************************
+* This test checks that an unanswered request is dropped at its deadline and the next command is sent
+******************************************************************************************************************/
+TEST(BmsCommunication, requestIsDroppedAtItsDeadline)
+{
+    can_t* mockData = (can_t*)_bmsInit1.halHandle; 
+
+    bms_communication_setResponseTimeout(_bms1, 5000);
+    bms_communication_cyclic(_bms1);
+    TEST_ASSERT_EQUAL_UINT16(1, mockData->txCount);
+
+    timer_mock_advanceUs(4999);
+    bms_communication_cyclic(_bms1);
+    TEST_ASSERT_EQUAL_UINT16(1, mockData->txCount);
+    TEST_ASSERT_EQUAL_UINT32(0, bms_communication_getTimeoutCount(_bms1));
+
+    timer_mock_advanceUs(1);
+    bms_communication_cyclic(_bms1);
+    TEST_ASSERT_EQUAL_UINT16(2, mockData->txCount);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC101, mockData->txLog[1].id);
+    TEST_ASSERT_EQUAL_UINT32(1, bms_communication_getTimeoutCount(_bms1));
+}
+/*****************************************************************************************************************
+* This test checks that the deadlines of two instances do not influence each other
+******************************************************************************************************************/
+TEST(BmsCommunication, deadlinesAreKeptPerInstance)
+{
+    can_t* mockData1 = (can_t*)_bmsInit1.halHandle; 
+    can_t* mockData2 = (can_t*)_bmsInit2.halHandle; 
+
+    bms_communication_setResponseTimeout(_bms1, 1000);
+    bms_communication_setResponseTimeout(_bms2, 8000);
+    bms_communication_cyclic(_bms1);
+    bms_communication_cyclic(_bms2);
+
+    timer_mock_advanceUs(2000);
+    bms_communication_cyclic(_bms1);
+    bms_communication_cyclic(_bms2);
+
+    TEST_ASSERT_EQUAL_UINT32(1, bms_communication_getTimeoutCount(_bms1));
+    TEST_ASSERT_EQUAL_UINT32(0, bms_communication_getTimeoutCount(_bms2));
+    TEST_ASSERT_EQUAL_UINT16(2, mockData1->txCount);
+    TEST_ASSERT_EQUAL_UINT16(1, mockData2->txCount);
+}
+/*****************************************************************************************************************
+* This test checks that a failed transmission frees its slot without waiting for the response deadline
+******************************************************************************************************************/
+TEST(BmsCommunication, failedTransmissionReleasesRequest)
+{
+    can_t* mockData = (can_t*)_bmsInit1.halHandle; 
+
+    bms_communication_cyclic(_bms1);
+    canMockPushTxStatus(mockData, 0x1FFFC100, E_HAL_STATUS_ERROR);
+    bms_communication_cyclic(_bms1);
+
+    TEST_ASSERT_EQUAL_UINT16(2, mockData->txCount);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC101, mockData->txLog[1].id);
+    TEST_ASSERT_EQUAL_UINT32(1, bms_communication_getTxErrorCount(_bms1));
+    TEST_ASSERT_EQUAL_UINT32(0, bms_communication_getTimeoutCount(_bms1));
+}
+/*****************************************************************************************************************
+* This test checks that the response deadline restarts when the frame actually left the controller
+******************************************************************************************************************/
+TEST(BmsCommunication, transmitCompletionRestartsDeadline)
+{
+    can_t* mockData = (can_t*)_bmsInit1.halHandle; 
+
+    bms_communication_setResponseTimeout(_bms1, 5000);
+    bms_communication_cyclic(_bms1);
+
+    timer_mock_advanceUs(4000);
+    canMockPushTxStatus(mockData, 0x1FFFC100, E_HAL_STATUS_OK);
+    bms_communication_cyclic(_bms1);
+
+    timer_mock_advanceUs(4000);
+    bms_communication_cyclic(_bms1);
+    TEST_ASSERT_EQUAL_UINT32(0, bms_communication_getTimeoutCount(_bms1));
+
+    timer_mock_advanceUs(1000);
+    bms_communication_cyclic(_bms1);
+    TEST_ASSERT_EQUAL_UINT32(1, bms_communication_getTimeoutCount(_bms1));
+}
+/*****************************************************************************************************************
+* This test checks that two instances on one bus get their own responses, whichever instance reads them
+******************************************************************************************************************/
+TEST(BmsCommunication, sharedBusRoutesResponsesToOwner)
+{
+    can_t* mockData = (can_t*)_bmsInit1.halHandle; 
+
+    bms_communication_deinit();
+    bms_communication_init();
+    _bms1 = bms_communication_new(&_bmsInit1, _bms1Id);
+    _bms2 = bms_communication_new(&_bmsInit1, _bms2Id);
+    TEST_ASSERT_EQUAL_PTR(bms_communication_getBus(_bms1), bms_communication_getBus(_bms2));
+    TEST_ASSERT_EQUAL_UINT8(2, bms_bus_getMemberCount(bms_communication_getBus(_bms1)));
+    bms_communication_setSubscription(_bms1, BMS_GROUP_MASK(E_BMS_GROUP_TOTALS));
+    bms_communication_setSubscription(_bms2, BMS_GROUP_MASK(E_BMS_GROUP_TOTALS));
+
+    bms_communication_cyclic(_bms1);
+    bms_communication_cyclic(_bms2);
+
+    // both responses and a foreign frame are read by the first instance
+    can_frame_t response2 = { .id = 0x1FFFD100, .length = 8, .data = {0x10, 0x27} }; 
+    can_frame_t foreign = { .id = 0x00000351, .length = 8, .data = {0} }; 
+    can_frame_t response1 = { .id = 0x1FFFC100, .length = 8, .data = {0xA0, 0x0F} }; 
+    canMockPushResponse(mockData, &response2); 
+    canMockPushResponse(mockData, &foreign); 
+    canMockPushResponse(mockData, &response1); 
+    bms_communication_cyclic(_bms1);
+    bms_communication_cyclic(_bms2);
+    bms_communication_cyclic(_bms1);
+    bms_communication_cyclic(_bms2);
+
+    TEST_ASSERT_EQUAL_UINT32(4000, bms_communication_getTotalVoltage(_bms1));
+    TEST_ASSERT_EQUAL_UINT32(10000, bms_communication_getTotalVoltage(_bms2));
+    TEST_ASSERT_EQUAL_UINT32(1, bms_bus_getForeignCount(bms_communication_getBus(_bms1)));
+}
+/*****************************************************************************************************************
+* This test checks that a slave ID can only be registered once per bus
+******************************************************************************************************************/
+TEST(BmsCommunication, duplicateSlaveIdIsRejected)
+{
+    bms_communication_deinit();
+    bms_communication_init();
+    _bms1 = bms_communication_new(&_bmsInit1, _bms1Id);
+    _bms2 = bms_communication_new(&_bmsInit1, _bms1Id);
+
+    TEST_ASSERT_NOT_NULL(_bms1);
+    TEST_ASSERT_NULL(_bms2);
+    TEST_ASSERT_EQUAL_PTR(_bms1, bms_bus_lookup(bms_communication_getBus(_bms1), _bms1Id));
+}
+/*****************************************************************************************************************
+* This test checks that the acceptance filter follows the registered slave IDs
+******************************************************************************************************************/
+TEST(BmsCommunication, acceptanceFilterFollowsRegisteredSlaves)
+{
+    can_t* mockData = (can_t*)_bmsInit1.halHandle; 
+    uint32_t code = 0;
+    uint32_t mask = 0;
+
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC000, mockData->filterCode);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFFC00, mockData->filterMask);
+
+    bms_communication_deinit();
+    bms_communication_init();
+    _bms1 = bms_communication_new(&_bmsInit1, _bms1Id);
+    _bms2 = bms_communication_new(&_bmsInit1, _bms2Id);
+
+    // 0x1FFFC and 0x1FFFD only differ in bit 0, so one mask is exact
+    TEST_ASSERT_TRUE(bms_bus_getFilter(bms_communication_getBus(_bms1), &code, &mask));
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC000, mockData->filterCode);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFEC00, mockData->filterMask);
+    TEST_ASSERT_EQUAL_HEX32(mockData->filterMask, mask);
+
+    bms_communication_delete(_bms1);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFD000, mockData->filterCode);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFFC00, mockData->filterMask);
+}
+/*****************************************************************************************************************
+* This test checks that slave IDs which cannot share one exact mask are reported and filtered in software
+******************************************************************************************************************/
+TEST(BmsCommunication, looseFilterFallsBackToSoftware)
+{
+    can_t* mockData = (can_t*)_bmsInit1.halHandle; 
+    uint32_t code = 0;
+    uint32_t mask = 0;
+
+    bms_communication_deinit();
+    bms_communication_init();
+    _bms1 = bms_communication_new(&_bmsInit1, 0x1FFFC);
+    _bms2 = bms_communication_new(&_bmsInit1, 0x1FFFF);
+
+    TEST_ASSERT_FALSE(bms_bus_getFilter(bms_communication_getBus(_bms1), &code, &mask));
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC000, code);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFCC00, mask);
+
+    // 0x1FFFE passes the hardware mask but is dropped by the dispatcher
+    can_frame_t stray = { .id = 0x1FFFE100, .length = 8, .data = {0} }; 
+    canMockPushResponse(mockData, &stray); 
+    bms_communication_cyclic(_bms1);
+    bms_communication_cyclic(_bms1);
+    TEST_ASSERT_EQUAL_UINT32(1, bms_bus_getForeignCount(bms_communication_getBus(_bms1)));
+}
+/*****************************************************************************************************************
+* This test checks that a pool supplied by the caller serves more packs than the built-in one
+******************************************************************************************************************/
+TEST(BmsCommunication, callerPoolServesMorePacks)
+{
+    static uint64_t pool[4096];
+    size_t poolSize = 8 * bms_communication_getInstanceSize();
+    bms_com_t* bms[8];
+
+    TEST_ASSERT_TRUE(poolSize <= sizeof(pool));
+    bms_communication_deinit();
+    bms_communication_initPool(pool, poolSize);
+
+    for(uint8_t i = 0; i < 8; i++)
+    {
+        bms[i] = bms_communication_new(&_bmsInit1, 0x1FFF0 + i);
+        TEST_ASSERT_NOT_NULL(bms[i]);
+    }
+    TEST_ASSERT_NULL(bms_communication_new(&_bmsInit1, 0x1FFF8));
+    TEST_ASSERT_EQUAL_UINT8(8, bms_bus_getMemberCount(bms_communication_getBus(bms[0])));
+}
+/*****************************************************************************************************************
+* This test checks that a deep pipeline is limited to its share of the bus window
+******************************************************************************************************************/
+TEST(BmsCommunication, busWindowIsSharedFairly)
+{
+    static uint64_t pool[4096];
+    can_t* mockData = (can_t*)_bmsInit1.halHandle; 
+    bms_com_t* bms[8];
+
+    bms_communication_deinit();
+    bms_communication_initPool(pool, sizeof(pool));
+
+    for(uint8_t i = 0; i < 8; i++)
+    {
+        bms[i] = bms_communication_new(&_bmsInit1, 0x1FFF0 + i);
+        bms_communication_setPipelineDepth(bms[i], 8);
+    }
+    bms_bus_t* bus = bms_communication_getBus(bms[0]);
+    TEST_ASSERT_EQUAL_UINT8(1, bms_bus_getShare(bus));
+
+    for(uint8_t i = 0; i < 8; i++)
+    {
+        bms_communication_cyclic(bms[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT16(8, mockData->txCount);
+
+    bms_bus_setWindow(bus, 16);
+    TEST_ASSERT_EQUAL_UINT8(2, bms_bus_getShare(bus));
+}
+/*****************************************************************************************************************
+* This test checks that the bus reports the time until every pack completed a sweep
+******************************************************************************************************************/
+TEST(BmsCommunication, aggregateSweepTimeCoversAllPacks)
+{
+    can_t* mockData = (can_t*)_bmsInit1.halHandle; 
+
+    bms_communication_deinit();
+    bms_communication_init();
+    _bms1 = bms_communication_new(&_bmsInit1, _bms1Id);
+    _bms2 = bms_communication_new(&_bmsInit1, _bms2Id);
+    bms_communication_setSubscription(_bms1, BMS_GROUP_MASK(E_BMS_GROUP_TOTALS));
+    bms_communication_setSubscription(_bms2, BMS_GROUP_MASK(E_BMS_GROUP_TOTALS));
+    bms_bus_t* bus = bms_communication_getBus(_bms1);
+
+    bms_communication_cyclic(_bms1);
+    bms_communication_cyclic(_bms2);
+
+    can_frame_t response1 = { .id = 0x1FFFC100, .length = 8, .data = {0} }; 
+    timer_mock_setTimeUs(1000);
+    canMockPushResponse(mockData, &response1); 
+    bms_communication_cyclic(_bms1);
+    bms_communication_cyclic(_bms1);
+    TEST_ASSERT_EQUAL_UINT32(1000, bms_communication_getSweepTime(_bms1));
+    TEST_ASSERT_EQUAL_UINT32(1, bms_communication_getSweepCount(_bms1));
+    TEST_ASSERT_EQUAL_UINT32(0, bms_bus_getSweepTime(bus));
+
+    can_frame_t response2 = { .id = 0x1FFFD100, .length = 8, .data = {0} }; 
+    timer_mock_setTimeUs(3000);
+    canMockPushResponse(mockData, &response2); 
+    bms_communication_cyclic(_bms2);
+    bms_communication_cyclic(_bms2);
+    TEST_ASSERT_EQUAL_UINT32(3000, bms_communication_getSweepTime(_bms2));
+    TEST_ASSERT_EQUAL_UINT32(3000, bms_bus_getSweepTime(bus));
+}
+/*****************************************************************************************************************
+* This test checks that a snapshot holds the decoded values with sweep number and timestamp
+******************************************************************************************************************/
+TEST(BmsCommunication, snapshotCopiesDecodedData)
+{
+    can_t* mockData = (can_t*)_bmsInit1.halHandle; 
+    bms_snapshot_t snap;
+
+    bms_communication_setSubscription(_bms1, BMS_GROUP_MASK(E_BMS_GROUP_TOTALS) | BMS_GROUP_MASK(E_BMS_GROUP_CELLS_1_TO_4));
+    bms_communication_setPipelineDepth(_bms1, 2);
+    bms_communication_getSnapshot(_bms1, &snap);
+    TEST_ASSERT_EQUAL_UINT32(0, snap.sequence);
+    TEST_ASSERT_EQUAL_UINT64(0, snap.timestampUs);
+
+    bms_communication_cyclic(_bms1);
+    can_frame_t totals = { .id = 0x1FFFC100, .length = 8, .data = {0xA0, 0x0F, 0x00, 0x00, 0x18, 0xFC, 0xFF, 0xFF} }; 
+    can_frame_t cells = { .id = 0x1FFFC109, .length = 8, .data = {0x22, 0x0D, 0x23, 0x0D, 0x24, 0x0D, 0x25, 0x0D} }; 
+    canMockPushResponse(mockData, &totals); 
+    canMockPushResponse(mockData, &cells); 
+    timer_mock_setTimeUs(500);
+    for(uint8_t i = 0; i < 4; i++)
+    {
+        bms_communication_cyclic(_bms1);
+    }
+
+    bms_communication_getSnapshot(_bms1, &snap);
+    TEST_ASSERT_EQUAL_UINT32(1, snap.sequence);
+    TEST_ASSERT_EQUAL_UINT64(500, snap.timestampUs);
+    TEST_ASSERT_EQUAL_UINT32(4000, snap.totalVoltage);
+    TEST_ASSERT_EQUAL_INT32(-1000, snap.totalCurrent);
+    TEST_ASSERT_EQUAL_UINT16(3362, snap.cellVoltage[0]);
+    TEST_ASSERT_EQUAL_UINT16(3365, snap.cellVoltage[3]);
+    TEST_ASSERT_EQUAL_UINT16(bms_communication_getCellVoltage(_bms1, 3), snap.cellVoltage[3]);
+}
+/*****************************************************************************************************************
+* This test checks that decoded values are only visible together, once their sweep is complete
+******************************************************************************************************************/
+TEST(BmsCommunication, sweepIsPublishedAsAWhole)
+{
+    can_t* mockData = (can_t*)_bmsInit1.halHandle; 
+    uint32_t lastSeen = 0;
+
+    bms_communication_setSubscription(_bms1, BMS_GROUP_MASK(E_BMS_GROUP_CELLS_1_TO_4) | BMS_GROUP_MASK(E_BMS_GROUP_CELLS_13_TO_16));
+    bms_communication_cyclic(_bms1);
+
+    can_frame_t cells1 = { .id = 0x1FFFC109, .length = 8, .data = {0x22, 0x0D, 0x23, 0x0D, 0x24, 0x0D, 0x25, 0x0D} }; 
+    canMockPushResponse(mockData, &cells1); 
+    bms_communication_cyclic(_bms1);
+    bms_communication_cyclic(_bms1);
+
+    // the first block is decoded but the sweep is still waiting for the last one
+    TEST_ASSERT_EQUAL_UINT16(0, bms_communication_getCellVoltage(_bms1, 0));
+    TEST_ASSERT_FALSE(bms_communication_newSweepAvailable(_bms1, &lastSeen));
+
+    can_frame_t cells4 = { .id = 0x1FFFC10C, .length = 8, .data = {0x30, 0x0D, 0x31, 0x0D, 0x32, 0x0D, 0x33, 0x0D} }; 
+    canMockPushResponse(mockData, &cells4); 
+    bms_communication_cyclic(_bms1);
+    bms_communication_cyclic(_bms1);
+
+    TEST_ASSERT_TRUE(bms_communication_newSweepAvailable(_bms1, &lastSeen));
+    TEST_ASSERT_FALSE(bms_communication_newSweepAvailable(_bms1, &lastSeen));
+    TEST_ASSERT_EQUAL_UINT32(1, lastSeen);
+    TEST_ASSERT_EQUAL_UINT16(3362, bms_communication_getCellVoltage(_bms1, 0));
+    TEST_ASSERT_EQUAL_UINT16(3379, bms_communication_getCellVoltage(_bms1, 15));
+
+    // values that are not polled again keep their last published state
+    timer_mock_setTimeUs(200000);
+    bms_communication_setSubscription(_bms1, BMS_GROUP_MASK(E_BMS_GROUP_CELLS_13_TO_16));
+    bms_communication_cyclic(_bms1);
+    canMockPushResponse(mockData, &cells4); 
+    bms_communication_cyclic(_bms1);
+    bms_communication_cyclic(_bms1);
+    TEST_ASSERT_TRUE(bms_communication_newSweepAvailable(_bms1, &lastSeen));
+    TEST_ASSERT_EQUAL_UINT16(3362, bms_communication_getCellVoltage(_bms1, 0));
+}
+/*****************************************************************************************************************
+* This test checks that a group turns stale when it is older than its max age
+******************************************************************************************************************/
+TEST(BmsCommunication, groupTurnsStaleAfterMaxAge)
+{
+    can_t* mockData = (can_t*)_bmsInit1.halHandle; 
+
+    bms_communication_setSubscription(_bms1, BMS_GROUP_MASK(E_BMS_GROUP_TOTALS));
+    TEST_ASSERT_FALSE(bms_communication_isFresh(_bms1, E_BMS_GROUP_TOTALS));
+    TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, bms_communication_getAge(_bms1, E_BMS_GROUP_TOTALS));
+
+    bms_communication_cyclic(_bms1);
+    can_frame_t totals = { .id = 0x1FFFC100, .length = 8, .data = {0xA0, 0x0F} }; 
+    canMockPushResponse(mockData, &totals); 
+    timer_mock_setTimeUs(1000);
+    bms_communication_cyclic(_bms1);
+    bms_communication_cyclic(_bms1);
+
+    timer_mock_setTimeUs(2000);
+    TEST_ASSERT_TRUE(bms_communication_isFresh(_bms1, E_BMS_GROUP_TOTALS));
+    TEST_ASSERT_FALSE(bms_communication_isFresh(_bms1, E_BMS_GROUP_CAPACITY));
+    TEST_ASSERT_EQUAL_UINT64(1000, bms_communication_getAge(_bms1, E_BMS_GROUP_TOTALS));
+
+    // totals are polled every 200 ms, so they are stale after 600 ms
+    timer_mock_setTimeUs(601001);
+    TEST_ASSERT_FALSE(bms_communication_isFresh(_bms1, E_BMS_GROUP_TOTALS));
+
+    bms_communication_setMaxAge(_bms1, E_BMS_GROUP_TOTALS, 0);
+    TEST_ASSERT_EQUAL_HEX32(BMS_GROUP_MASK(E_BMS_GROUP_TOTALS), bms_communication_getFreshGroups(_bms1));
+}
+/*****************************************************************************************************************
+* This test checks that a timed out request marks its group invalid, although the old value is kept
+******************************************************************************************************************/
+TEST(BmsCommunication, timeoutInvalidatesGroup)
+{
+    can_t* mockData = (can_t*)_bmsInit1.halHandle; 
+    bms_snapshot_t snap;
+
+    bms_communication_setSubscription(_bms1, BMS_GROUP_MASK(E_BMS_GROUP_TOTALS));
+    bms_communication_cyclic(_bms1);
+    can_frame_t totals = { .id = 0x1FFFC100, .length = 8, .data = {0xA0, 0x0F} }; 
+    canMockPushResponse(mockData, &totals); 
+    bms_communication_cyclic(_bms1);
+    bms_communication_cyclic(_bms1);
+    TEST_ASSERT_TRUE(bms_communication_isFresh(_bms1, E_BMS_GROUP_TOTALS));
+
+    // the next request is not answered
+    timer_mock_setTimeUs(200000);
+    bms_communication_cyclic(_bms1);
+    timer_mock_setTimeUs(260000);
+    bms_communication_cyclic(_bms1);
+    bms_communication_cyclic(_bms1);
+
+    bms_communication_getSnapshot(_bms1, &snap);
+    TEST_ASSERT_EQUAL_UINT32(2, snap.sequence);
+    TEST_ASSERT_EQUAL_HEX32(0, snap.freshGroups);
+    TEST_ASSERT_EQUAL_UINT32(4000, snap.totalVoltage);
+    TEST_ASSERT_FALSE(bms_communication_isFresh(_bms1, E_BMS_GROUP_TOTALS));
+}
+/*****************************************************************************************************************
+* This test checks that an observer is only called when the value leaves the absolute deadband
+******************************************************************************************************************/
+TEST(BmsCommunication, observerHonoursAbsoluteDeadband)
+{
+    can_frame_t totals = { .id = 0x1FFFC100, .length = 8, .data = {0xA0, 0x0F} };     // 4000 mV
+
+    bms_communication_setSubscription(_bms1, BMS_GROUP_MASK(E_BMS_GROUP_TOTALS));
+    TEST_ASSERT_TRUE(bms_communication_addObserver(_bms1, E_BMS_FIELD_TOTAL_VOLTAGE, E_BMS_DEADBAND_ABSOLUTE, 100, _observer, NULL));
+
+    _pollOnce(_bms1, 0, &totals);
+    TEST_ASSERT_EQUAL_UINT8(1, _observedCount);
+    TEST_ASSERT_EQUAL_INT32(4000, _observed[0]);
+
+    totals.data[0] = 0xD2;  // 4050 mV
+    _pollOnce(_bms1, 200000, &totals);
+    TEST_ASSERT_EQUAL_UINT8(1, _observedCount);
+
+    totals.data[0] = 0x05;  // 4101 mV
+    totals.data[1] = 0x10;
+    _pollOnce(_bms1, 400000, &totals);
+    TEST_ASSERT_EQUAL_UINT8(2, _observedCount);
+    TEST_ASSERT_EQUAL_INT32(4101, _observed[1]);
+
+    bms_communication_removeObserver(_bms1, _observer, NULL);
+    totals.data[1] = 0x20;
+    _pollOnce(_bms1, 600000, &totals);
+    TEST_ASSERT_EQUAL_UINT8(2, _observedCount);
+}
+/*****************************************************************************************************************
+* This test checks the relative deadband per cell and that every protect bit flip is reported
+******************************************************************************************************************/
+TEST(BmsCommunication, observerReportsCellsAndProtectFlips)
+{
+    can_frame_t cells = { .id = 0x1FFFC109, .length = 8, .data = {0xE4, 0x0C, 0xE4, 0x0C, 0xE4, 0x0C, 0xE4, 0x0C} };  // 3300 mV
+    can_frame_t protect = { .id = 0x1FFFC106, .length = 8, .data = {0x00, 0x00, 0x00, 0x00} };
+
+    bms_communication_setSubscription(_bms1, BMS_GROUP_MASK(E_BMS_GROUP_CELLS_1_TO_4));
+    bms_communication_addObserver(_bms1, E_BMS_FIELD_CELL_VOLTAGE, E_BMS_DEADBAND_RELATIVE, 10, _observer, NULL);
+    _pollOnce(_bms1, 0, &cells);
+    TEST_ASSERT_EQUAL_UINT8(4, _observedCount);
+
+    // +30 mV is within 1 %, +34 mV is not
+    cells.data[0] = 0x02;
+    cells.data[1] = 0x0D;
+    cells.data[2] = 0x06;
+    cells.data[3] = 0x0D;
+    _pollOnce(_bms1, 200000, &cells);
+    TEST_ASSERT_EQUAL_UINT8(5, _observedCount);
+    TEST_ASSERT_EQUAL_UINT8(1, _observedIndex[4]);
+    TEST_ASSERT_EQUAL_INT32(3334, _observed[4]);
+
+    _observedCount = 0;
+    bms_communication_removeObserver(_bms1, _observer, NULL);
+    bms_communication_setSubscription(_bms1, BMS_GROUP_MASK(E_BMS_GROUP_PROTECTION));
+    bms_communication_addObserver(_bms1, E_BMS_FIELD_PROTECT_A, E_BMS_DEADBAND_ABSOLUTE, 0xFFFF, _observer, NULL);
+    _pollOnce(_bms1, 400000, &protect);
+    protect.data[0] = 0x01;
+    _pollOnce(_bms1, 500000, &protect);
+    _pollOnce(_bms1, 600000, &protect);
+    TEST_ASSERT_EQUAL_UINT8(2, _observedCount);
+    TEST_ASSERT_EQUAL_INT32(0x0001, _observed[1]);
+}
+/*****************************************************************************************************************
+* This test checks the bulk cell read and the cell statistics that grow with every decoded block
+******************************************************************************************************************/
+TEST(BmsCommunication, cellStatsFollowDecodedBlocks)
+{
+    can_t* mockData = (can_t*)_bmsInit1.halHandle; 
+    uint16_t cells[BMS_CELL_COUNT];
+    bms_cell_stats_t stats;
+
+    bms_communication_setSubscription(_bms1, BMS_GROUP_MASK(E_BMS_GROUP_CELL_LIMITS) | BMS_GROUP_MASK(E_BMS_GROUP_CELLS_1_TO_4) |
+                                             BMS_GROUP_MASK(E_BMS_GROUP_CELLS_13_TO_16));
+    bms_communication_setPipelineDepth(_bms1, 3);
+    bms_communication_cyclic(_bms1);
+
+    can_frame_t limits = { .id = 0x1FFFC103, .length = 8, .data = {0x34, 0x0D, 0xE0, 0x0C, 0x54, 0x00} };             // 3380 / 3296 mV
+    can_frame_t block1 = { .id = 0x1FFFC109, .length = 8, .data = {0xE4, 0x0C, 0x20, 0x0D, 0x10, 0x0D, 0x00, 0x0D} }; // 3300 3360 3344 3328
+    can_frame_t block4 = { .id = 0x1FFFC10C, .length = 8, .data = {0xE0, 0x0C, 0x34, 0x0D, 0x00, 0x0D, 0x00, 0x0D} }; // 3296 3380 3328 3328
+    canMockPushResponse(mockData, &limits); 
+    canMockPushResponse(mockData, &block1); 
+    canMockPushResponse(mockData, &block4); 
+    for(uint8_t i = 0; i < 6; i++)
+    {
+        bms_communication_cyclic(_bms1);
+    }
+
+    bms_communication_getCellVoltages(_bms1, cells);
+    TEST_ASSERT_EQUAL_UINT16(3360, cells[1]);
+    TEST_ASSERT_EQUAL_UINT16(3380, cells[13]);
+    TEST_ASSERT_EQUAL_UINT16(0, cells[5]);
+
+    bms_communication_getCellStats(_bms1, &stats);
+    TEST_ASSERT_EQUAL_UINT8(8, stats.cellCount);
+    TEST_ASSERT_EQUAL_UINT16(3296, stats.min);
+    TEST_ASSERT_EQUAL_UINT8(12, stats.minIndex);
+    TEST_ASSERT_EQUAL_UINT16(3380, stats.max);
+    TEST_ASSERT_EQUAL_UINT8(13, stats.maxIndex);
+    TEST_ASSERT_EQUAL_UINT16(3333, stats.mean);
+    TEST_ASSERT_EQUAL_UINT16(84, stats.spread);
+    TEST_ASSERT_EQUAL_INT16(0, stats.maxDeviation);
+    TEST_ASSERT_TRUE(stats.consistent);
+}
+/*****************************************************************************************************************
+* This test checks that pipelined requests go out in one batch write, that a partially taken batch is continued 
+* with the first frame the controller did not take and that one batch read drains all received frames
+******************************************************************************************************************/
+TEST(BmsCommunication, batchWritesAndReadsArePartiallyCompleted)
+{
+    can_t* mockData = (can_t*)_bmsInit1.halHandle; 
+    can_frame_t capacity = { .id = 0x1FFFC101, .length = 8, .data = {0x10, 0x27, 0x00, 0x00, 0x88, 0x13, 0x00, 0x00} };
+    can_frame_t total = { .id = 0x1FFFC100, .length = 8, .data = {0xA0, 0x0F, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x00} };
+
+    bms_communication_delete(_bms1);
+    _bmsInit1.comWriteBatch = (com_write_batch_t)can_writeBatch;
+    _bmsInit1.comReadBatch = (com_read_batch_t)can_readBatch;
+    _bms1 = bms_communication_new(&_bmsInit1, _bms1Id);
+    bms_communication_setPipelineDepth(_bms1, 4);
+    canMockSetTxSpace(mockData, 3);
+
+    // the controller takes three of the four requests
+    bms_communication_cyclic(_bms1);
+    TEST_ASSERT_EQUAL_UINT16(1, mockData->writeBatchCount);
+    TEST_ASSERT_EQUAL_UINT16(3, mockData->txCount);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC103, mockData->txLog[2].id);
+
+    uint16_t reads = mockData->readBatchCount;
+    canMockPushResponse(mockData, &capacity);
+    canMockPushResponse(mockData, &total);
+    bms_communication_cyclic(_bms1);
+    TEST_ASSERT_EQUAL_UINT16(reads + 1u, mockData->readBatchCount);
+    TEST_ASSERT_EQUAL_UINT8(0, mockData->rxCount);
+
+    // the request that did not fit goes out first when slots are free again, after the write backoff
+    for(uint8_t i = 0; i < 4; i++)
+    {
+        bms_communication_cyclic(_bms1);
+    }
+    TEST_ASSERT_EQUAL_UINT16(3, mockData->txCount);
+    timer_mock_setTimeUs(1000);
+    for(uint8_t i = 0; i < 4; i++)
+    {
+        bms_communication_cyclic(_bms1);
+    }
+    TEST_ASSERT_EQUAL_UINT16(6, mockData->txCount);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC105, mockData->txLog[3].id);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC106, mockData->txLog[4].id);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC109, mockData->txLog[5].id);
+}
+/*****************************************************************************************************************
+* This test checks that a bus-off frees the requests in flight so the next sweep does not wait for their timeout
+******************************************************************************************************************/
+TEST(BmsCommunication, busOffReleasesRequestsInFlight)
+{
+    can_t* mockData = (can_t*)_bmsInit1.halHandle; 
+
+    bms_communication_setPipelineDepth(_bms1, 4);
+    bms_communication_cyclic(_bms1);
+    TEST_ASSERT_EQUAL_UINT16(4, mockData->txCount);
+
+    canMockBusOff(mockData);
+    bms_communication_cyclic(_bms1);
+    bms_communication_cyclic(_bms1);
+
+    TEST_ASSERT_EQUAL_UINT32(1, bms_bus_getBusOffCount(bms_communication_getBus(_bms1)));
+    TEST_ASSERT_EQUAL_UINT32(4, bms_communication_getTxErrorCount(_bms1));
+    TEST_ASSERT_EQUAL_UINT16(8, mockData->txCount);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFC106, mockData->txLog[4].id);
+}
+/*****************************************************************************************************************
+* This test checks that a response arriving after its request timed out is not taken for the next request
+******************************************************************************************************************/
+TEST(BmsCommunication, lateResponseIsNotTakenForTheNextRequest)
+{
+    can_t* mockData = (can_t*)_bmsInit1.halHandle; 
+    can_frame_t late = { .id = 0x1FFFC100, .length = 8, .data = {0x10, 0x27} }; 
+    can_frame_t totals = { .id = 0x1FFFC100, .length = 8, .data = {0xA0, 0x0F} }; 
+
+    bms_communication_setSubscription(_bms1, BMS_GROUP_MASK(E_BMS_GROUP_TOTALS));
+    bms_communication_setResponseTimeout(_bms1, 5000);
+    bms_communication_cyclic(_bms1);
+    timer_mock_setTimeUs(6000);
+    bms_communication_cyclic(_bms1);
+    TEST_ASSERT_EQUAL_UINT32(1, bms_communication_getTimeoutCount(_bms1));
+
+    // the answer to the timed out request is received before the next request is sent
+    canMockPushResponse(mockData, &late);
+    timer_mock_setTimeUs(200000);
+    bms_communication_cyclic(_bms1);
+    bms_communication_cyclic(_bms1);
+    TEST_ASSERT_EQUAL_UINT16(2, mockData->txCount);
+    TEST_ASSERT_EQUAL_UINT32(1, bms_communication_getLateResponseCount(_bms1));
+
+    canMockPushResponse(mockData, &totals); 
+    for(uint8_t i = 0; i < 4; i++)
+    {
+        bms_communication_cyclic(_bms1);
+    }
+    TEST_ASSERT_EQUAL_UINT32(4000, bms_communication_getTotalVoltage(_bms1));
+}
+/*****************************************************************************************************************
+* This test checks that a reader in another thread never gets a snapshot that mixes two sweeps
+******************************************************************************************************************/
+TEST(BmsCommunication, concurrentReaderNeverSeesTornSweep)
+{
+    can_t* mockData = (can_t*)_bmsInit1.halHandle; 
+    pthread_t reader;
+    const uint32_t sweeps = 2000;
+
+    bms_communication_setSubscription(_bms1, BMS_GROUP_MASK_CELLS);
+    bms_communication_setPipelineDepth(_bms1, 4);
+    _readerStop = false;
+    _readerTorn = 0;
+    _readerCopies = 0;
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&reader, NULL, _snapshotReader, NULL));
+    while(__atomic_load_n(&_readerCopies, __ATOMIC_ACQUIRE) == 0)
+    {
+        sched_yield();
+    }
+
+    // every sweep sets all cells to 3000 mV + its number
+    for(uint32_t sweep = 1; sweep <= sweeps; sweep++)
+    {
+        uint8_t low = (uint8_t)(3000u + sweep);
+        uint8_t high = (uint8_t)((3000u + sweep) >> 8);
+
+        timer_mock_setTimeUs((uint64_t)sweep * 200000u);
+        for(uint8_t i = 0; i < 4 && mockData->txCount < sweep * 4u; i++)
+        {
+            bms_communication_cyclic(_bms1);
+        }
+        for(uint32_t cmd = 0x109; cmd <= 0x10C; cmd++)
+        {
+            can_frame_t cells = { .id = 0x1FFFC000u | cmd, .length = 8, .data = {low, high, low, high, low, high, low, high} }; 
+            canMockPushResponse(mockData, &cells); 
+        }
+        for(uint8_t i = 0; i < 6; i++)
+        {
+            bms_communication_cyclic(_bms1);
+        }
+    }
+
+    // the last sweep is closed by the pass that finds nothing left to send
+    for(uint8_t i = 0; i < 4 && bms_communication_getSweepCount(_bms1) < sweeps; i++)
+    {
+        bms_communication_cyclic(_bms1);
+    }
+    __atomic_store_n(&_readerStop, true, __ATOMIC_RELEASE);
+    pthread_join(reader, NULL);
+    TEST_ASSERT_EQUAL_UINT32(sweeps, bms_communication_getSweepCount(_bms1));
+    TEST_ASSERT_EQUAL_UINT32(0, _readerTorn);
+}
+/*****************************************************************************************************************
 * This test
 ******************************************************************************************************************/
 
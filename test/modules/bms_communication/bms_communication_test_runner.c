@@ -14,6 +14,34 @@ TEST_GROUP_RUNNER(BmsCommunication)
     RUN_TEST_CASE(BmsCommunication, readingTotalVoltage);
     RUN_TEST_CASE(BmsCommunication, cellVoltagesAreSavedIntoCorrectArraySlots);
     RUN_TEST_CASE(BmsCommunication, getCellVoltageBoundaryCheck);
+    RUN_TEST_CASE(BmsCommunication, pipelinedRequestsAreMatchedOutOfOrder);
+    RUN_TEST_CASE(BmsCommunication, defaultPipelineDepthSendsOneRequest);
+    RUN_TEST_CASE(BmsCommunication, commandsArePolledWithTheirOwnPeriod);
+    RUN_TEST_CASE(BmsCommunication, pollPeriodCanBeOverridden);
+    RUN_TEST_CASE(BmsCommunication, onlySubscribedGroupsArePolled);
+    RUN_TEST_CASE(BmsCommunication, requestIsDroppedAtItsDeadline);
+    RUN_TEST_CASE(BmsCommunication, deadlinesAreKeptPerInstance);
+    RUN_TEST_CASE(BmsCommunication, failedTransmissionReleasesRequest);
+    RUN_TEST_CASE(BmsCommunication, transmitCompletionRestartsDeadline);
+    RUN_TEST_CASE(BmsCommunication, sharedBusRoutesResponsesToOwner);
+    RUN_TEST_CASE(BmsCommunication, duplicateSlaveIdIsRejected);
+    RUN_TEST_CASE(BmsCommunication, acceptanceFilterFollowsRegisteredSlaves);
+    RUN_TEST_CASE(BmsCommunication, looseFilterFallsBackToSoftware);
+    RUN_TEST_CASE(BmsCommunication, callerPoolServesMorePacks);
+    RUN_TEST_CASE(BmsCommunication, busWindowIsSharedFairly);
+    RUN_TEST_CASE(BmsCommunication, aggregateSweepTimeCoversAllPacks);
+    RUN_TEST_CASE(BmsCommunication, snapshotCopiesDecodedData);
+    RUN_TEST_CASE(BmsCommunication, sweepIsPublishedAsAWhole);
+    RUN_TEST_CASE(BmsCommunication, groupTurnsStaleAfterMaxAge);
+    RUN_TEST_CASE(BmsCommunication, timeoutInvalidatesGroup);
+    RUN_TEST_CASE(BmsCommunication, observerHonoursAbsoluteDeadband);
+    RUN_TEST_CASE(BmsCommunication, observerReportsCellsAndProtectFlips);
+    RUN_TEST_CASE(BmsCommunication, cellStatsFollowDecodedBlocks);
+    RUN_TEST_CASE(BmsCommunication, nextDeadlineFollowsPollsAndTimeouts);
+    RUN_TEST_CASE(BmsCommunication, batchWritesAndReadsArePartiallyCompleted);
+    RUN_TEST_CASE(BmsCommunication, busOffReleasesRequestsInFlight);
+    RUN_TEST_CASE(BmsCommunication, lateResponseIsNotTakenForTheNextRequest);
+    RUN_TEST_CASE(BmsCommunication, concurrentReaderNeverSeesTornSweep);
 }
 
 /*** MANUALLY TEST LIST ******************************************************************************************/
@@ -0,0 +1,204 @@
+/******************************************************************************************************************
+ * bms_history_test.c
+ *  Created on: Mar 12, 2026
+ *      Author: M. Schermutzki
+ *****************************************************************************************************************/
+ #include "unity_fixture.h"
+ #include "bms_communication.h"
+ #include "bms_history.h"
+ #include "can_mock.h"
+ #include "timer_mock.h"
+/*** includes ****************************************************************************************************/
+/*================================================ DEFINE TEST GROUP ============================================*/
+/*** define ******************************************************************************************************/
+TEST_GROUP(BmsHistory);
+/*** local variables *********************************************************************************************/
+static hardware_interface_t _bmsInit;
+static bms_com_t* _bms = NULL;
+static bms_history_t* _history = NULL;
+/*** local functions *********************************************************************************************/
+static void _appendSamples(uint32_t count)
+{
+    bms_sample_t sample = {0};
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        sample.timeUs = (uint64_t)i * 1000u;
+        sample.totalVoltage = 4000 + i;
+        bms_history_append(_history, &sample);
+    }
+}
+
+static void _archiveSamples(uint32_t count)
+{
+    bms_sample_t sample = {0};
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        sample.timeUs = (uint64_t)i * 200000u;
+        sample.totalCurrent = (int32_t)(i * 37u);
+        for(uint8_t cell = 0; cell < BMS_CELL_COUNT; cell++)
+        {
+            sample.cellVoltage[cell] = (uint16_t)(3000u + ((i * 7u + cell) & 0x3FFu));
+        }
+        sample.totalVoltage = 52000u + (i & 0xFFu);
+        bms_history_archive(_history, &sample);
+    }
+}
+/*** setup *******************************************************************************************************/
+TEST_SETUP(BmsHistory) 
+{
+    can_init();
+    timer_mock_setTimeUs(0);
+    bms_communication_init();
+    bms_history_init();
+
+    _bmsInit.halHandle = (void*)can_new();
+    _bmsInit.comRead = (com_read_t)can_read;
+    _bmsInit.comWrite = (com_write_t)can_write;
+    _bmsInit.comOpen = (com_open_t)can_open;
+    _bmsInit.comClose = (com_close_t)can_close;
+    _bmsInit.comTime = timer_mock_getTimeUs;
+    _bmsInit.comTxStatus = NULL;
+    _bmsInit.comSetFilter = NULL;
+
+    _bms = bms_communication_new(&_bmsInit, 0x1FFFC);
+    _history = bms_history_new(_bms, 500);
+}
+/*** tear down ***************************************************************************************************/
+TEST_TEAR_DOWN(BmsHistory) 
+{
+    bms_history_deinit();
+    bms_communication_deinit();
+    can_deinit();
+}
+/*==================================================== TEST LIST ================================================*/
+/*****************************************************************************************************************
+* This test checks that a full history keeps the newest samples
+******************************************************************************************************************/
+TEST(BmsHistory, fullHistoryKeepsNewestSamples)
+{
+    bms_sample_t sample;
+    uint32_t capacity = bms_history_getCapacity(_history);
+
+    TEST_ASSERT_NOT_NULL(_history);
+    TEST_ASSERT_EQUAL_UINT32(0, bms_history_getCount(_history));
+
+    _appendSamples(capacity + 5);
+
+    TEST_ASSERT_EQUAL_UINT32(capacity, bms_history_getCount(_history));
+    TEST_ASSERT_TRUE(bms_history_getSample(_history, 0, &sample));
+    TEST_ASSERT_EQUAL_UINT64(5000, sample.timeUs);
+    TEST_ASSERT_TRUE(bms_history_getSample(_history, capacity - 1, &sample));
+    TEST_ASSERT_EQUAL_UINT32(4000 + capacity + 4, sample.totalVoltage);
+    TEST_ASSERT_FALSE(bms_history_getSample(_history, capacity, &sample));
+}
+/*****************************************************************************************************************
+* This test checks that a range query returns the samples inside the time range, also across the wrap around
+******************************************************************************************************************/
+TEST(BmsHistory, queryReturnsSamplesInRange)
+{
+    bms_sample_t samples[16];
+    uint32_t capacity = bms_history_getCapacity(_history);
+
+    _appendSamples(capacity + 20);
+
+    uint32_t count = bms_history_query(_history, 30500, 40000, samples, 16);
+    TEST_ASSERT_EQUAL_UINT32(10, count);
+    TEST_ASSERT_EQUAL_UINT64(31000, samples[0].timeUs);
+    TEST_ASSERT_EQUAL_UINT64(40000, samples[9].timeUs);
+
+    // samples that were overwritten are not found, the result is limited to the buffer
+    count = bms_history_query(_history, 0, UINT64_MAX, samples, 16);
+    TEST_ASSERT_EQUAL_UINT32(16, count);
+    TEST_ASSERT_EQUAL_UINT64(20000, samples[0].timeUs);
+    TEST_ASSERT_EQUAL_UINT32(0, bms_history_query(_history, (uint64_t)(capacity + 20) * 1000u, UINT64_MAX, samples, 16));
+}
+/*****************************************************************************************************************
+* This test checks that published sweeps are sampled at the configured rate
+******************************************************************************************************************/
+TEST(BmsHistory, publishedSweepsAreSampledAtTheConfiguredRate)
+{
+    can_t* mockData = (can_t*)_bmsInit.halHandle; 
+    can_frame_t totals = { .id = 0x1FFFC100, .length = 8, .data = {0xA0, 0x0F} }; 
+    bms_sample_t sample;
+
+    bms_communication_setSubscription(_bms, BMS_GROUP_MASK(E_BMS_GROUP_TOTALS));
+
+    for(uint64_t time = 0; time <= 600000; time += 200000)
+    {
+        timer_mock_setTimeUs(time);
+        bms_communication_cyclic(_bms);
+        canMockPushResponse(mockData, &totals); 
+        bms_communication_cyclic(_bms);
+        bms_communication_cyclic(_bms);
+        bms_history_cyclic(_history);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(2, bms_history_getCount(_history));
+    bms_history_getSample(_history, 1, &sample);
+    TEST_ASSERT_EQUAL_UINT64(600000, sample.timeUs);
+    TEST_ASSERT_EQUAL_UINT32(4000, sample.totalVoltage);
+}
+/*****************************************************************************************************************
+* This test checks that every published sweep is archived, while full samples follow the configured rate
+******************************************************************************************************************/
+TEST(BmsHistory, everySweepIsArchived)
+{
+    can_t* mockData = (can_t*)_bmsInit.halHandle; 
+    can_frame_t totals = { .id = 0x1FFFC100, .length = 8, .data = {0xA0, 0x0F} }; 
+    can_frame_t cells = { .id = 0x1FFFC109, .length = 8, .data = {0x22, 0x0D, 0x23, 0x0D, 0x24, 0x0D, 0x25, 0x0D} }; 
+    bms_sample_t samples[8];
+
+    bms_communication_setSubscription(_bms, BMS_GROUP_MASK(E_BMS_GROUP_TOTALS) | BMS_GROUP_MASK(E_BMS_GROUP_CELLS_1_TO_4));
+    bms_communication_setPipelineDepth(_bms, 2);
+
+    for(uint64_t time = 0; time <= 600000; time += 200000)
+    {
+        timer_mock_setTimeUs(time);
+        bms_communication_cyclic(_bms);
+        canMockPushResponse(mockData, &totals); 
+        canMockPushResponse(mockData, &cells); 
+        for(uint8_t i = 0; i < 4; i++)
+        {
+            bms_communication_cyclic(_bms);
+        }
+        bms_history_cyclic(_history);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(2, bms_history_getCount(_history));
+    TEST_ASSERT_EQUAL_UINT32(4, bms_history_getArchiveCount(_history));
+    TEST_ASSERT_EQUAL_UINT32(2, bms_history_queryArchive(_history, 200000, 400000, samples, 8));
+    TEST_ASSERT_EQUAL_UINT64(200000, samples[0].timeUs);
+    TEST_ASSERT_EQUAL_UINT32(4000, samples[1].totalVoltage);
+    TEST_ASSERT_EQUAL_UINT16(3362, samples[1].cellVoltage[0]);
+    TEST_ASSERT_EQUAL_UINT16(3365, samples[1].cellVoltage[3]);
+}
+/*****************************************************************************************************************
+* This test checks that a full archive drops its oldest chunk and range queries decode across chunks
+******************************************************************************************************************/
+TEST(BmsHistory, fullArchiveDropsOldestChunk)
+{
+    bms_sample_t samples[16];
+
+    _archiveSamples(20000);
+
+    uint32_t count = bms_history_getArchiveCount(_history);
+    TEST_ASSERT_TRUE(count > 0 && count < 20000);
+    TEST_ASSERT_EQUAL_UINT32(1, bms_history_queryArchive(_history, 0, UINT64_MAX, samples, 1));
+    TEST_ASSERT_EQUAL_UINT64((uint64_t)(20000 - count) * 200000u, samples[0].timeUs);
+
+    // the newest samples span the last chunk border
+    uint64_t from = (uint64_t)(20000 - 16) * 200000u;
+    TEST_ASSERT_EQUAL_UINT32(16, bms_history_queryArchive(_history, from, UINT64_MAX, samples, 16));
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        uint32_t index = 20000 - 16 + i;
+
+        TEST_ASSERT_EQUAL_UINT64((uint64_t)index * 200000u, samples[i].timeUs);
+        TEST_ASSERT_EQUAL_INT32((int32_t)(index * 37u), samples[i].totalCurrent);
+        TEST_ASSERT_EQUAL_UINT32(52000u + (index & 0xFFu), samples[i].totalVoltage);
+        TEST_ASSERT_EQUAL_UINT16(3000u + ((index * 7u + 15u) & 0x3FFu), samples[i].cellVoltage[15]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, bms_history_queryArchive(_history, 0, (uint64_t)(20000 - count) * 200000u - 1u, samples, 16));
+}
@@ -0,0 +1,15 @@
+/******************************************************************************************************************
+ * bms_history_test_runner.c
+ *  Created on: Mar 12, 2026
+ *      Author: M. Schermutzki
+ *****************************************************************************************************************/
+ #include "unity_fixture.h"
+/*** TEST CASE RUNNER ********************************************************************************************/
+TEST_GROUP_RUNNER(BmsHistory) 
+{
+    RUN_TEST_CASE(BmsHistory, fullHistoryKeepsNewestSamples);
+    RUN_TEST_CASE(BmsHistory, queryReturnsSamplesInRange);
+    RUN_TEST_CASE(BmsHistory, publishedSweepsAreSampledAtTheConfiguredRate);
+    RUN_TEST_CASE(BmsHistory, everySweepIsArchived);
+    RUN_TEST_CASE(BmsHistory, fullArchiveDropsOldestChunk);
+}
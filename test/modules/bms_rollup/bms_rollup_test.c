@@ -0,0 +1,143 @@
+/******************************************************************************************************************
+ * bms_rollup_test.c
+ *  Created on: Mar 15, 2026
+ *      Author: M. Schermutzki
+ *****************************************************************************************************************/
+ #include "unity_fixture.h"
+ #include "bms_communication.h"
+ #include "bms_rollup.h"
+ #include "can_mock.h"
+ #include "timer_mock.h"
+/*** includes ****************************************************************************************************/
+/*================================================ DEFINE TEST GROUP ============================================*/
+/*** define ******************************************************************************************************/
+TEST_GROUP(BmsRollup);
+/*** local variables *********************************************************************************************/
+static hardware_interface_t _bmsInit;
+static bms_com_t* _bms = NULL;
+static bms_rollup_t* _rollup = NULL;
+/*** local functions *********************************************************************************************/
+static uint8_t _add(uint64_t timeUs, uint32_t totalVoltage, int32_t totalCurrent)
+{
+    bms_snapshot_t snap = {0};
+
+    snap.timestampUs = timeUs;
+    snap.totalVoltage = totalVoltage;
+    snap.totalCurrent = totalCurrent;
+    return bms_rollup_add(_rollup, &snap);
+}
+/*** setup *******************************************************************************************************/
+TEST_SETUP(BmsRollup) 
+{
+    can_init();
+    timer_mock_setTimeUs(0);
+    bms_communication_init();
+    bms_rollup_init();
+
+    _bmsInit.halHandle = (void*)can_new();
+    _bmsInit.comRead = (com_read_t)can_read;
+    _bmsInit.comWrite = (com_write_t)can_write;
+    _bmsInit.comOpen = (com_open_t)can_open;
+    _bmsInit.comClose = (com_close_t)can_close;
+    _bmsInit.comTime = timer_mock_getTimeUs;
+    _bmsInit.comTxStatus = NULL;
+    _bmsInit.comSetFilter = NULL;
+
+    _bms = bms_communication_new(&_bmsInit, 0x1FFFC);
+    _rollup = bms_rollup_new(_bms);
+}
+/*** tear down ***************************************************************************************************/
+TEST_TEAR_DOWN(BmsRollup) 
+{
+    bms_rollup_deinit();
+    bms_communication_deinit();
+    can_deinit();
+}
+/*==================================================== TEST LIST ================================================*/
+/*****************************************************************************************************************
+* This test checks that intervals close on their boundaries with min, max, mean and count of their sweeps
+******************************************************************************************************************/
+TEST(BmsRollup, intervalsCloseOnTheirBoundaries)
+{
+    bms_rollup_entry_t entry;
+
+    TEST_ASSERT_NOT_NULL(_rollup);
+    TEST_ASSERT_FALSE(bms_rollup_getCurrent(_rollup, E_BMS_ROLLUP_SECOND, &entry));
+
+    TEST_ASSERT_EQUAL_UINT8(0, _add(100000, 4000, -300));
+    TEST_ASSERT_EQUAL_UINT8(0, _add(500000, 4010, 100));
+    TEST_ASSERT_EQUAL_UINT8(0, _add(900000, 3990, -100));
+    TEST_ASSERT_EQUAL_UINT8(BMS_ROLLUP_LEVEL_MASK(E_BMS_ROLLUP_SECOND), _add(1200000, 4020, 0));
+
+    TEST_ASSERT_EQUAL_UINT32(1, bms_rollup_getCount(_rollup, E_BMS_ROLLUP_SECOND));
+    TEST_ASSERT_TRUE(bms_rollup_getEntry(_rollup, E_BMS_ROLLUP_SECOND, 0, &entry));
+    TEST_ASSERT_EQUAL_UINT64(0, entry.startUs);
+    TEST_ASSERT_EQUAL_UINT32(3, entry.count);
+    TEST_ASSERT_EQUAL_INT32(3990, entry.field[E_BMS_ROLLUP_TOTAL_VOLTAGE].min);
+    TEST_ASSERT_EQUAL_INT32(4010, entry.field[E_BMS_ROLLUP_TOTAL_VOLTAGE].max);
+    TEST_ASSERT_EQUAL_INT32(4000, entry.field[E_BMS_ROLLUP_TOTAL_VOLTAGE].mean);
+    TEST_ASSERT_EQUAL_INT32(-300, entry.field[E_BMS_ROLLUP_TOTAL_CURRENT].min);
+    TEST_ASSERT_EQUAL_INT32(-100, entry.field[E_BMS_ROLLUP_TOTAL_CURRENT].mean);
+
+    // the minute is still open and holds all four sweeps
+    TEST_ASSERT_EQUAL_UINT32(0, bms_rollup_getCount(_rollup, E_BMS_ROLLUP_MINUTE));
+    TEST_ASSERT_TRUE(bms_rollup_getCurrent(_rollup, E_BMS_ROLLUP_MINUTE, &entry));
+    TEST_ASSERT_EQUAL_UINT32(4, entry.count);
+    TEST_ASSERT_EQUAL_INT32(4020, entry.field[E_BMS_ROLLUP_TOTAL_VOLTAGE].max);
+
+    TEST_ASSERT_EQUAL_UINT8(BMS_ROLLUP_LEVEL_MASK(E_BMS_ROLLUP_SECOND) | BMS_ROLLUP_LEVEL_MASK(E_BMS_ROLLUP_MINUTE), 
+                            _add(61000000, 4000, 0));
+    TEST_ASSERT_TRUE(bms_rollup_getEntry(_rollup, E_BMS_ROLLUP_SECOND, 1, &entry));
+    TEST_ASSERT_EQUAL_UINT64(1000000, entry.startUs);
+    TEST_ASSERT_TRUE(bms_rollup_getEntry(_rollup, E_BMS_ROLLUP_MINUTE, 0, &entry));
+    TEST_ASSERT_EQUAL_UINT32(4, entry.count);
+    TEST_ASSERT_EQUAL_INT32(4005, entry.field[E_BMS_ROLLUP_TOTAL_VOLTAGE].mean);
+}
+/*****************************************************************************************************************
+* This test checks that a full level keeps the newest intervals
+******************************************************************************************************************/
+TEST(BmsRollup, fullLevelKeepsNewestIntervals)
+{
+    bms_rollup_entry_t entry;
+    uint32_t capacity = bms_rollup_getCapacity(E_BMS_ROLLUP_SECOND);
+
+    for(uint32_t i = 0; i <= capacity + 5; i++)
+    {
+        _add((uint64_t)i * 1000000u, 4000 + i, 0);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(capacity, bms_rollup_getCount(_rollup, E_BMS_ROLLUP_SECOND));
+    TEST_ASSERT_TRUE(bms_rollup_getEntry(_rollup, E_BMS_ROLLUP_SECOND, 0, &entry));
+    TEST_ASSERT_EQUAL_UINT64(5000000, entry.startUs);
+    TEST_ASSERT_EQUAL_INT32(4005, entry.field[E_BMS_ROLLUP_TOTAL_VOLTAGE].mean);
+    TEST_ASSERT_TRUE(bms_rollup_getEntry(_rollup, E_BMS_ROLLUP_SECOND, capacity - 1, &entry));
+    TEST_ASSERT_EQUAL_INT32(4000 + capacity + 4, entry.field[E_BMS_ROLLUP_TOTAL_VOLTAGE].mean);
+    TEST_ASSERT_FALSE(bms_rollup_getEntry(_rollup, E_BMS_ROLLUP_SECOND, capacity, &entry));
+}
+/*****************************************************************************************************************
+* This test checks that every published sweep goes into the rollup
+******************************************************************************************************************/
+TEST(BmsRollup, publishedSweepsAreRolledUp)
+{
+    can_t* mockData = (can_t*)_bmsInit.halHandle; 
+    can_frame_t totals = { .id = 0x1FFFC100, .length = 8, .data = {0xA0, 0x0F} }; 
+    bms_rollup_entry_t entry;
+
+    bms_communication_setSubscription(_bms, BMS_GROUP_MASK(E_BMS_GROUP_TOTALS));
+
+    for(uint64_t time = 0; time <= 1000000; time += 200000)
+    {
+        timer_mock_setTimeUs(time);
+        bms_communication_cyclic(_bms);
+        canMockPushResponse(mockData, &totals); 
+        bms_communication_cyclic(_bms);
+        bms_communication_cyclic(_bms);
+        bms_rollup_cyclic(_rollup);
+    }
+
+    TEST_ASSERT_TRUE(bms_rollup_getEntry(_rollup, E_BMS_ROLLUP_SECOND, 0, &entry));
+    TEST_ASSERT_EQUAL_UINT32(5, entry.count);
+    TEST_ASSERT_EQUAL_INT32(4000, entry.field[E_BMS_ROLLUP_TOTAL_VOLTAGE].mean);
+    TEST_ASSERT_TRUE(bms_rollup_getCurrent(_rollup, E_BMS_ROLLUP_HOUR, &entry));
+    TEST_ASSERT_EQUAL_UINT32(6, entry.count);
+}
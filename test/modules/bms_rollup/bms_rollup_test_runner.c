@@ -0,0 +1,13 @@
+/******************************************************************************************************************
+ * bms_rollup_test_runner.c
+ *  Created on: Mar 15, 2026
+ *      Author: M. Schermutzki
+ *****************************************************************************************************************/
+ #include "unity_fixture.h"
+/*** TEST CASE RUNNER ********************************************************************************************/
+TEST_GROUP_RUNNER(BmsRollup) 
+{
+    RUN_TEST_CASE(BmsRollup, intervalsCloseOnTheirBoundaries);
+    RUN_TEST_CASE(BmsRollup, fullLevelKeepsNewestIntervals);
+    RUN_TEST_CASE(BmsRollup, publishedSweepsAreRolledUp);
+}
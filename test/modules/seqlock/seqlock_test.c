@@ -0,0 +1,63 @@
+/******************************************************************************************************************
+ * seqlock_test.c
+ *  Created on: Mar 09, 2026
+ *      Author: M. Schermutzki
+ *****************************************************************************************************************/
+ #include "unity_fixture.h"
+ #include "seqlock.h"
+/*** includes ****************************************************************************************************/
+/*================================================ DEFINE TEST GROUP ============================================*/
+/*** define ******************************************************************************************************/
+TEST_GROUP(SeqLock);
+/*** local variables *********************************************************************************************/
+static seqlock_t _lock;
+/*** setup *******************************************************************************************************/
+TEST_SETUP(SeqLock) 
+{
+    seqlock_init(&_lock);
+}
+/*** tear down ***************************************************************************************************/
+TEST_TEAR_DOWN(SeqLock) 
+{
+}
+/*==================================================== TEST LIST ================================================*/
+/*****************************************************************************************************************
+* This test checks that a read without a concurrent write succeeds at the first attempt
+******************************************************************************************************************/
+TEST(SeqLock, undisturbedReadDoesNotRetry)
+{
+    uint32_t start = seqlock_readBegin(&_lock);
+
+    TEST_ASSERT_FALSE(seqlock_readRetry(&_lock, start));
+    TEST_ASSERT_EQUAL_UINT32(0, seqlock_getRetryCount(&_lock));
+    TEST_ASSERT_EQUAL_UINT32(0, seqlock_getContentionCount(&_lock));
+}
+/*****************************************************************************************************************
+* This test checks that a write during the copy forces the reader to repeat it
+******************************************************************************************************************/
+TEST(SeqLock, writeDuringReadForcesRetry)
+{
+    uint32_t start = seqlock_readBegin(&_lock);
+
+    seqlock_writeBegin(&_lock);
+    seqlock_writeEnd(&_lock);
+
+    TEST_ASSERT_TRUE(seqlock_readRetry(&_lock, start));
+    TEST_ASSERT_EQUAL_UINT32(1, seqlock_getRetryCount(&_lock));
+
+    start = seqlock_readBegin(&_lock);
+    TEST_ASSERT_FALSE(seqlock_readRetry(&_lock, start));
+}
+/*****************************************************************************************************************
+* This test checks that a write that is still in progress invalidates the copy
+******************************************************************************************************************/
+TEST(SeqLock, unfinishedWriteInvalidatesRead)
+{
+    uint32_t start = seqlock_readBegin(&_lock);
+
+    seqlock_writeBegin(&_lock);
+    TEST_ASSERT_TRUE(seqlock_readRetry(&_lock, start));
+    seqlock_writeEnd(&_lock);
+
+    TEST_ASSERT_EQUAL_UINT32(0, seqlock_readBegin(&_lock) & 1u);
+}
@@ -0,0 +1,13 @@
+/******************************************************************************************************************
+ * seqlock_test_runner.c
+ *  Created on: Mar 09, 2026
+ *      Author: M. Schermutzki
+ *****************************************************************************************************************/
+ #include "unity_fixture.h"
+/*** TEST CASE RUNNER ********************************************************************************************/
+TEST_GROUP_RUNNER(SeqLock) 
+{
+    RUN_TEST_CASE(SeqLock, undisturbedReadDoesNotRetry);
+    RUN_TEST_CASE(SeqLock, writeDuringReadForcesRetry);
+    RUN_TEST_CASE(SeqLock, unfinishedWriteInvalidatesRead);
+}
@@ -0,0 +1,123 @@
+/******************************************************************************************************************
+ * spsc_ring_test.c
+ *  Created on: Mar 04, 2026
+ *      Author: M. Schermutzki
+ *****************************************************************************************************************/
+ #include <string.h>
+ #include "unity_fixture.h"
+ #include "spsc_ring.h"
+ #include "generic_hardware_interface.h"
+/*** includes ****************************************************************************************************/
+/*================================================ DEFINE TEST GROUP ============================================*/
+/*** define ******************************************************************************************************/
+TEST_GROUP(SpscRing);
+/*** local variables *********************************************************************************************/
+static can_frame_t _storage[4];
+static spsc_ring_t* _ring = NULL;
+/*** setup *******************************************************************************************************/
+TEST_SETUP(SpscRing) 
+{
+    spsc_ring_init();
+    _ring = spsc_ring_new(_storage, sizeof(can_frame_t), 4);
+}
+/*** tear down ***************************************************************************************************/
+TEST_TEAR_DOWN(SpscRing) 
+{
+    spsc_ring_deinit();
+}
+/*==================================================== TEST LIST ================================================*/
+/*****************************************************************************************************************
+* This test checks that an empty ring does not return data
+******************************************************************************************************************/
+TEST(SpscRing, popOnEmptyRingFails)
+{
+    can_frame_t frame;
+
+    TEST_ASSERT_NOT_NULL(_ring);
+    TEST_ASSERT_FALSE(spsc_ring_pop(_ring, &frame));
+    TEST_ASSERT_EQUAL_UINT32(0, spsc_ring_getCount(_ring));
+}
+/*****************************************************************************************************************
+* This test checks that frames leave the ring in the order they were pushed, also across the wrap around
+******************************************************************************************************************/
+TEST(SpscRing, framesKeepTheirOrderAcrossWrapAround)
+{
+    can_frame_t frame = {0};
+
+    for(uint32_t i = 0; i < 10; i++)
+    {
+        frame.id = i;
+        TEST_ASSERT_TRUE(spsc_ring_push(_ring, &frame));
+        frame.id = 0xFFFF;
+        TEST_ASSERT_TRUE(spsc_ring_pop(_ring, &frame));
+        TEST_ASSERT_EQUAL_UINT32(i, frame.id);
+    }
+}
+/*****************************************************************************************************************
+* This test checks that a full ring rejects and counts further frames
+******************************************************************************************************************/
+TEST(SpscRing, fullRingCountsDrops)
+{
+    can_frame_t frame = {0};
+
+    for(uint32_t i = 0; i < 6; i++)
+    {
+        frame.id = i;
+        spsc_ring_push(_ring, &frame);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(4, spsc_ring_getCount(_ring));
+    TEST_ASSERT_EQUAL_UINT32(2, spsc_ring_getDropCount(_ring));
+
+    TEST_ASSERT_TRUE(spsc_ring_pop(_ring, &frame));
+    TEST_ASSERT_EQUAL_UINT32(0, frame.id);
+}
+/*****************************************************************************************************************
+* This test checks that the high-water mark keeps the highest fill level
+******************************************************************************************************************/
+TEST(SpscRing, highWaterMarkKeepsMaximum)
+{
+    can_frame_t frame = {0};
+
+    spsc_ring_push(_ring, &frame);
+    spsc_ring_push(_ring, &frame);
+    spsc_ring_push(_ring, &frame);
+    spsc_ring_pop(_ring, &frame);
+    spsc_ring_pop(_ring, &frame);
+    spsc_ring_push(_ring, &frame);
+
+    TEST_ASSERT_EQUAL_UINT32(3, spsc_ring_getHighWater(_ring));
+    TEST_ASSERT_EQUAL_UINT32(2, spsc_ring_getCount(_ring));
+}
+/*****************************************************************************************************************
+* This test checks that batches wrap around in order and a full ring takes only part of a batch
+******************************************************************************************************************/
+TEST(SpscRing, batchesArePartiallyCompleted)
+{
+    can_frame_t frames[6] = {0};
+    can_frame_t frame = {0};
+
+    for(uint32_t i = 0; i < 6; i++)
+    {
+        frames[i].id = i;
+    }
+
+    spsc_ring_push(_ring, &frame);
+    spsc_ring_push(_ring, &frame);
+    spsc_ring_pop(_ring, &frame);
+    spsc_ring_pop(_ring, &frame);
+
+    TEST_ASSERT_EQUAL_UINT32(4, spsc_ring_pushBatch(_ring, frames, 6));
+    TEST_ASSERT_EQUAL_UINT32(0, spsc_ring_pushBatch(_ring, &frames[4], 2));
+    TEST_ASSERT_EQUAL_UINT32(0, spsc_ring_getDropCount(_ring));
+    TEST_ASSERT_EQUAL_UINT32(4, spsc_ring_getHighWater(_ring));
+
+    memset(frames, 0xFF, sizeof(frames));
+    TEST_ASSERT_EQUAL_UINT32(3, spsc_ring_popBatch(_ring, frames, 3));
+    TEST_ASSERT_EQUAL_UINT32(1, spsc_ring_popBatch(_ring, &frames[3], 6));
+    TEST_ASSERT_EQUAL_UINT32(0, spsc_ring_popBatch(_ring, frames, 6));
+    for(uint32_t i = 0; i < 4; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(i, frames[i].id);
+    }
+}
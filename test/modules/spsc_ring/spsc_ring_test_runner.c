@@ -0,0 +1,15 @@
+/******************************************************************************************************************
+ * spsc_ring_test_runner.c
+ *  Created on: Mar 04, 2026
+ *      Author: M. Schermutzki
+ *****************************************************************************************************************/
+ #include "unity_fixture.h"
+/*** TEST CASE RUNNER ********************************************************************************************/
+TEST_GROUP_RUNNER(SpscRing) 
+{
+    RUN_TEST_CASE(SpscRing, popOnEmptyRingFails);
+    RUN_TEST_CASE(SpscRing, framesKeepTheirOrderAcrossWrapAround);
+    RUN_TEST_CASE(SpscRing, fullRingCountsDrops);
+    RUN_TEST_CASE(SpscRing, highWaterMarkKeepsMaximum);
+    RUN_TEST_CASE(SpscRing, batchesArePartiallyCompleted);
+}